@@ -0,0 +1,126 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <math.h>
+#include <stdio.h>
+
+#include "Util.h"
+
+u32 addBenchmarkSeries(BenchmarkResults* results, const std::string& name, const char* unit) {
+  BenchmarkSeries series;
+  series.name = name;
+  series.unit = unit;
+  series.samples.reserve(results->measuredFrames);
+  results->series.push_back(series);
+  return (u32)results->series.size() - 1;
+}
+
+u32 findBenchmarkSeries(BenchmarkResults* results, const std::string& name, const char* unit) {
+  for (u32 i = 0; i < results->series.size(); ++i) {
+    if (results->series[i].name == name) {
+      return i;
+    }
+  }
+  return addBenchmarkSeries(results, name, unit);
+}
+
+void addBenchmarkSample(BenchmarkResults* results, u32 seriesIndex, f64 sample) {
+  results->series[seriesIndex].samples.push_back(sample);
+}
+
+// Nearest-rank percentile of sorted samples
+internal_access f64 percentile(const std::vector<f64>& sortedSamples, f64 fraction) {
+  u64 rank = (u64)ceil(fraction * sortedSamples.size());
+  return sortedSamples[rank > 0 ? rank - 1 : 0];
+}
+
+SampleSummary summarizeSamples(const std::vector<f64>& samples) {
+  SampleSummary summary{};
+  if (samples.empty()) {
+    return summary;
+  }
+
+  std::vector<f64> sortedSamples(samples);
+  std::sort(sortedSamples.begin(), sortedSamples.end());
+
+  f64 total = 0.0;
+  for (f64 sample : sortedSamples) {
+    total += sample;
+  }
+
+  summary.min = sortedSamples.front();
+  summary.mean = total / sortedSamples.size();
+  summary.p50 = percentile(sortedSamples, 0.50);
+  summary.p95 = percentile(sortedSamples, 0.95);
+  summary.p99 = percentile(sortedSamples, 0.99);
+  summary.max = sortedSamples.back();
+  return summary;
+}
+
+internal_access f64 throughput(const BenchmarkResults* results) {
+  return results->measuredSeconds > 0.0 ? results->measuredFrames / results->measuredSeconds : 0.0;
+}
+
+void printBenchmarkResults(const BenchmarkResults* results) {
+  std::cout << "benchmark: " << results->deviceName << " (driver " << results->driverVersion << "), present mode " << results->presentMode
+            << ", " << results->framesInFlight << " frames in flight, " << results->width << "x" << results->height << "\n"
+            << "\t" << results->warmupFrames << " warm-up frames, " << results->measuredFrames << " measured frames in "
+            << results->measuredSeconds << " s (" << throughput(results) << " frames/s)\n"
+            << "\t                                    unit          min         mean          p50          p95          p99          max\n";
+
+  char line[256];
+  for (const BenchmarkSeries& series : results->series) {
+    SampleSummary summary = summarizeSamples(series.samples);
+    snprintf(line, sizeof(line), "\t%-35s %5s %12.3f %12.3f %12.3f %12.3f %12.3f %12.3f\n",
+             series.name.c_str(), series.unit, summary.min, summary.mean, summary.p50, summary.p95, summary.p99, summary.max);
+    std::cout << line;
+  }
+  std::cout << std::flush;
+}
+
+/*
+ * - Write run context, throughput and the summary of every series as a single JSON object
+ * - Raw samples are omitted, summaries are enough to compare runs
+ */
+void writeBenchmarkResultsJson(const BenchmarkResults* results, const char* filePath) {
+  std::ofstream file(filePath);
+  if (!file.is_open()) {
+    throw std::runtime_error(std::string("failed to open file for writing:") + filePath);
+  }
+
+  file << "{\n  \"device\": ";
+  writeJsonString(file, results->deviceName.c_str());
+  file << ",\n  \"driverVersion\": " << results->driverVersion
+       << ",\n  \"apiVersion\": " << results->apiVersion
+       << ",\n  \"presentMode\": ";
+  writeJsonString(file, results->presentMode);
+  file << ",\n  \"framesInFlight\": " << results->framesInFlight
+       << ",\n  \"width\": " << results->width
+       << ",\n  \"height\": " << results->height
+       << ",\n  \"warmupFrames\": " << results->warmupFrames
+       << ",\n  \"measuredFrames\": " << results->measuredFrames
+       << ",\n  \"measuredSeconds\": " << results->measuredSeconds
+       << ",\n  \"framesPerSecond\": " << throughput(results)
+       << ",\n  \"series\": {";
+
+  for (size_t i = 0; i < results->series.size(); ++i) {
+    const BenchmarkSeries& series = results->series[i];
+    SampleSummary summary = summarizeSamples(series.samples);
+    file << (i > 0 ? ",\n    " : "\n    ");
+    writeJsonString(file, series.name.c_str());
+    file << ": { \"unit\": ";
+    writeJsonString(file, series.unit);
+    file << ", \"samples\": " << series.samples.size()
+         << ", \"min\": " << summary.min
+         << ", \"mean\": " << summary.mean
+         << ", \"p50\": " << summary.p50
+         << ", \"p95\": " << summary.p95
+         << ", \"p99\": " << summary.p99
+         << ", \"max\": " << summary.max << " }";
+  }
+
+  file << "\n  }\n}\n";
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include "KuringTypes.h"
+
+// Per frame samples of a single measurement
+struct BenchmarkSeries {
+  std::string name;
+  const char* unit; // ex: "ms"
+  std::vector<f64> samples;
+};
+
+struct SampleSummary {
+  f64 min;
+  f64 mean;
+  f64 p50;
+  f64 p95;
+  f64 p99;
+  f64 max;
+};
+
+// Results of a fixed length benchmark run along with enough context (device, present mode, etc.) to compare runs
+struct BenchmarkResults {
+  std::string deviceName;
+  u32 driverVersion;
+  u32 apiVersion;
+  const char* presentMode;
+  u32 framesInFlight;
+  u32 width;
+  u32 height;
+  u32 warmupFrames;
+  u32 measuredFrames;
+  f64 measuredSeconds; // wall clock time of all measured frames
+  std::vector<BenchmarkSeries> series;
+};
+
+// Returns the index used to add samples to the new series
+u32 addBenchmarkSeries(BenchmarkResults* results, const std::string& name, const char* unit);
+// Returns the index of the series with the given name, adding it if it doesn't exist yet
+u32 findBenchmarkSeries(BenchmarkResults* results, const std::string& name, const char* unit);
+void addBenchmarkSample(BenchmarkResults* results, u32 seriesIndex, f64 sample);
+SampleSummary summarizeSamples(const std::vector<f64>& samples);
+void printBenchmarkResults(const BenchmarkResults* results);
+void writeBenchmarkResultsJson(const BenchmarkResults* results, const char* filePath);
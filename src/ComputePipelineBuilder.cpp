@@ -0,0 +1,122 @@
+#include "ComputePipelineBuilder.h"
+
+ComputePipelineBuilder::ComputePipelineBuilder(VkDevice logicalDevice, VkAllocationCallbacks* allocator) : logicalDevice(logicalDevice), allocator(allocator) {
+  pipelineLayoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCI.pushConstantRangeCount = 0;
+  pipelineLayoutCI.pPushConstantRanges = nullptr;
+  pipelineLayoutCI.setLayoutCount = 0;
+  pipelineLayoutCI.pSetLayouts = nullptr;
+}
+
+ComputePipelineBuilder::ComputePipelineBuilder(VkDevice logicalDevice, ShaderModuleCache* shaderModuleCache, VkAllocationCallbacks* allocator)
+  : ComputePipelineBuilder(logicalDevice, allocator) {
+  this->shaderModuleCache = shaderModuleCache;
+}
+
+ComputePipelineBuilder::~ComputePipelineBuilder()
+{
+  deallocateShader(computeShaderModule);
+  delete[] pushConstantRanges;
+}
+
+void ComputePipelineBuilder::build(VkPipeline* outPipeline, VkPipelineLayout* outPipelineLayout)
+{
+  verifyIntegrity();
+
+  if (vkCreatePipelineLayout(logicalDevice, &pipelineLayoutCI, allocator, outPipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create compute pipeline layout!");
+  }
+
+  VkSpecializationInfo specialization = specializationInfo(specializationConstants);
+  VkPipelineShaderStageCreateInfo shaderStageCI = computeShaderStageCI;
+  shaderStageCI.pSpecializationInfo = specializationConstants.count > 0 ? &specialization : nullptr;
+
+  VkComputePipelineCreateInfo pipelineCI{};
+  pipelineCI.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCI.stage = shaderStageCI;
+  pipelineCI.layout = *outPipelineLayout; // descriptor set layout and push constant info
+  pipelineCI.basePipelineHandle = VK_NULL_HANDLE;
+  pipelineCI.basePipelineIndex = -1;
+
+  if (vkCreateComputePipelines(logicalDevice, pipelineCache, 1, &pipelineCI, allocator, outPipeline) != VK_SUCCESS) {
+    vkDestroyPipelineLayout(logicalDevice, *outPipelineLayout, allocator);
+    throw std::runtime_error("failed to create compute pipeline!");
+  }
+}
+
+ComputePipelineBuilder& ComputePipelineBuilder::setComputeShader(const char* fileLocation)
+{
+  deallocateShader(computeShaderModule);
+  if(shaderModuleCache != nullptr) {
+    computeShaderModule = acquireShaderModule(shaderModuleCache, fileLocation);
+  } else {
+    computeShaderModule = createShaderModule(logicalDevice, fileLocation, allocator);
+  }
+
+  computeShaderStageCI.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  computeShaderStageCI.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  computeShaderStageCI.module = computeShaderModule;
+  computeShaderStageCI.pName = "main";
+  return *this;
+}
+
+void ComputePipelineBuilder::deallocateShader(VkShaderModule& shaderModule)
+{
+  // modules acquired from a shader module cache belong to the cache
+  if(shaderModule != VK_NULL_HANDLE && shaderModuleCache == nullptr) {
+    vkDestroyShaderModule(logicalDevice, shaderModule, allocator);
+    shaderModule = VK_NULL_HANDLE;
+  }
+}
+
+void ComputePipelineBuilder::verifyIntegrity()
+{
+  const std::string errorTitle = "ComputePipelineBuilder error: ";
+
+  if(logicalDevice == VK_NULL_HANDLE) {
+    throw std::runtime_error(errorTitle + "failed to supply logical device!");
+  }
+  if(computeShaderModule == VK_NULL_HANDLE) {
+    throw std::runtime_error(errorTitle + "failed to supply compute shader!");
+  }
+  for(u32 i = 0; i < pipelineLayoutCI.pushConstantRangeCount; ++i) {
+    const VkPushConstantRange& range = pushConstantRanges[i];
+    if(range.size == 0 || (range.size % 4) != 0 || (range.offset % 4) != 0) {
+      throw std::runtime_error(errorTitle + "push constant range offset and size must be non-zero multiples of 4!");
+    }
+    if(range.offset + range.size > MIN_GUARANTEED_PUSH_CONSTANTS_SIZE) {
+      throw std::runtime_error(errorTitle + "push constant range exceeds the guaranteed push constant size, use a uniform buffer!");
+    }
+    if((range.stageFlags & VK_SHADER_STAGE_COMPUTE_BIT) == 0) {
+      throw std::runtime_error(errorTitle + "push constant ranges must include the compute stage!");
+    }
+  }
+}
+
+ComputePipelineBuilder&
+ComputePipelineBuilder::setDescriptorSetLayouts(VkDescriptorSetLayout* descriptorSetLayout, u32 count)
+{
+  pipelineLayoutCI.setLayoutCount = count; // descriptor set layouts
+  pipelineLayoutCI.pSetLayouts = descriptorSetLayout; // num descriptor set layouts
+  return *this;
+}
+
+ComputePipelineBuilder&
+ComputePipelineBuilder::setPushConstantRanges(const VkPushConstantRange* pushConstantRanges, u32 count)
+{
+  delete[] this->pushConstantRanges;
+
+  this->pushConstantRanges = new VkPushConstantRange[count];
+  for(u32 i = 0; i < count; ++i) {
+    this->pushConstantRanges[i] = pushConstantRanges[i];
+  }
+  pipelineLayoutCI.pushConstantRangeCount = count;
+  pipelineLayoutCI.pPushConstantRanges = this->pushConstantRanges;
+  return *this;
+}
+
+ComputePipelineBuilder& ComputePipelineBuilder::setPipelineCache(VkPipelineCache pipelineCache)
+{
+  this->pipelineCache = pipelineCache;
+  return *this;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include "KuringTypes.h"
+#include "Util.h"
+#include "VulkanUtil.h"
+#include "ShaderModuleCache.h"
+
+// Compute counterpart of GraphicsPipelineBuilder: a single compute shader stage plus the pipeline layout
+class ComputePipelineBuilder {
+public:
+
+  ComputePipelineBuilder(VkDevice logicalDevice, VkAllocationCallbacks* allocator = nullptr);
+  // Shader modules are acquired from (and owned by) the cache instead of being created per builder
+  ComputePipelineBuilder(VkDevice logicalDevice, ShaderModuleCache* shaderModuleCache, VkAllocationCallbacks* allocator = nullptr);
+  ~ComputePipelineBuilder();
+
+  ComputePipelineBuilder& setComputeShader(const char* fileLocation);
+  ComputePipelineBuilder& setDescriptorSetLayouts(VkDescriptorSetLayout* descriptorSetLayout, u32 count);
+  ComputePipelineBuilder& setPushConstantRanges(const VkPushConstantRange* pushConstantRanges, u32 count);
+  // Sets layout(constant_id = constantId) in the compute shader, see SpecializationConstants
+  template<typename T>
+  ComputePipelineBuilder& setSpecializationConstant(u32 constantId, T value) {
+    ::setSpecializationConstant(&specializationConstants, constantId, value);
+    return *this;
+  }
+  // NOTE: The cache is not owned by the builder. Optional, pipelines are compiled from scratch without one.
+  ComputePipelineBuilder& setPipelineCache(VkPipelineCache pipelineCache);
+
+  void build(VkPipeline* outPipeline, VkPipelineLayout* outPipelineLayout);
+
+private:
+  VkAllocationCallbacks* allocator = nullptr;
+  VkDevice logicalDevice = VK_NULL_HANDLE;
+  ShaderModuleCache* shaderModuleCache = nullptr;
+
+  VkPipelineShaderStageCreateInfo computeShaderStageCI{};
+  VkShaderModule computeShaderModule = VK_NULL_HANDLE;
+  SpecializationConstants specializationConstants{};
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCI{};
+  VkPushConstantRange* pushConstantRanges = nullptr;
+
+  VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+
+  void verifyIntegrity();
+  void deallocateShader(VkShaderModule& shaderModule);
+};
@@ -3,6 +3,11 @@
 #define SHADER_LOC_BASE "shaders/"
 const char* POS_COLOR_VERT_SHADER_FILE_LOC = SHADER_LOC_BASE"PosColor.vert.spv";
 const char* POS_COLOR_TRANS_MATS_VERT_SHADER_FILE_LOC = SHADER_LOC_BASE"PosColor_3DTransMats.vert.spv";
+const char* POS_COLOR_TRANS_MATS_INSTANCED_VERT_SHADER_FILE_LOC = SHADER_LOC_BASE"PosColor_3DTransMats_Instanced.vert.spv";
+const char* FULL_SCREEN_TRIANGLE_VERT_SHADER_FILE_LOC = SHADER_LOC_BASE"FullScreenTriangle.vert.spv";
 
 const char* VERTEX_COLOR_FRAG_SHADER_FILE_LOC = SHADER_LOC_BASE"VertexColor.frag.spv";
-const char* RAY_MARCH_SPHERE_FRAG_SHADER_FILE_LOC = SHADER_LOC_BASE"RayMarchSphere.frag.spv";
\ No newline at end of file
+const char* RAY_MARCH_SPHERE_FRAG_SHADER_FILE_LOC = SHADER_LOC_BASE"RayMarchSphere.frag.spv";
+const char* RAY_MARCH_COMPOSITE_FRAG_SHADER_FILE_LOC = SHADER_LOC_BASE"RayMarchComposite.frag.spv";
+
+const char* RAY_MARCH_SPHERE_COMP_SHADER_FILE_LOC = SHADER_LOC_BASE"RayMarchSphere.comp.spv";
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "GeometryStore.h"
+
+#include <stdexcept>
+
+internal_access u32 indexSize(VkIndexType indexType) {
+  return indexType == VK_INDEX_TYPE_UINT16 ? sizeof(u16) : sizeof(u32);
+}
+
+void initGeometryStore(VkDevice device, GpuMemoryAllocator* memoryAllocator, u32 vertexStride, VkIndexType indexType,
+                       u32 vertexCapacity, u32 indexCapacity, GeometryStore* store) {
+  *store = {};
+  store->vertexStride = vertexStride;
+  store->indexType = indexType;
+  store->vertexCapacity = vertexCapacity;
+  store->indexCapacity = indexCapacity;
+
+  // ownership of both buffers is transferred from the transfer queue family
+  store->vertexBuffer = createBuffer(device, (VkDeviceSize)vertexCapacity * vertexStride,
+                                     VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+  store->vertexMemory = allocateBufferMemory(memoryAllocator, store->vertexBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  store->indexBuffer = createBuffer(device, (VkDeviceSize)indexCapacity * indexSize(indexType),
+                                    VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+  store->indexMemory = allocateBufferMemory(memoryAllocator, store->indexBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void destroyGeometryStore(VkDevice device, GpuMemoryAllocator* memoryAllocator, GeometryStore* store) {
+  vkDestroyBuffer(device, store->vertexBuffer, nullptr);
+  freeGpuMemory(memoryAllocator, &store->vertexMemory);
+  vkDestroyBuffer(device, store->indexBuffer, nullptr);
+  freeGpuMemory(memoryAllocator, &store->indexMemory);
+  *store = {};
+}
+
+u32 addMesh(UploadQueue* uploadQueue, GeometryStore* store, const VertexAtt& vertexAtt, const MeshFileSubmesh* submeshes, u32 submeshCount) {
+  if (vertexAtt.strideInBytes != store->vertexStride) {
+    throw std::runtime_error("mesh vertex stride does not match the geometry store!");
+  }
+  if (vertexAtt.indices.type != store->indexType && store->indexType != VK_INDEX_TYPE_UINT32) {
+    throw std::runtime_error("32 bit mesh indices can not be added to a 16 bit geometry store!");
+  }
+  u32 vertexCount = vertexAtt.sizeInBytes / vertexAtt.strideInBytes;
+  u32 indexCount = vertexAtt.indices.count;
+  if (vertexCount > store->vertexCapacity - store->vertexCount || indexCount > store->indexCapacity - store->indexCount) {
+    throw std::runtime_error("geometry store is full!");
+  }
+
+  uploadToBuffer(uploadQueue, store->vertexBuffer, (VkDeviceSize)store->vertexCount * store->vertexStride, vertexAtt.data, vertexAtt.sizeInBytes,
+                 VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+  VkDeviceSize indicesOffset = (VkDeviceSize)store->indexCount * indexSize(store->indexType);
+  if (vertexAtt.indices.type == store->indexType) {
+    uploadToBuffer(uploadQueue, store->indexBuffer, indicesOffset, vertexAtt.indices.data, vertexAtt.indices.sizeInBytes,
+                   VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+  } else {
+    std::vector<u32> widenedIndices(indexCount);
+    const u16* indices = (const u16*)vertexAtt.indices.data;
+    for (u32 i = 0; i < indexCount; ++i) {
+      widenedIndices[i] = indices[i];
+    }
+    uploadToBuffer(uploadQueue, store->indexBuffer, indicesOffset, widenedIndices.data(), (VkDeviceSize)indexCount * sizeof(u32),
+                   VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+  }
+
+  GeometryStoreMesh mesh;
+  mesh.firstSubmesh = (u32)store->submeshes.size();
+  mesh.submeshCount = submeshCount;
+  for (u32 i = 0; i < submeshCount; ++i) {
+    MeshFileSubmesh submesh = submeshes[i];
+    submesh.firstIndex += store->indexCount;
+    submesh.vertexOffset += (s32)store->vertexCount;
+    store->submeshes.push_back(submesh);
+  }
+  store->vertexCount += vertexCount;
+  store->indexCount += indexCount;
+  store->meshes.push_back(mesh);
+  return (u32)store->meshes.size() - 1;
+}
+
+void cmdBindGeometryStore(VkCommandBuffer commandBuffer, const GeometryStore& store, u32 bindingPoint) {
+  VkDeviceSize offset = 0;
+  vkCmdBindVertexBuffers(commandBuffer, bindingPoint, 1, &store.vertexBuffer, &offset);
+  vkCmdBindIndexBuffer(commandBuffer, store.indexBuffer, 0, store.indexType);
+}
+
+void initIndirectDrawBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator, u32 capacity, IndirectDrawBuffer* drawBuffer) {
+  *drawBuffer = {};
+  drawBuffer->capacity = capacity;
+
+  drawBuffer->buffer = createBuffer(device, INDIRECT_DRAW_COMMANDS_OFFSET + (VkDeviceSize)capacity * sizeof(VkDrawIndexedIndirectCommand),
+                                    VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+  // host coherent writes are visible to the GPU once the command buffer reading them is submitted
+  drawBuffer->memory = allocateBufferMemory(memoryAllocator, drawBuffer->buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  drawBuffer->drawCount = (u32*)drawBuffer->memory.mapped;
+  drawBuffer->commands = (VkDrawIndexedIndirectCommand*)(drawBuffer->memory.mapped + INDIRECT_DRAW_COMMANDS_OFFSET);
+  resetIndirectDraws(drawBuffer);
+}
+
+void destroyIndirectDrawBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator, IndirectDrawBuffer* drawBuffer) {
+  vkDestroyBuffer(device, drawBuffer->buffer, nullptr);
+  freeGpuMemory(memoryAllocator, &drawBuffer->memory);
+  *drawBuffer = {};
+}
+
+void resetIndirectDraws(IndirectDrawBuffer* drawBuffer) {
+  drawBuffer->count = 0;
+  *drawBuffer->drawCount = 0;
+}
+
+void pushMeshDraws(IndirectDrawBuffer* drawBuffer, const GeometryStore& store, u32 meshIndex, u32 instanceCount, u32 firstInstance) {
+  drawBuffer->count += writeMeshDraws(drawBuffer, drawBuffer->count, store, meshIndex, instanceCount, firstInstance);
+  *drawBuffer->drawCount = drawBuffer->count;
+}
+
+u32 writeMeshDraws(IndirectDrawBuffer* drawBuffer, u32 firstCommand, const GeometryStore& store, u32 meshIndex, u32 instanceCount, u32 firstInstance) {
+  const GeometryStoreMesh& mesh = store.meshes[meshIndex];
+  if (firstCommand > drawBuffer->capacity || mesh.submeshCount > drawBuffer->capacity - firstCommand) {
+    throw std::runtime_error("indirect draw buffer is full!");
+  }
+  VkDrawIndexedIndirectCommand* command = drawBuffer->commands + firstCommand;
+  for (u32 i = 0; i < mesh.submeshCount; ++i, ++command) {
+    const MeshFileSubmesh& submesh = store.submeshes[mesh.firstSubmesh + i];
+    command->indexCount = submesh.indexCount;
+    command->instanceCount = instanceCount;
+    command->firstIndex = submesh.firstIndex;
+    command->vertexOffset = submesh.vertexOffset;
+    command->firstInstance = firstInstance;
+  }
+  return mesh.submeshCount;
+}
+
+void cmdDrawIndirect(VkCommandBuffer commandBuffer, const IndirectDrawBuffer& drawBuffer, const IndirectDrawSupport& support) {
+  // the count read from the buffer may not exceed maxDrawIndirectCount either
+  if (support.drawIndirectCount && drawBuffer.count > 0 && drawBuffer.count <= support.maxDrawIndirectCount) {
+    support.vkCmdDrawIndexedIndirectCount(commandBuffer, drawBuffer.buffer, INDIRECT_DRAW_COMMANDS_OFFSET, drawBuffer.buffer, 0,
+                                          drawBuffer.count, sizeof(VkDrawIndexedIndirectCommand));
+    return;
+  }
+  cmdDrawIndirectRange(commandBuffer, drawBuffer, 0, drawBuffer.count, support);
+}
+
+void cmdDrawIndirectRange(VkCommandBuffer commandBuffer, const IndirectDrawBuffer& drawBuffer, u32 firstCommand, u32 commandCount,
+                          const IndirectDrawSupport& support) {
+  const u32 stride = sizeof(VkDrawIndexedIndirectCommand);
+  u32 maxDrawCount = support.multiDrawIndirect ? support.maxDrawIndirectCount : 1;
+  u32 endCommand = firstCommand + commandCount;
+  for (u32 first = firstCommand; first < endCommand; first += maxDrawCount) {
+    u32 drawCount = endCommand - first < maxDrawCount ? endCommand - first : maxDrawCount;
+    vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer.buffer, INDIRECT_DRAW_COMMANDS_OFFSET + (VkDeviceSize)first * stride, drawCount, stride);
+  }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <vector>
+#include "KuringTypes.h"
+#include "Models.h"
+#include "MeshFormat.h"
+#include "GpuMemoryAllocator.h"
+#include "UploadQueue.h"
+
+const VkDeviceSize INDIRECT_DRAW_COMMANDS_OFFSET = 16; // the draw count is stored first, in the same buffer
+
+// Vertices and indices of every mesh sharing one vertex layout packed into a single device local vertex buffer and a
+// single index buffer, so that a whole pass binds them once. Meshes are appended (bump allocated) and never freed.
+// Submesh offsets are rebased into the shared buffers: firstIndex and vertexOffset feed VkDrawIndexedIndirectCommand as is.
+struct GeometryStoreMesh {
+  u32 firstSubmesh; // range of GeometryStore::submeshes
+  u32 submeshCount;
+};
+
+struct GeometryStore {
+  VkBuffer vertexBuffer;
+  GpuAllocation vertexMemory;
+  VkBuffer indexBuffer;
+  GpuAllocation indexMemory;
+  u32 vertexStride;
+  VkIndexType indexType;
+  u32 vertexCapacity; // in vertices
+  u32 indexCapacity; // in indices
+  u32 vertexCount; // appended so far
+  u32 indexCount;
+  std::vector<MeshFileSubmesh> submeshes; // offset table, indexed by GeometryStoreMesh
+  std::vector<GeometryStoreMesh> meshes;
+};
+
+// Device capabilities deciding how cmdDrawIndirect issues the draws, filled when picking the physical device
+struct IndirectDrawSupport {
+  bool32 multiDrawIndirect; // more than one draw per vkCmdDrawIndexedIndirect
+  bool32 drawIndirectFirstInstance; // firstInstance may be non zero in indirect commands
+  u32 maxDrawIndirectCount; // 1 without multiDrawIndirect
+  bool32 drawIndirectCount; // VK_KHR_draw_indirect_count, the draw count is read from a buffer
+  PFN_vkCmdDrawIndexedIndirectCountKHR vkCmdDrawIndexedIndirectCount; // loaded once the device is created
+};
+
+// Host visible, persistently mapped VkDrawIndexedIndirectCommand array preceded by its draw count. Written by the CPU
+// while recording, one per frame in flight since the GPU reads it when the frame executes.
+struct IndirectDrawBuffer {
+  VkBuffer buffer;
+  GpuAllocation memory;
+  u32* drawCount; // mapped, at offset 0
+  VkDrawIndexedIndirectCommand* commands; // mapped, at INDIRECT_DRAW_COMMANDS_OFFSET
+  u32 capacity; // in commands
+  u32 count;
+};
+
+void initGeometryStore(VkDevice device, GpuMemoryAllocator* memoryAllocator, u32 vertexStride, VkIndexType indexType,
+                       u32 vertexCapacity, u32 indexCapacity, GeometryStore* store);
+// NOTE: The buffers must no longer be in use by the GPU
+void destroyGeometryStore(VkDevice device, GpuMemoryAllocator* memoryAllocator, GeometryStore* store);
+// Appends the mesh's vertices and indices and returns its index in store->meshes. The upload is submitted with the next
+// submitUploads. Throws if the vertex stride differs from the store's, or the store is full.
+// 16 bit indices are widened when the store uses 32 bit indices, 32 bit indices are not narrowed.
+u32 addMesh(UploadQueue* uploadQueue, GeometryStore* store, const VertexAtt& vertexAtt, const MeshFileSubmesh* submeshes, u32 submeshCount);
+void cmdBindGeometryStore(VkCommandBuffer commandBuffer, const GeometryStore& store, u32 bindingPoint);
+
+void initIndirectDrawBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator, u32 capacity, IndirectDrawBuffer* drawBuffer);
+void destroyIndirectDrawBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator, IndirectDrawBuffer* drawBuffer);
+// NOTE: The buffer must not be in use by the GPU (ex: wait on its frame's fence first)
+void resetIndirectDraws(IndirectDrawBuffer* drawBuffer);
+// Appends one command per submesh of the mesh, throws when the buffer is full.
+// NOTE: firstInstance must be zero unless IndirectDrawSupport::drawIndirectFirstInstance
+void pushMeshDraws(IndirectDrawBuffer* drawBuffer, const GeometryStore& store, u32 meshIndex, u32 instanceCount, u32 firstInstance);
+// Writes one command per submesh of the mesh from commands[firstCommand] and returns the number written, throws when
+// out of capacity. Leaves the count untouched so that disjoint ranges may be written from multiple threads.
+u32 writeMeshDraws(IndirectDrawBuffer* drawBuffer, u32 firstCommand, const GeometryStore& store, u32 meshIndex, u32 instanceCount, u32 firstInstance);
+// Draws every pushed command with the geometry store's buffers bound:
+//  - a single vkCmdDrawIndexedIndirectCount when supported
+//  - otherwise vkCmdDrawIndexedIndirect, maxDrawIndirectCount commands at a time (one at a time without multiDrawIndirect)
+void cmdDrawIndirect(VkCommandBuffer commandBuffer, const IndirectDrawBuffer& drawBuffer, const IndirectDrawSupport& support);
+// Draws commands[firstCommand, firstCommand + commandCount) with vkCmdDrawIndexedIndirect, see cmdDrawIndirect
+void cmdDrawIndirectRange(VkCommandBuffer commandBuffer, const IndirectDrawBuffer& drawBuffer, u32 firstCommand, u32 commandCount,
+                          const IndirectDrawSupport& support);
@@ -0,0 +1,480 @@
+#include "GpuMemoryAllocator.h"
+
+#include <stdexcept>
+#include <iostream>
+#include "VulkanUtil.h"
+#include "Util.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Free ranges smaller than this are left inside the allocation rather than split off
+const VkDeviceSize TLSF_MIN_SPLIT_SIZE = 64;
+
+internal_access u32 lowestSetBit(u64 bits) {
+  Assert(bits != 0);
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, bits);
+  return (u32)index;
+#else
+  return (u32)__builtin_ctzll(bits);
+#endif
+}
+
+internal_access u32 floorLog2(u64 value) {
+  Assert(value != 0);
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return (u32)index;
+#else
+  return 63 - (u32)__builtin_clzll(value);
+#endif
+}
+
+// Size class of a free range
+internal_access void tlsfMapping(VkDeviceSize size, u32* firstLevel, u32* secondLevel) {
+  if (size < (1ull << TLSF_SMALL_SIZE_LOG2)) {
+    *firstLevel = 0;
+    *secondLevel = (u32)(size >> (TLSF_SMALL_SIZE_LOG2 - TLSF_SECOND_LEVEL_LOG2));
+  } else {
+    u32 log2 = floorLog2(size);
+    *firstLevel = log2 - TLSF_SMALL_SIZE_LOG2 + 1;
+    *secondLevel = (u32)(size >> (log2 - TLSF_SECOND_LEVEL_LOG2)) ^ TLSF_SECOND_LEVEL_COUNT;
+  }
+}
+
+// Rounds a requested size up so that every free range in its size class is large enough (good fit, no list search)
+internal_access VkDeviceSize tlsfRoundUpSize(VkDeviceSize size) {
+  if (size < (1ull << TLSF_SMALL_SIZE_LOG2)) {
+    return alignUp(size, 1ull << (TLSF_SMALL_SIZE_LOG2 - TLSF_SECOND_LEVEL_LOG2));
+  }
+  return size + (1ull << (floorLog2(size) - TLSF_SECOND_LEVEL_LOG2)) - 1;
+}
+
+internal_access u32 newNode(GpuMemoryBlock* block) {
+  if (!block->unusedNodes.empty()) {
+    u32 nodeIndex = block->unusedNodes.back();
+    block->unusedNodes.pop_back();
+    return nodeIndex;
+  }
+  block->nodes.push_back({});
+  return (u32)block->nodes.size() - 1;
+}
+
+internal_access void insertFreeNode(GpuMemoryBlock* block, u32 nodeIndex) {
+  TlsfNode& node = block->nodes[nodeIndex];
+  u32 firstLevel, secondLevel;
+  tlsfMapping(node.size, &firstLevel, &secondLevel);
+
+  u32 head = block->freeLists[firstLevel][secondLevel];
+  node.free = true;
+  node.prevFree = TLSF_NULL_NODE;
+  node.nextFree = head;
+  if (head != TLSF_NULL_NODE) {
+    block->nodes[head].prevFree = nodeIndex;
+  }
+  block->freeLists[firstLevel][secondLevel] = nodeIndex;
+  block->firstLevelBitmap |= 1ull << firstLevel;
+  block->secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+}
+
+internal_access void removeFreeNode(GpuMemoryBlock* block, u32 nodeIndex) {
+  TlsfNode& node = block->nodes[nodeIndex];
+  u32 firstLevel, secondLevel;
+  tlsfMapping(node.size, &firstLevel, &secondLevel);
+
+  if (node.prevFree != TLSF_NULL_NODE) {
+    block->nodes[node.prevFree].nextFree = node.nextFree;
+  } else {
+    block->freeLists[firstLevel][secondLevel] = node.nextFree;
+    if (node.nextFree == TLSF_NULL_NODE) {
+      block->secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+      if (block->secondLevelBitmaps[firstLevel] == 0) {
+        block->firstLevelBitmap &= ~(1ull << firstLevel);
+      }
+    }
+  }
+  if (node.nextFree != TLSF_NULL_NODE) {
+    block->nodes[node.nextFree].prevFree = node.prevFree;
+  }
+  node.free = false;
+}
+
+// Splits the range [offset + size, end) off the node into a new free node following it
+internal_access void splitNode(GpuMemoryBlock* block, u32 nodeIndex, VkDeviceSize size) {
+  u32 remainderIndex = newNode(block); // may reallocate nodes, no references held across this call
+  TlsfNode& node = block->nodes[nodeIndex];
+  TlsfNode& remainder = block->nodes[remainderIndex];
+  remainder.offset = node.offset + size;
+  remainder.size = node.size - size;
+  remainder.prevPhysical = nodeIndex;
+  remainder.nextPhysical = node.nextPhysical;
+  if (node.nextPhysical != TLSF_NULL_NODE) {
+    block->nodes[node.nextPhysical].prevPhysical = remainderIndex;
+  }
+  node.nextPhysical = remainderIndex;
+  node.size = size;
+  insertFreeNode(block, remainderIndex);
+}
+
+// Merges the node following nodeIndex into it, both must be out of the free lists
+internal_access void mergeWithNext(GpuMemoryBlock* block, u32 nodeIndex) {
+  TlsfNode& node = block->nodes[nodeIndex];
+  u32 nextIndex = node.nextPhysical;
+  TlsfNode& next = block->nodes[nextIndex];
+  node.size += next.size;
+  node.nextPhysical = next.nextPhysical;
+  if (next.nextPhysical != TLSF_NULL_NODE) {
+    block->nodes[next.nextPhysical].prevPhysical = nodeIndex;
+  }
+  block->unusedNodes.push_back(nextIndex);
+}
+
+/*
+ * - Find a free range in the first non-empty size class that fits size plus worst case alignment padding
+ * - Split off alignment padding in front and any large enough remainder behind as free ranges
+ */
+internal_access u32 tlsfAllocate(GpuMemoryBlock* block, VkDeviceSize size, VkDeviceSize alignment) {
+  u32 firstLevel, secondLevel;
+  tlsfMapping(tlsfRoundUpSize(size + alignment - 1), &firstLevel, &secondLevel);
+  if (firstLevel >= TLSF_FIRST_LEVEL_COUNT) {
+    return TLSF_NULL_NODE;
+  }
+
+  u32 secondLevelBitmap = block->secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+  if (secondLevelBitmap == 0) {
+    u64 firstLevelBitmap = block->firstLevelBitmap & (~0ull << (firstLevel + 1));
+    if (firstLevelBitmap == 0) {
+      return TLSF_NULL_NODE;
+    }
+    firstLevel = lowestSetBit(firstLevelBitmap);
+    secondLevelBitmap = block->secondLevelBitmaps[firstLevel];
+  }
+  secondLevel = lowestSetBit(secondLevelBitmap);
+
+  u32 nodeIndex = block->freeLists[firstLevel][secondLevel];
+  removeFreeNode(block, nodeIndex);
+
+  VkDeviceSize padding = alignUp(block->nodes[nodeIndex].offset, alignment) - block->nodes[nodeIndex].offset;
+  if (padding > 0) {
+    splitNode(block, nodeIndex, padding);
+    u32 alignedIndex = block->nodes[nodeIndex].nextPhysical;
+    removeFreeNode(block, alignedIndex);
+    insertFreeNode(block, nodeIndex); // padding stays free, coalesced again once a neighbour is freed
+    nodeIndex = alignedIndex;
+  }
+
+  if (block->nodes[nodeIndex].size - size >= TLSF_MIN_SPLIT_SIZE) {
+    splitNode(block, nodeIndex, size);
+  }
+  return nodeIndex;
+}
+
+internal_access void tlsfFree(GpuMemoryBlock* block, u32 nodeIndex) {
+  u32 nextIndex = block->nodes[nodeIndex].nextPhysical;
+  if (nextIndex != TLSF_NULL_NODE && block->nodes[nextIndex].free) {
+    removeFreeNode(block, nextIndex);
+    mergeWithNext(block, nodeIndex);
+  }
+  u32 prevIndex = block->nodes[nodeIndex].prevPhysical;
+  if (prevIndex != TLSF_NULL_NODE && block->nodes[prevIndex].free) {
+    removeFreeNode(block, prevIndex);
+    mergeWithNext(block, prevIndex);
+    nodeIndex = prevIndex;
+  }
+  insertFreeNode(block, nodeIndex);
+}
+
+internal_access VkDeviceMemory allocateDeviceMemory(GpuMemoryAllocator* allocator, VkDeviceSize size, u32 memoryTypeIndex,
+                                                    const void* pNext, u8** mapped) {
+  VkMemoryAllocateInfo memAllocInfo{};
+  memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  memAllocInfo.pNext = pNext;
+  memAllocInfo.allocationSize = size;
+  memAllocInfo.memoryTypeIndex = memoryTypeIndex;
+
+  VkDeviceMemory memory;
+  if (vkAllocateMemory(allocator->device, &memAllocInfo, nullptr, &memory) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate device memory!");
+  }
+
+  *mapped = nullptr;
+  if (allocator->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    if (vkMapMemory(allocator->device, memory, 0, VK_WHOLE_SIZE, 0, (void**)mapped) != VK_SUCCESS) {
+      vkFreeMemory(allocator->device, memory, nullptr);
+      throw std::runtime_error("failed to map device memory!");
+    }
+  }
+  return memory;
+}
+
+internal_access GpuMemoryBlock* createBlock(GpuMemoryAllocator* allocator, u32 memoryTypeIndex, GpuResourceTiling tiling) {
+  GpuMemoryBlock* block = new GpuMemoryBlock();
+  block->memory = allocateDeviceMemory(allocator, allocator->blockSize, memoryTypeIndex, nullptr, &block->mapped);
+  block->size = allocator->blockSize;
+  block->memoryTypeIndex = memoryTypeIndex;
+  block->tiling = tiling;
+  block->usedBytes = 0;
+  block->allocationCount = 0;
+  block->firstLevelBitmap = 0;
+  for (u32 firstLevel = 0; firstLevel < TLSF_FIRST_LEVEL_COUNT; ++firstLevel) {
+    block->secondLevelBitmaps[firstLevel] = 0;
+    for (u32 secondLevel = 0; secondLevel < TLSF_SECOND_LEVEL_COUNT; ++secondLevel) {
+      block->freeLists[firstLevel][secondLevel] = TLSF_NULL_NODE;
+    }
+  }
+
+  u32 nodeIndex = newNode(block);
+  block->nodes[nodeIndex].offset = 0;
+  block->nodes[nodeIndex].size = block->size;
+  block->nodes[nodeIndex].prevPhysical = TLSF_NULL_NODE;
+  block->nodes[nodeIndex].nextPhysical = TLSF_NULL_NODE;
+  insertFreeNode(block, nodeIndex);
+  return block;
+}
+
+internal_access void destroyBlock(GpuMemoryAllocator* allocator, GpuMemoryBlock* block) {
+  vkFreeMemory(allocator->device, block->memory, nullptr); // implicitly unmapped
+  delete block;
+}
+
+void initGpuMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize blockSize, GpuMemoryAllocator* allocator) {
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &allocator->memoryProperties);
+
+  allocator->device = device;
+  allocator->bufferImageGranularity = deviceProperties.limits.bufferImageGranularity;
+  allocator->blockSize = blockSize;
+  allocator->dedicatedRequirementsSupported = deviceProperties.apiVersion >= VK_API_VERSION_1_1;
+  allocator->dedicatedAllocationCount = 0;
+  allocator->dedicatedBytes = 0;
+}
+
+void destroyGpuMemoryAllocator(GpuMemoryAllocator* allocator) {
+  Assert(allocator->dedicatedAllocationCount == 0);
+  for (u32 memoryTypeIndex = 0; memoryTypeIndex < VK_MAX_MEMORY_TYPES; ++memoryTypeIndex) {
+    for (GpuMemoryBlock* block : allocator->blocks[memoryTypeIndex]) {
+      Assert(block->allocationCount == 0);
+      destroyBlock(allocator, block);
+    }
+    allocator->blocks[memoryTypeIndex].clear();
+  }
+}
+
+/*
+ * - Resources the driver prefers or requires to be dedicated, or larger than half a block, get their own allocation
+ * - Otherwise sub-allocate from the first block of the memory type with room, creating a new block if none has
+ * - When bufferImageGranularity is larger than one, linear and optimal resources are kept in separate blocks so that
+ *   they never share a granularity page, no padding between neighbours required
+ */
+internal_access GpuAllocation allocate(GpuMemoryAllocator* allocator, const VkMemoryRequirements& memReqs, VkMemoryPropertyFlags properties,
+                                       GpuResourceTiling tiling, bool32 dedicated, const VkMemoryDedicatedAllocateInfo* dedicatedAllocateInfo) {
+  u32 memoryTypeIndex = getMemoryTypeIndex(&allocator->memoryProperties, memReqs.memoryTypeBits, properties);
+  GpuAllocation allocation{};
+
+  if (dedicated || memReqs.size > allocator->blockSize / 2) {
+    allocation.memory = allocateDeviceMemory(allocator, memReqs.size, memoryTypeIndex, dedicatedAllocateInfo, &allocation.mapped);
+    allocation.offset = 0;
+    allocation.size = memReqs.size;
+    allocation.block = nullptr;
+    allocation.node = TLSF_NULL_NODE;
+
+    std::lock_guard<std::mutex> lock(allocator->mutex);
+    allocator->dedicatedAllocationCount++;
+    allocator->dedicatedBytes += memReqs.size;
+    return allocation;
+  }
+
+  GpuResourceTiling blockTiling = allocator->bufferImageGranularity > 1 ? tiling : GPU_RESOURCE_TILING_LINEAR;
+
+  std::lock_guard<std::mutex> lock(allocator->mutex);
+  std::vector<GpuMemoryBlock*>& blocks = allocator->blocks[memoryTypeIndex];
+  GpuMemoryBlock* block = nullptr;
+  u32 nodeIndex = TLSF_NULL_NODE;
+  for (GpuMemoryBlock* candidate : blocks) {
+    if (candidate->tiling == blockTiling) {
+      nodeIndex = tlsfAllocate(candidate, memReqs.size, memReqs.alignment);
+      if (nodeIndex != TLSF_NULL_NODE) {
+        block = candidate;
+        break;
+      }
+    }
+  }
+
+  if (block == nullptr) {
+    block = createBlock(allocator, memoryTypeIndex, blockTiling);
+    blocks.push_back(block);
+    nodeIndex = tlsfAllocate(block, memReqs.size, memReqs.alignment);
+    Assert(nodeIndex != TLSF_NULL_NODE);
+  }
+
+  block->usedBytes += memReqs.size;
+  block->allocationCount++;
+
+  allocation.memory = block->memory;
+  allocation.offset = block->nodes[nodeIndex].offset;
+  allocation.size = memReqs.size;
+  allocation.mapped = block->mapped != nullptr ? block->mapped + allocation.offset : nullptr;
+  allocation.block = block;
+  allocation.node = nodeIndex;
+  return allocation;
+}
+
+VkBuffer createBuffer(VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage) {
+  VkBufferCreateInfo bufferCI{};
+  bufferCI.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferCI.size = size;
+  bufferCI.usage = usage;
+  bufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  VkBuffer buffer;
+  if (vkCreateBuffer(device, &bufferCI, nullptr, &buffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create buffer!");
+  }
+  return buffer;
+}
+
+GpuAllocation allocateBufferMemory(GpuMemoryAllocator* allocator, VkBuffer buffer, VkMemoryPropertyFlags properties) {
+  VkMemoryRequirements memReqs;
+  bool32 dedicated = false;
+  if (allocator->dedicatedRequirementsSupported) {
+    VkMemoryDedicatedRequirements dedicatedReqs{};
+    dedicatedReqs.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+    VkMemoryRequirements2 memReqs2{};
+    memReqs2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    memReqs2.pNext = &dedicatedReqs;
+    VkBufferMemoryRequirementsInfo2 memReqsInfo{};
+    memReqsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+    memReqsInfo.buffer = buffer;
+    vkGetBufferMemoryRequirements2(allocator->device, &memReqsInfo, &memReqs2);
+    memReqs = memReqs2.memoryRequirements;
+    dedicated = dedicatedReqs.prefersDedicatedAllocation || dedicatedReqs.requiresDedicatedAllocation;
+  } else {
+    vkGetBufferMemoryRequirements(allocator->device, buffer, &memReqs);
+  }
+
+  VkMemoryDedicatedAllocateInfo dedicatedAllocateInfo{};
+  dedicatedAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+  dedicatedAllocateInfo.buffer = buffer;
+
+  GpuAllocation allocation = allocate(allocator, memReqs, properties, GPU_RESOURCE_TILING_LINEAR, dedicated,
+                                      dedicated ? &dedicatedAllocateInfo : nullptr);
+  if (vkBindBufferMemory(allocator->device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+    freeGpuMemory(allocator, &allocation);
+    throw std::runtime_error("failed to bind buffer memory!");
+  }
+  return allocation;
+}
+
+GpuAllocation allocateImageMemory(GpuMemoryAllocator* allocator, VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags properties) {
+  VkMemoryRequirements memReqs;
+  bool32 dedicated = false;
+  if (allocator->dedicatedRequirementsSupported) {
+    VkMemoryDedicatedRequirements dedicatedReqs{};
+    dedicatedReqs.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+    VkMemoryRequirements2 memReqs2{};
+    memReqs2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    memReqs2.pNext = &dedicatedReqs;
+    VkImageMemoryRequirementsInfo2 memReqsInfo{};
+    memReqsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+    memReqsInfo.image = image;
+    vkGetImageMemoryRequirements2(allocator->device, &memReqsInfo, &memReqs2);
+    memReqs = memReqs2.memoryRequirements;
+    dedicated = dedicatedReqs.prefersDedicatedAllocation || dedicatedReqs.requiresDedicatedAllocation;
+  } else {
+    vkGetImageMemoryRequirements(allocator->device, image, &memReqs);
+  }
+
+  VkMemoryDedicatedAllocateInfo dedicatedAllocateInfo{};
+  dedicatedAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+  dedicatedAllocateInfo.image = image;
+
+  GpuResourceTiling resourceTiling = tiling == VK_IMAGE_TILING_LINEAR ? GPU_RESOURCE_TILING_LINEAR : GPU_RESOURCE_TILING_OPTIMAL;
+  GpuAllocation allocation = allocate(allocator, memReqs, properties, resourceTiling, dedicated,
+                                      dedicated ? &dedicatedAllocateInfo : nullptr);
+  if (vkBindImageMemory(allocator->device, image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+    freeGpuMemory(allocator, &allocation);
+    throw std::runtime_error("failed to bind image memory!");
+  }
+  return allocation;
+}
+
+/*
+ * - Dedicated allocations are returned to the driver
+ * - Sub-allocations are coalesced with free neighbours. Empty blocks are released, except for the last block of a
+ *   memory type which is kept to avoid reallocating it when resources are repeatedly created and destroyed
+ */
+void freeGpuMemory(GpuMemoryAllocator* allocator, GpuAllocation* allocation) {
+  if (allocation->memory == VK_NULL_HANDLE) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(allocator->mutex);
+  GpuMemoryBlock* block = allocation->block;
+  if (block == nullptr) {
+    vkFreeMemory(allocator->device, allocation->memory, nullptr);
+    allocator->dedicatedAllocationCount--;
+    allocator->dedicatedBytes -= allocation->size;
+    *allocation = {};
+    return;
+  }
+
+  tlsfFree(block, allocation->node);
+  block->usedBytes -= allocation->size;
+  block->allocationCount--;
+  *allocation = {};
+
+  std::vector<GpuMemoryBlock*>& blocks = allocator->blocks[block->memoryTypeIndex];
+  if (block->allocationCount == 0 && blocks.size() > 1) {
+    for (size_t i = 0; i < blocks.size(); ++i) {
+      if (blocks[i] == block) {
+        blocks.erase(blocks.begin() + i);
+        break;
+      }
+    }
+    destroyBlock(allocator, block);
+  }
+}
+
+GpuMemoryStats getGpuMemoryStats(GpuMemoryAllocator* allocator) {
+  std::lock_guard<std::mutex> lock(allocator->mutex);
+  GpuMemoryStats stats{};
+  stats.dedicatedAllocationCount = allocator->dedicatedAllocationCount;
+  stats.allocationCount = allocator->dedicatedAllocationCount;
+  stats.bytesAllocated = allocator->dedicatedBytes;
+  stats.bytesUsed = allocator->dedicatedBytes;
+
+  VkDeviceSize freeBytes = 0;
+  VkDeviceSize contiguousFreeBytes = 0;
+  for (u32 memoryTypeIndex = 0; memoryTypeIndex < VK_MAX_MEMORY_TYPES; ++memoryTypeIndex) {
+    for (GpuMemoryBlock* block : allocator->blocks[memoryTypeIndex]) {
+      stats.blockCount++;
+      stats.allocationCount += block->allocationCount;
+      stats.bytesAllocated += block->size;
+      stats.bytesUsed += block->usedBytes;
+      // node 0 is always the range at offset 0, coalescing only ever releases the later of two nodes
+      VkDeviceSize largestFreeRange = 0;
+      for (u32 nodeIndex = 0; nodeIndex != TLSF_NULL_NODE; nodeIndex = block->nodes[nodeIndex].nextPhysical) {
+        const TlsfNode& node = block->nodes[nodeIndex];
+        if (node.free) {
+          freeBytes += node.size;
+          largestFreeRange = node.size > largestFreeRange ? node.size : largestFreeRange;
+        }
+      }
+      contiguousFreeBytes += largestFreeRange;
+      stats.largestFreeRange = largestFreeRange > stats.largestFreeRange ? largestFreeRange : stats.largestFreeRange;
+    }
+  }
+  stats.fragmentation = freeBytes > 0 ? 1.0 - (f64)contiguousFreeBytes / freeBytes : 0.0;
+  return stats;
+}
+
+void printGpuMemoryStats(GpuMemoryAllocator* allocator) {
+  GpuMemoryStats stats = getGpuMemoryStats(allocator);
+  std::cout << "gpu memory: " << stats.allocationCount << " allocations, " << stats.bytesUsed << " bytes used of "
+            << stats.bytesAllocated << " allocated (" << stats.blockCount << " blocks, " << stats.dedicatedAllocationCount
+            << " dedicated), fragmentation " << stats.fragmentation * 100.0 << "%" << std::endl;
+}
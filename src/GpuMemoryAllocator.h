@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <vector>
+#include <mutex>
+#include "KuringTypes.h"
+
+const VkDeviceSize DEFAULT_GPU_MEMORY_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+// TLSF (two-level segregated fit) size classes: sizes are split by power of two (first level), and each power of two
+// range is split linearly into TLSF_SECOND_LEVEL_COUNT classes (second level). Sizes below 2^TLSF_SMALL_SIZE_LOG2 share the
+// first first-level range.
+const u32 TLSF_SECOND_LEVEL_LOG2 = 5;
+const u32 TLSF_SECOND_LEVEL_COUNT = 1 << TLSF_SECOND_LEVEL_LOG2;
+const u32 TLSF_SMALL_SIZE_LOG2 = 8;
+const u32 TLSF_FIRST_LEVEL_COUNT = 40 - TLSF_SMALL_SIZE_LOG2 + 1; // blocks up to 1 TiB
+const u32 TLSF_NULL_NODE = U32_MAX;
+
+// Resources with linear (buffers, linear images) and optimal tiling may not share a bufferImageGranularity sized page
+enum GpuResourceTiling {
+  GPU_RESOURCE_TILING_LINEAR,
+  GPU_RESOURCE_TILING_OPTIMAL
+};
+
+// Contiguous range of a memory block, either free or sub-allocated
+struct TlsfNode {
+  VkDeviceSize offset;
+  VkDeviceSize size;
+  u32 prevPhysical; // neighbouring ranges by offset
+  u32 nextPhysical;
+  u32 prevFree; // free list of the node's size class, only valid while free
+  u32 nextFree;
+  bool32 free;
+};
+
+// Single vkAllocateMemory allocation, sub-allocated with TLSF. O(1) allocation and free, with immediate coalescing.
+struct GpuMemoryBlock {
+  VkDeviceMemory memory;
+  VkDeviceSize size;
+  u8* mapped; // host visible blocks are persistently mapped
+  u32 memoryTypeIndex;
+  GpuResourceTiling tiling;
+  VkDeviceSize usedBytes;
+  u32 allocationCount;
+  std::vector<TlsfNode> nodes;
+  std::vector<u32> unusedNodes; // indices of nodes released by coalescing, reused before growing nodes
+  u64 firstLevelBitmap; // bit set when any second level class of that first level has a free node
+  u32 secondLevelBitmaps[TLSF_FIRST_LEVEL_COUNT];
+  u32 freeLists[TLSF_FIRST_LEVEL_COUNT][TLSF_SECOND_LEVEL_COUNT];
+};
+
+struct GpuAllocation {
+  VkDeviceMemory memory;
+  VkDeviceSize offset;
+  VkDeviceSize size;
+  u8* mapped; // address of offset when the memory is host visible, null otherwise
+  GpuMemoryBlock* block; // null for dedicated allocations
+  u32 node;
+};
+
+// Device memory allocator keeping a list of large blocks per memory type and sub-allocating resources from them,
+// so that the number of vkAllocateMemory calls (bounded by maxMemoryAllocationCount, and slow) stays small.
+// Resources the driver prefers or requires to be dedicated, and resources larger than half a block, get their own
+// allocation instead. Safe to use from multiple threads.
+struct GpuMemoryAllocator {
+  VkDevice device;
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  VkDeviceSize bufferImageGranularity;
+  VkDeviceSize blockSize;
+  bool32 dedicatedRequirementsSupported; // vkGet*MemoryRequirements2 and VkMemoryDedicatedRequirements (Vulkan 1.1)
+  std::mutex mutex;
+  std::vector<GpuMemoryBlock*> blocks[VK_MAX_MEMORY_TYPES];
+  u32 dedicatedAllocationCount;
+  VkDeviceSize dedicatedBytes;
+};
+
+struct GpuMemoryStats {
+  u32 blockCount;
+  u32 dedicatedAllocationCount;
+  u32 allocationCount; // sub-allocations and dedicated allocations
+  VkDeviceSize bytesAllocated; // device memory allocated from the driver
+  VkDeviceSize bytesUsed;
+  VkDeviceSize largestFreeRange;
+  f64 fragmentation; // 1 - sum of each block's largest free range / free bytes, zero when every block's free space is contiguous
+};
+
+void initGpuMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize blockSize, GpuMemoryAllocator* allocator);
+// NOTE: Every allocation must have been freed
+void destroyGpuMemoryAllocator(GpuMemoryAllocator* allocator);
+
+// Exclusive to one queue family at a time, ownership transfers (ex: from the UploadQueue) are explicit. Memory is
+// allocated separately with allocateBufferMemory.
+VkBuffer createBuffer(VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage);
+// Allocate memory with the required properties (ex: DEVICE_LOCAL) for the resource and bind it
+GpuAllocation allocateBufferMemory(GpuMemoryAllocator* allocator, VkBuffer buffer, VkMemoryPropertyFlags properties);
+GpuAllocation allocateImageMemory(GpuMemoryAllocator* allocator, VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags properties);
+// NOTE: The resource bound to the allocation must be destroyed, or no longer in use by the GPU
+void freeGpuMemory(GpuMemoryAllocator* allocator, GpuAllocation* allocation);
+
+GpuMemoryStats getGpuMemoryStats(GpuMemoryAllocator* allocator);
+void printGpuMemoryStats(GpuMemoryAllocator* allocator);
@@ -0,0 +1,178 @@
+#include "GpuQueries.h"
+
+#include <stdexcept>
+
+const char* GPU_PIPELINE_STATISTIC_NAMES[GPU_PIPELINE_STATISTICS_COUNT] = {
+  "input assembly vertices",
+  "vertex shader invocations",
+  "clipping primitives",
+  "fragment shader invocations"
+};
+
+/*
+ * - Timestamps are supported if the graphics queue family has valid timestamp bits
+ * - Create a timestamp query pool per frame in flight and, when enabled, a pipeline statistics query pool
+ * NOTE: Pipeline statistics require the pipelineStatisticsQuery device feature to have been enabled
+ */
+void initGpuQueries(VkDevice device, VkPhysicalDevice physicalDevice, u32 graphicsQueueFamilyIndex, u32 frameCount,
+                    bool32 enablePipelineStatistics, GpuQueries* queries) {
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+  u32 queueFamilyCount;
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+  VkQueueFamilyProperties* queueFamilies = new VkQueueFamilyProperties[queueFamilyCount];
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies);
+  u32 timestampValidBits = queueFamilies[graphicsQueueFamilyIndex].timestampValidBits;
+  delete[] queueFamilies;
+
+  queries->timestampsSupported = timestampValidBits > 0 && deviceProperties.limits.timestampPeriod > 0.0f;
+  queries->timestampPeriodNanoseconds = deviceProperties.limits.timestampPeriod;
+  queries->timestampMask = timestampValidBits >= 64 ? ~0ull : ((1ull << timestampValidBits) - 1);
+  queries->frameCount = frameCount;
+  queries->frames = new GpuFrameQueries[frameCount];
+  queries->latest = {};
+  queries->latest.frameNumber = UINT64_MAX;
+
+  VkQueryPoolCreateInfo timestampPoolCI{};
+  timestampPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  timestampPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  timestampPoolCI.queryCount = MAX_GPU_TIMESTAMPS;
+
+  VkQueryPoolCreateInfo pipelineStatisticsPoolCI{};
+  pipelineStatisticsPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  pipelineStatisticsPoolCI.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+  pipelineStatisticsPoolCI.queryCount = 1;
+  pipelineStatisticsPoolCI.pipelineStatistics = GPU_PIPELINE_STATISTICS;
+
+  for (u32 i = 0; i < frameCount; ++i) {
+    GpuFrameQueries* frame = &queries->frames[i];
+    *frame = {};
+    frame->timestampPool = VK_NULL_HANDLE;
+    frame->pipelineStatisticsPool = VK_NULL_HANDLE;
+
+    if (queries->timestampsSupported &&
+        vkCreateQueryPool(device, &timestampPoolCI, nullptr, &frame->timestampPool) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create timestamp query pool!");
+    }
+
+    if (enablePipelineStatistics &&
+        vkCreateQueryPool(device, &pipelineStatisticsPoolCI, nullptr, &frame->pipelineStatisticsPool) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create pipeline statistics query pool!");
+    }
+  }
+}
+
+void destroyGpuQueries(VkDevice device, GpuQueries* queries) {
+  for (u32 i = 0; i < queries->frameCount; ++i) {
+    if (queries->frames[i].timestampPool != VK_NULL_HANDLE) {
+      vkDestroyQueryPool(device, queries->frames[i].timestampPool, nullptr);
+    }
+    if (queries->frames[i].pipelineStatisticsPool != VK_NULL_HANDLE) {
+      vkDestroyQueryPool(device, queries->frames[i].pipelineStatisticsPool, nullptr);
+    }
+  }
+  delete[] queries->frames;
+  queries->frames = nullptr;
+}
+
+/*
+ * - Read back the queries previously written by the frame in flight, if any
+ * - Results are requested with availability rather than VK_QUERY_RESULT_WAIT_BIT, unavailable results are dropped
+ * - Timestamps are converted to durations between consecutive timestamps in milliseconds
+ */
+void readGpuQueryResults(VkDevice device, GpuQueries* queries, u32 frameIndex) {
+  GpuFrameQueries* frame = &queries->frames[frameIndex];
+  if (!frame->pending) {
+    return;
+  }
+  frame->pending = false;
+
+  GpuFrameResults results{};
+  results.frameNumber = frame->frameNumber;
+
+  if (frame->timestampCount > 0) {
+    u64 timestampsWithAvailability[MAX_GPU_TIMESTAMPS * 2];
+    VkResult result = vkGetQueryPoolResults(device, frame->timestampPool, 0, frame->timestampCount,
+                                            sizeof(timestampsWithAvailability), timestampsWithAvailability,
+                                            2 * sizeof(u64)/*stride*/,
+                                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (result != VK_SUCCESS) {
+      return;
+    }
+
+    u64 firstTimestamp = timestampsWithAvailability[0] & queries->timestampMask;
+    u64 previousTimestamp = firstTimestamp;
+    for (u32 i = 0; i < frame->timestampCount; ++i) {
+      if (timestampsWithAvailability[i * 2 + 1] == 0) {
+        return;
+      }
+      u64 timestamp = timestampsWithAvailability[i * 2] & queries->timestampMask;
+      results.timestampNames[i] = frame->timestampNames[i];
+      results.durationMilliseconds[i] = ((timestamp - previousTimestamp) & queries->timestampMask) * queries->timestampPeriodNanoseconds * 1.0e-6;
+      previousTimestamp = timestamp;
+    }
+    results.timestampCount = frame->timestampCount;
+    results.totalMilliseconds = ((previousTimestamp - firstTimestamp) & queries->timestampMask) * queries->timestampPeriodNanoseconds * 1.0e-6;
+  }
+
+  if (frame->pipelineStatisticsWritten) {
+    u64 statisticsWithAvailability[GPU_PIPELINE_STATISTICS_COUNT + 1];
+    VkResult result = vkGetQueryPoolResults(device, frame->pipelineStatisticsPool, 0, 1,
+                                            sizeof(statisticsWithAvailability), statisticsWithAvailability,
+                                            sizeof(statisticsWithAvailability)/*stride*/,
+                                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (result == VK_SUCCESS && statisticsWithAvailability[GPU_PIPELINE_STATISTICS_COUNT] != 0) {
+      for (u32 i = 0; i < GPU_PIPELINE_STATISTICS_COUNT; ++i) {
+        results.pipelineStatistics[i] = statisticsWithAvailability[i];
+      }
+      results.hasPipelineStatistics = true;
+    }
+  }
+
+  queries->latest = results;
+}
+
+const GpuFrameResults* getLatestGpuQueryResults(const GpuQueries* queries) {
+  return queries->latest.frameNumber != UINT64_MAX ? &queries->latest : nullptr;
+}
+
+void cmdResetGpuQueries(VkCommandBuffer commandBuffer, GpuQueries* queries, u32 frameIndex, u64 frameNumber) {
+  GpuFrameQueries* frame = &queries->frames[frameIndex];
+  if (frame->timestampPool != VK_NULL_HANDLE) {
+    vkCmdResetQueryPool(commandBuffer, frame->timestampPool, 0, MAX_GPU_TIMESTAMPS);
+  }
+  if (frame->pipelineStatisticsPool != VK_NULL_HANDLE) {
+    vkCmdResetQueryPool(commandBuffer, frame->pipelineStatisticsPool, 0, 1);
+  }
+  frame->frameNumber = frameNumber;
+  frame->timestampCount = 0;
+  frame->pipelineStatisticsWritten = false;
+  frame->pending = true;
+}
+
+// NOTE: Silently ignored when timestamps are unsupported or MAX_GPU_TIMESTAMPS have already been written this frame
+void cmdWriteGpuTimestamp(VkCommandBuffer commandBuffer, GpuQueries* queries, u32 frameIndex,
+                          VkPipelineStageFlagBits stage, const char* name) {
+  GpuFrameQueries* frame = &queries->frames[frameIndex];
+  if (frame->timestampPool == VK_NULL_HANDLE || frame->timestampCount == MAX_GPU_TIMESTAMPS) {
+    return;
+  }
+  vkCmdWriteTimestamp(commandBuffer, stage, frame->timestampPool, frame->timestampCount);
+  frame->timestampNames[frame->timestampCount++] = name;
+}
+
+void cmdBeginGpuPipelineStatistics(VkCommandBuffer commandBuffer, GpuQueries* queries, u32 frameIndex) {
+  GpuFrameQueries* frame = &queries->frames[frameIndex];
+  if (frame->pipelineStatisticsPool != VK_NULL_HANDLE) {
+    vkCmdBeginQuery(commandBuffer, frame->pipelineStatisticsPool, 0, 0/*flags*/);
+  }
+}
+
+void cmdEndGpuPipelineStatistics(VkCommandBuffer commandBuffer, GpuQueries* queries, u32 frameIndex) {
+  GpuFrameQueries* frame = &queries->frames[frameIndex];
+  if (frame->pipelineStatisticsPool != VK_NULL_HANDLE) {
+    vkCmdEndQuery(commandBuffer, frame->pipelineStatisticsPool, 0);
+    frame->pipelineStatisticsWritten = true;
+  }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include "KuringTypes.h"
+
+const u32 MAX_GPU_TIMESTAMPS = 16;
+
+// Pipeline statistics collected when enabled, results are returned in this (bit) order
+const VkQueryPipelineStatisticFlags GPU_PIPELINE_STATISTICS =
+        VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+const u32 GPU_PIPELINE_STATISTICS_COUNT = 4;
+extern const char* GPU_PIPELINE_STATISTIC_NAMES[GPU_PIPELINE_STATISTICS_COUNT];
+
+// Queries written by a single frame in flight
+struct GpuFrameQueries {
+  VkQueryPool timestampPool;
+  VkQueryPool pipelineStatisticsPool; // VK_NULL_HANDLE when pipeline statistics are disabled
+  u64 frameNumber; // frame that last wrote the queries
+  u32 timestampCount;
+  const char* timestampNames[MAX_GPU_TIMESTAMPS];
+  bool32 pipelineStatisticsWritten;
+  bool32 pending; // written and submitted, but not yet read back
+};
+
+// Read back results of a single frame
+// NOTE: durations[i] is the GPU time between timestamp i - 1 and i, durations[0] is always zero
+struct GpuFrameResults {
+  u64 frameNumber;
+  u32 timestampCount;
+  const char* timestampNames[MAX_GPU_TIMESTAMPS];
+  f64 durationMilliseconds[MAX_GPU_TIMESTAMPS];
+  f64 totalMilliseconds; // first to last timestamp
+  bool32 hasPipelineStatistics;
+  u64 pipelineStatistics[GPU_PIPELINE_STATISTICS_COUNT];
+};
+
+// Timestamp and pipeline statistics query pools, one set per frame in flight. Queries are recorded into the frame's
+// command buffer and read back once that frame's fence has been waited on, the next time the frame in flight is
+// reused. Results therefore lag frameCount frames behind and reading them never stalls.
+struct GpuQueries {
+  bool32 timestampsSupported;
+  f64 timestampPeriodNanoseconds;
+  u64 timestampMask; // valid bits of the graphics queue's timestamps
+  u32 frameCount;
+  GpuFrameQueries* frames;
+  GpuFrameResults latest; // most recently read back results, see getLatestGpuQueryResults
+};
+
+void initGpuQueries(VkDevice device, VkPhysicalDevice physicalDevice, u32 graphicsQueueFamilyIndex, u32 frameCount,
+                    bool32 enablePipelineStatistics, GpuQueries* queries);
+void destroyGpuQueries(VkDevice device, GpuQueries* queries);
+
+// NOTE: Only call once the frame in flight's fence has been waited on. Does not wait for unavailable results.
+void readGpuQueryResults(VkDevice device, GpuQueries* queries, u32 frameIndex);
+// Returns nullptr until the first results have been read back
+const GpuFrameResults* getLatestGpuQueryResults(const GpuQueries* queries);
+
+// Recorded outside of a render pass, at the start of the frame's command buffer
+void cmdResetGpuQueries(VkCommandBuffer commandBuffer, GpuQueries* queries, u32 frameIndex, u64 frameNumber);
+void cmdWriteGpuTimestamp(VkCommandBuffer commandBuffer, GpuQueries* queries, u32 frameIndex,
+                          VkPipelineStageFlagBits stage, const char* name);
+void cmdBeginGpuPipelineStatistics(VkCommandBuffer commandBuffer, GpuQueries* queries, u32 frameIndex);
+void cmdEndGpuPipelineStatistics(VkCommandBuffer commandBuffer, GpuQueries* queries, u32 frameIndex);
@@ -51,7 +51,6 @@ VK_LOGIC_OP_COPY, // logical operator
 };
 
 GraphicsPipelineBuilder::GraphicsPipelineBuilder(VkDevice logicalDevice, VkAllocationCallbacks* allocator) : logicalDevice(logicalDevice), allocator(allocator) {
-  // TODO: push constants
   pipelineLayoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipelineLayoutCI.pushConstantRangeCount = 0;
   pipelineLayoutCI.pPushConstantRanges = nullptr;
@@ -63,18 +62,28 @@ GraphicsPipelineBuilder::GraphicsPipelineBuilder(VkDevice logicalDevice, VkAlloc
   frontFace = defaultRasterizationCI.frontFace;
 }
 
+GraphicsPipelineBuilder::GraphicsPipelineBuilder(VkDevice logicalDevice, ShaderModuleCache* shaderModuleCache, VkAllocationCallbacks* allocator)
+  : GraphicsPipelineBuilder(logicalDevice, allocator) {
+  this->shaderModuleCache = shaderModuleCache;
+}
+
 GraphicsPipelineBuilder::~GraphicsPipelineBuilder()
 {
   deallocateShader(vertexShaderModule);
   deallocateShader(fragmentShaderModule);
-  delete[] vertexInputAttDescs;
+  delete[] dynamicStates;
+  delete[] pushConstantRanges;
 }
 
 void GraphicsPipelineBuilder::build(VkPipeline* outPipeline, VkPipelineLayout* outPipelineLayout)
 {
   verifyIntegrity();
 
+  VkSpecializationInfo vertexSpecialization = specializationInfo(vertexSpecializationConstants);
+  VkSpecializationInfo fragmentSpecialization = specializationInfo(fragmentSpecializationConstants);
   VkPipelineShaderStageCreateInfo shaderStages[] = { vertexShaderStageCI, fragmentShaderStageCI };
+  shaderStages[0].pSpecializationInfo = vertexSpecializationConstants.count > 0 ? &vertexSpecialization : nullptr;
+  shaderStages[1].pSpecializationInfo = fragmentSpecializationConstants.count > 0 ? &fragmentSpecialization : nullptr;
 
   // If no scissor, it is not an error. Simply set to the entire viewport.
   VkRect2D tmpScissor{};
@@ -85,12 +94,18 @@ void GraphicsPipelineBuilder::build(VkPipeline* outPipeline, VkPipelineLayout* o
     tmpScissor.extent = {(u32)viewport.width, (u32)viewport.height };
   }
 
+  // NOTE: The viewport/scissor count is still required when the viewport/scissor itself is dynamic
   VkPipelineViewportStateCreateInfo viewportCI{};
   viewportCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
   viewportCI.viewportCount = 1;
-  viewportCI.pViewports = &viewport;
+  viewportCI.pViewports = isDynamicState(VK_DYNAMIC_STATE_VIEWPORT) ? nullptr : &viewport;
   viewportCI.scissorCount = 1;
-  viewportCI.pScissors = &tmpScissor;
+  viewportCI.pScissors = isDynamicState(VK_DYNAMIC_STATE_SCISSOR) ? nullptr : &tmpScissor;
+
+  VkPipelineDynamicStateCreateInfo dynamicStateCI{};
+  dynamicStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamicStateCI.dynamicStateCount = dynamicStateCount;
+  dynamicStateCI.pDynamicStates = dynamicStates;
 
   if (vkCreatePipelineLayout(logicalDevice, &pipelineLayoutCI, allocator, outPipelineLayout) != VK_SUCCESS) {
     throw std::runtime_error("failed to create pipeline layout!");
@@ -101,6 +116,13 @@ void GraphicsPipelineBuilder::build(VkPipeline* outPipeline, VkPipelineLayout* o
   rasterizationCI.cullMode = cullMode;
   rasterizationCI.frontFace = frontFace;
 
+  VkPipelineVertexInputStateCreateInfo vertexInputStateCI{};
+  vertexInputStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+  vertexInputStateCI.vertexBindingDescriptionCount = vertexInputBindingCount;
+  vertexInputStateCI.pVertexBindingDescriptions = vertexInputBindingDescs;
+  vertexInputStateCI.vertexAttributeDescriptionCount = vertexInputAttCount;
+  vertexInputStateCI.pVertexAttributeDescriptions = vertexInputAttDescs;
+
   VkGraphicsPipelineCreateInfo pipelineCI{};
   pipelineCI.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
   pipelineCI.stageCount = ArrayCount(shaderStages);
@@ -112,14 +134,15 @@ void GraphicsPipelineBuilder::build(VkPipeline* outPipeline, VkPipelineLayout* o
   pipelineCI.pMultisampleState = &defaultMultisampleCI;
   pipelineCI.pDepthStencilState = nullptr;
   pipelineCI.pColorBlendState = &defaultColorBlend;
-  pipelineCI.pDynamicState = nullptr; // Can be used to dynamically modify the viewport, scissor, line width, stencil reference, etc.
+  pipelineCI.pDynamicState = dynamicStateCount > 0 ? &dynamicStateCI : nullptr; // Can be used to dynamically modify the viewport, scissor, line width, stencil reference, etc.
   pipelineCI.layout = *outPipelineLayout; // descriptor set layout and push constant info
   pipelineCI.renderPass = renderPass;
   pipelineCI.subpass = 0; // index of subpass in render pass where pipeline will be used
   pipelineCI.basePipelineHandle = VK_NULL_HANDLE;
   pipelineCI.basePipelineIndex = -1;
 
-  if (vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineCI, allocator, outPipeline) != VK_SUCCESS) {
+  if (vkCreateGraphicsPipelines(logicalDevice, pipelineCache, 1, &pipelineCI, allocator, outPipeline) != VK_SUCCESS) {
+    vkDestroyPipelineLayout(logicalDevice, *outPipelineLayout, allocator);
     throw std::runtime_error("failed to create pipeline!");
   }
 }
@@ -139,9 +162,19 @@ GraphicsPipelineBuilder& GraphicsPipelineBuilder::setFragmentShader(const char*
   return *this;
 }
 
+SpecializationConstants* GraphicsPipelineBuilder::stageSpecializationConstants(VkShaderStageFlagBits stage)
+{
+  switch(stage) {
+    case VK_SHADER_STAGE_VERTEX_BIT: return &vertexSpecializationConstants;
+    case VK_SHADER_STAGE_FRAGMENT_BIT: return &fragmentSpecializationConstants;
+    default: throw std::runtime_error("GraphicsPipelineBuilder error: specialization constants are only supported for the vertex and fragment stages!");
+  }
+}
+
 void GraphicsPipelineBuilder::deallocateShader(VkShaderModule& shaderModule)
 {
-  if(shaderModule != VK_NULL_HANDLE) {
+  // modules acquired from a shader module cache belong to the cache
+  if(shaderModule != VK_NULL_HANDLE && shaderModuleCache == nullptr) {
     vkDestroyShaderModule(logicalDevice, shaderModule, allocator);
     shaderModule = VK_NULL_HANDLE;
   }
@@ -151,24 +184,16 @@ GraphicsPipelineBuilder& GraphicsPipelineBuilder::setShader(const char* fileLoca
                                                             VkShaderModule& shaderModule,
                                                             VkPipelineShaderStageCreateInfo& shaderStageCreateInfo)
 {
-  u32 shaderSize;
-  readFile(fileLocation, &shaderSize, nullptr);
-  char* shaderFile = new char[shaderSize];
-  readFile(fileLocation, &shaderSize, shaderFile);
-
-  VkShaderModuleCreateInfo shaderModuleCI = {};
-  shaderModuleCI.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-  shaderModuleCI.codeSize = shaderSize;
-  shaderModuleCI.pCode = (const u32*) shaderFile; // Note: there may be concerns with data alignment
-  if(vkCreateShaderModule(logicalDevice, &shaderModuleCI, allocator, &shaderModule) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create shader module!");
+  if(shaderModuleCache != nullptr) {
+    shaderModule = acquireShaderModule(shaderModuleCache, fileLocation);
+  } else {
+    shaderModule = createShaderModule(logicalDevice, fileLocation, allocator);
   }
 
   shaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   shaderStageCreateInfo.stage = shaderStageFlag;
   shaderStageCreateInfo.module = shaderModule;
   shaderStageCreateInfo.pName = "main";
-  delete[] shaderFile;
   return *this;
 }
 
@@ -182,8 +207,22 @@ void GraphicsPipelineBuilder::verifyIntegrity()
   if(renderPass == VK_NULL_HANDLE) {
     throw std::runtime_error(errorTitle + "failed to supply render pass!");
   }
-  if(vertexInputAttDescs == nullptr) {
-    throw std::runtime_error(errorTitle + "failed to supply vertex attributes!");
+  if(inputAssemblyStateCI.sType != VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO) {
+    throw std::runtime_error(errorTitle + "failed to supply vertex attributes or primitive topology!");
+  }
+  for(u32 i = 0; i < vertexInputBindingCount; ++i) {
+    for(u32 j = i + 1; j < vertexInputBindingCount; ++j) {
+      if(vertexInputBindingDescs[i].binding == vertexInputBindingDescs[j].binding) {
+        throw std::runtime_error(errorTitle + "vertex binding points must be unique!");
+      }
+    }
+  }
+  for(u32 i = 0; i < vertexInputAttCount; ++i) {
+    for(u32 j = i + 1; j < vertexInputAttCount; ++j) {
+      if(vertexInputAttDescs[i].location == vertexInputAttDescs[j].location) {
+        throw std::runtime_error(errorTitle + "vertex attribute locations must be unique!");
+      }
+    }
   }
   if(vertexShaderModule == VK_NULL_HANDLE) {
     throw std::runtime_error(errorTitle + "failed to supply vertex shader!");
@@ -191,12 +230,44 @@ void GraphicsPipelineBuilder::verifyIntegrity()
   if(fragmentShaderModule == VK_NULL_HANDLE) {
     throw std::runtime_error(errorTitle + "failed to supply fragment shader!");
   }
-  if(viewport.width <= 0 || viewport.height <= 0) {
+  if(!isDynamicState(VK_DYNAMIC_STATE_VIEWPORT) && (viewport.width <= 0 || viewport.height <= 0)) {
     throw std::runtime_error(errorTitle + "failed to supply valid viewport!");
   }
+  for(u32 i = 0; i < pipelineLayoutCI.pushConstantRangeCount; ++i) {
+    const VkPushConstantRange& range = pushConstantRanges[i];
+    if(range.size == 0 || (range.size % 4) != 0 || (range.offset % 4) != 0) {
+      throw std::runtime_error(errorTitle + "push constant range offset and size must be non-zero multiples of 4!");
+    }
+    if(range.offset + range.size > MIN_GUARANTEED_PUSH_CONSTANTS_SIZE) {
+      throw std::runtime_error(errorTitle + "push constant range exceeds the guaranteed push constant size, use a uniform buffer!");
+    }
+  }
   if(scissor.extent.width < 0 || scissor.extent.height < 0) {
     throw std::runtime_error(errorTitle + "supplied invalid scissor!");
   }
+  if(!isDynamicState(VK_DYNAMIC_STATE_SCISSOR) && isDynamicState(VK_DYNAMIC_STATE_VIEWPORT) && scissor.extent.width == 0) {
+    throw std::runtime_error(errorTitle + "failed to supply scissor or dynamic scissor alongside dynamic viewport!");
+  }
+}
+
+bool32 GraphicsPipelineBuilder::isDynamicState(VkDynamicState dynamicState)
+{
+  for(u32 i = 0; i < dynamicStateCount; ++i) {
+    if(dynamicStates[i] == dynamicState) { return true; }
+  }
+  return false;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::setDynamicStates(const VkDynamicState* dynamicStates, u32 count)
+{
+  delete[] this->dynamicStates;
+
+  this->dynamicStates = new VkDynamicState[count];
+  for(u32 i = 0; i < count; ++i) {
+    this->dynamicStates[i] = dynamicStates[i];
+  }
+  dynamicStateCount = count;
+  return *this;
 }
 
 GraphicsPipelineBuilder& GraphicsPipelineBuilder::setScissor(s32 offsetX, s32 offsetY, u32 width, u32 height)
@@ -208,32 +279,42 @@ GraphicsPipelineBuilder& GraphicsPipelineBuilder::setScissor(s32 offsetX, s32 of
 
 GraphicsPipelineBuilder& GraphicsPipelineBuilder::setVertexAttributes(VertexAtt vertexAtt, u32 bindingPoint)
 {
-  vertexInputBindingDesc.binding = bindingPoint;
-  vertexInputBindingDesc.stride = vertexAtt.strideInBytes;
-  vertexInputBindingDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-  if(vertexInputAttDescs != nullptr) { delete[] vertexInputAttDescs; }
-
-  vertexInputAttDescs = new VkVertexInputAttributeDescription[vertexAtt.attributeCount];
-  for(u32 i = 0; i < vertexAtt.attributeCount; ++i) {
-    vertexInputAttDescs[i].binding = bindingPoint;
-    vertexInputAttDescs[i].location = i;
-    vertexInputAttDescs[i].format = vertexAtt.attributeFormat[i].format;
-    vertexInputAttDescs[i].offset = vertexAtt.attributeFormat[i].offsetInBytes;
-  }
-
-  vertexInputStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  vertexInputStateCI.vertexBindingDescriptionCount = 1;
-  vertexInputStateCI.pVertexBindingDescriptions = &vertexInputBindingDesc;
-  vertexInputStateCI.vertexAttributeDescriptionCount = vertexAtt.attributeCount;
-  vertexInputStateCI.pVertexAttributeDescriptions = vertexInputAttDescs;
+  vertexInputBindingCount = 0;
+  vertexInputAttCount = 0;
+  addVertexBinding(vertexAtt.attributeFormat, vertexAtt.attributeCount, vertexAtt.strideInBytes, bindingPoint, VK_VERTEX_INPUT_RATE_VERTEX, 0);
+  return setPrimitiveTopology(vertexAtt.primitiveTopology);
+}
 
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::setPrimitiveTopology(VkPrimitiveTopology primitiveTopology)
+{
   inputAssemblyStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-  inputAssemblyStateCI.topology = vertexAtt.primitiveTopology;
+  inputAssemblyStateCI.topology = primitiveTopology;
   inputAssemblyStateCI.primitiveRestartEnable = VK_FALSE;
   return *this;
 }
 
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::addVertexBinding(const VertexAttFormat* attributeFormats, u32 attributeCount, u32 strideInBytes,
+                                                                   u32 bindingPoint, VkVertexInputRate inputRate, u32 firstLocation)
+{
+  if(vertexInputBindingCount == MAX_VERTEX_INPUT_BINDINGS || vertexInputAttCount + attributeCount > MAX_VERTEX_INPUT_ATTRIBUTES) {
+    throw std::runtime_error("GraphicsPipelineBuilder error: exceeded the guaranteed vertex input binding or attribute count!");
+  }
+
+  VkVertexInputBindingDescription& bindingDesc = vertexInputBindingDescs[vertexInputBindingCount++];
+  bindingDesc.binding = bindingPoint;
+  bindingDesc.stride = strideInBytes;
+  bindingDesc.inputRate = inputRate;
+
+  for(u32 i = 0; i < attributeCount; ++i) {
+    VkVertexInputAttributeDescription& attDesc = vertexInputAttDescs[vertexInputAttCount++];
+    attDesc.binding = bindingPoint;
+    attDesc.location = firstLocation + i;
+    attDesc.format = attributeFormats[i].format;
+    attDesc.offset = attributeFormats[i].offsetInBytes;
+  }
+  return *this;
+}
+
 GraphicsPipelineBuilder&
 GraphicsPipelineBuilder::setViewport(f32 originX, f32 originY, f32 originZ, u32 width, u32 height,
                                      f32 depth)
@@ -255,22 +336,36 @@ GraphicsPipelineBuilder::setDescriptorSetLayouts(VkDescriptorSetLayout* descript
   return *this;
 }
 
+GraphicsPipelineBuilder&
+GraphicsPipelineBuilder::setPushConstantRanges(const VkPushConstantRange* pushConstantRanges, u32 count)
+{
+  delete[] this->pushConstantRanges;
+
+  this->pushConstantRanges = new VkPushConstantRange[count];
+  for(u32 i = 0; i < count; ++i) {
+    this->pushConstantRanges[i] = pushConstantRanges[i];
+  }
+  pipelineLayoutCI.pushConstantRangeCount = count;
+  pipelineLayoutCI.pPushConstantRanges = this->pushConstantRanges;
+  return *this;
+}
+
 GraphicsPipelineBuilder& GraphicsPipelineBuilder::
 setFrontFace(VkFrontFace frontFace)
 {
-  frontFace = VK_FRONT_FACE_CLOCKWISE;
+  this->frontFace = frontFace;
   return *this;
 }
 
 GraphicsPipelineBuilder& GraphicsPipelineBuilder::setCullMode(VkCullModeFlags cullModeFlags)
 {
-  cullModeFlags = VK_CULL_MODE_BACK_BIT;
+  cullMode = cullModeFlags;
   return *this;
 }
 
 GraphicsPipelineBuilder& GraphicsPipelineBuilder::setPolygonMode(VkPolygonMode polygonMode)
 {
-  polygonMode = VK_POLYGON_MODE_FILL;
+  this->polygonMode = polygonMode;
   return *this;
 }
 
@@ -278,4 +373,10 @@ GraphicsPipelineBuilder& GraphicsPipelineBuilder::setRenderPass(VkRenderPass ren
 {
   this->renderPass = renderPass;
   return *this;
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::setPipelineCache(VkPipelineCache pipelineCache)
+{
+  this->pipelineCache = pipelineCache;
+  return *this;
 }
\ No newline at end of file
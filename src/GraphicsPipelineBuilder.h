@@ -4,11 +4,19 @@
 #include "KuringTypes.h"
 #include "Util.h"
 #include "Models.h"
+#include "VulkanUtil.h"
+#include "ShaderModuleCache.h"
+
+// Minimums guaranteed by the spec for maxVertexInputBindings and maxVertexInputAttributes
+const u32 MAX_VERTEX_INPUT_BINDINGS = 16;
+const u32 MAX_VERTEX_INPUT_ATTRIBUTES = 16;
 
 class GraphicsPipelineBuilder {
 public:
 
   GraphicsPipelineBuilder(VkDevice logicalDevice, VkAllocationCallbacks* allocator = nullptr);
+  // Shader modules are acquired from (and owned by) the cache instead of being created per builder
+  GraphicsPipelineBuilder(VkDevice logicalDevice, ShaderModuleCache* shaderModuleCache, VkAllocationCallbacks* allocator = nullptr);
   ~GraphicsPipelineBuilder();
 
   GraphicsPipelineBuilder& setVertexShader(const char* fileLocation);
@@ -18,37 +26,67 @@ public:
   GraphicsPipelineBuilder& setCullMode(VkCullModeFlags cullModeFlags);
   GraphicsPipelineBuilder& setFrontFace(VkFrontFace frontFace);
   GraphicsPipelineBuilder& setDescriptorSetLayouts(VkDescriptorSetLayout* descriptorSetLayout, u32 count);
+  GraphicsPipelineBuilder& setPushConstantRanges(const VkPushConstantRange* pushConstantRanges, u32 count);
+  // Sets layout(constant_id = constantId) in the vertex or fragment shader, see SpecializationConstants
+  template<typename T>
+  GraphicsPipelineBuilder& setSpecializationConstant(VkShaderStageFlagBits stage, u32 constantId, T value) {
+    ::setSpecializationConstant(stageSpecializationConstants(stage), constantId, value);
+    return *this;
+  }
   GraphicsPipelineBuilder& setViewport(f32 originX, f32 originY, f32 originZ, u32 width, u32 height, f32 depth);
+  // Replaces every vertex binding with vertexAtt's, per vertex, its attributes at locations 0 to attributeCount - 1
   GraphicsPipelineBuilder& setVertexAttributes(VertexAtt vertexAtt, u32 bindingPoint);
+  // Adds a binding to the ones set by setVertexAttributes, its attributes at consecutive locations from firstLocation.
+  // VK_VERTEX_INPUT_RATE_INSTANCE bindings advance once per instance (ex: per instance transforms, see InstanceBuffer.h).
+  GraphicsPipelineBuilder& addVertexBinding(const VertexAttFormat* attributeFormats, u32 attributeCount, u32 strideInBytes,
+                                            u32 bindingPoint, VkVertexInputRate inputRate, u32 firstLocation);
+  // Without vertex attributes, for vertex shaders generating their vertices from gl_VertexIndex (ex: FullScreenTriangle.vert)
+  GraphicsPipelineBuilder& setPrimitiveTopology(VkPrimitiveTopology primitiveTopology);
   GraphicsPipelineBuilder& setScissor(s32 offsetX, s32 offsetY, u32 width, u32 height);
+  // NOTE: Dynamic state set here must be set with the matching vkCmdSet* command before drawing with the pipeline.
+  // Viewport and scissor need not be supplied to the builder when they are dynamic.
+  GraphicsPipelineBuilder& setDynamicStates(const VkDynamicState* dynamicStates, u32 count);
+  // NOTE: The cache is not owned by the builder. Optional, pipelines are compiled from scratch without one.
+  GraphicsPipelineBuilder& setPipelineCache(VkPipelineCache pipelineCache);
 
   void build(VkPipeline* outPipeline, VkPipelineLayout* outPipelineLayout);
 
 private:
   VkAllocationCallbacks* allocator = nullptr;
   VkDevice logicalDevice = VK_NULL_HANDLE;
+  ShaderModuleCache* shaderModuleCache = nullptr;
 
   VkPipelineShaderStageCreateInfo vertexShaderStageCI{};
   VkShaderModule vertexShaderModule = VK_NULL_HANDLE;
   VkPipelineShaderStageCreateInfo fragmentShaderStageCI{};
   VkShaderModule fragmentShaderModule = VK_NULL_HANDLE;
+  SpecializationConstants vertexSpecializationConstants{};
+  SpecializationConstants fragmentSpecializationConstants{};
 
-  VkVertexInputBindingDescription vertexInputBindingDesc{};
-  VkVertexInputAttributeDescription* vertexInputAttDescs = nullptr;
-  VkPipelineVertexInputStateCreateInfo vertexInputStateCI{};
+  VkVertexInputBindingDescription vertexInputBindingDescs[MAX_VERTEX_INPUT_BINDINGS]{};
+  u32 vertexInputBindingCount = 0;
+  VkVertexInputAttributeDescription vertexInputAttDescs[MAX_VERTEX_INPUT_ATTRIBUTES]{};
+  u32 vertexInputAttCount = 0;
   VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCI{};
   VkPipelineLayoutCreateInfo pipelineLayoutCI{};
+  VkPushConstantRange* pushConstantRanges = nullptr;
 
   VkViewport viewport{};
   VkRect2D scissor{};
 
+  VkDynamicState* dynamicStates = nullptr;
+  u32 dynamicStateCount = 0;
+
   VkPolygonMode polygonMode;
   VkCullModeFlags cullMode;
   VkFrontFace frontFace;
 
   VkRenderPass renderPass = VK_NULL_HANDLE;
+  VkPipelineCache pipelineCache = VK_NULL_HANDLE;
 
   void verifyIntegrity();
+  bool32 isDynamicState(VkDynamicState dynamicState);
+  SpecializationConstants* stageSpecializationConstants(VkShaderStageFlagBits stage);
   GraphicsPipelineBuilder& setShader(const char* fileLocation, VkShaderStageFlagBits shaderStageFlag, VkShaderModule& shaderModule, VkPipelineShaderStageCreateInfo& shaderStageCreateInfo);
   void deallocateShader(VkShaderModule& shaderModule);
 };
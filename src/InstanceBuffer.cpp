@@ -0,0 +1,33 @@
+#include "InstanceBuffer.h"
+
+#include <stdexcept>
+
+void initInstanceBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator, u32 capacity, InstanceBuffer* instanceBuffer) {
+  *instanceBuffer = {};
+  instanceBuffer->capacity = capacity;
+
+  // ownership is transferred from the transfer queue family
+  instanceBuffer->buffer = createBuffer(device, (VkDeviceSize)capacity * sizeof(InstanceAttDatum),
+                                        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+  instanceBuffer->memory = allocateBufferMemory(memoryAllocator, instanceBuffer->buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void destroyInstanceBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator, InstanceBuffer* instanceBuffer) {
+  vkDestroyBuffer(device, instanceBuffer->buffer, nullptr);
+  freeGpuMemory(memoryAllocator, &instanceBuffer->memory);
+  *instanceBuffer = {};
+}
+
+void uploadInstances(UploadQueue* uploadQueue, InstanceBuffer* instanceBuffer, const InstanceAttDatum* instances, u32 count) {
+  if (count > instanceBuffer->capacity) {
+    throw std::runtime_error("instance count exceeds the instance buffer capacity!");
+  }
+  uploadToBuffer(uploadQueue, instanceBuffer->buffer, 0, instances, (VkDeviceSize)count * sizeof(InstanceAttDatum),
+                 VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+  instanceBuffer->count = count;
+}
+
+void cmdBindInstanceBuffer(VkCommandBuffer commandBuffer, const InstanceBuffer& instanceBuffer, u32 bindingPoint) {
+  VkDeviceSize offset = 0;
+  vkCmdBindVertexBuffers(commandBuffer, bindingPoint, 1, &instanceBuffer.buffer, &offset);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include "KuringTypes.h"
+#include "Models.h"
+#include "GpuMemoryAllocator.h"
+#include "UploadQueue.h"
+
+// Device local buffer of InstanceAttDatum bound as a VK_VERTEX_INPUT_RATE_INSTANCE vertex binding, so that count copies
+// of a mesh with their own transform and color are drawn by a single vkCmdDrawIndexed (instanceCount = count).
+// Contents are uploaded on the transfer queue like vertex data, suited to instances that rarely change.
+struct InstanceBuffer {
+  VkBuffer buffer;
+  GpuAllocation memory;
+  u32 capacity; // in instances
+  u32 count; // instances uploaded, the instance count to draw
+};
+
+void initInstanceBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator, u32 capacity, InstanceBuffer* instanceBuffer);
+// NOTE: The buffer must no longer be in use by the GPU
+void destroyInstanceBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator, InstanceBuffer* instanceBuffer);
+// Replaces the instances, throws if count exceeds the capacity. The upload is submitted with the next submitUploads.
+// NOTE: Same as any upload, the buffer must not be in use by frames in flight
+void uploadInstances(UploadQueue* uploadQueue, InstanceBuffer* instanceBuffer, const InstanceAttDatum* instances, u32 count);
+void cmdBindInstanceBuffer(VkCommandBuffer commandBuffer, const InstanceBuffer& instanceBuffer, u32 bindingPoint);
@@ -0,0 +1,97 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+bool32 mapFile(const char* filePath, MappedFile* mappedFile) {
+  *mappedFile = {};
+  HANDLE fileHandle = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (fileHandle == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(fileHandle, &fileSize)) {
+    CloseHandle(fileHandle);
+    return false;
+  }
+
+  mappedFile->fileHandle = fileHandle;
+  mappedFile->size = (u64)fileSize.QuadPart;
+  if (mappedFile->size == 0) {
+    return true; // empty files can't be mapped
+  }
+
+  HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mappingHandle == nullptr) {
+    CloseHandle(fileHandle);
+    *mappedFile = {};
+    return false;
+  }
+
+  mappedFile->mappingHandle = mappingHandle;
+  mappedFile->data = (const u8*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+  if (mappedFile->data == nullptr) {
+    CloseHandle(mappingHandle);
+    CloseHandle(fileHandle);
+    *mappedFile = {};
+    return false;
+  }
+  return true;
+}
+
+void unmapFile(MappedFile* mappedFile) {
+  if (mappedFile->data != nullptr) { UnmapViewOfFile(mappedFile->data); }
+  if (mappedFile->mappingHandle != nullptr) { CloseHandle(mappedFile->mappingHandle); }
+  if (mappedFile->fileHandle != nullptr) { CloseHandle(mappedFile->fileHandle); }
+  *mappedFile = {};
+}
+
+#else
+
+bool32 mapFile(const char* filePath, MappedFile* mappedFile) {
+  *mappedFile = {};
+  mappedFile->fileDescriptor = open(filePath, O_RDONLY);
+  if (mappedFile->fileDescriptor < 0) {
+    return false;
+  }
+
+  struct stat fileStat;
+  if (fstat(mappedFile->fileDescriptor, &fileStat) != 0) {
+    unmapFile(mappedFile);
+    return false;
+  }
+
+  mappedFile->size = (u64)fileStat.st_size;
+  if (mappedFile->size == 0) {
+    return true; // empty files can't be mapped
+  }
+
+  void* data = mmap(nullptr, mappedFile->size, PROT_READ, MAP_PRIVATE, mappedFile->fileDescriptor, 0);
+  if (data == MAP_FAILED) {
+    unmapFile(mappedFile);
+    return false;
+  }
+  mappedFile->data = (const u8*)data;
+  return true;
+}
+
+void unmapFile(MappedFile* mappedFile) {
+  if (mappedFile->data != nullptr) {
+    munmap((void*)mappedFile->data, mappedFile->size);
+  }
+  if (mappedFile->fileDescriptor >= 0) {
+    close(mappedFile->fileDescriptor);
+  }
+  *mappedFile = {};
+}
+
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "KuringTypes.h"
+
+// Read only memory mapping of an entire file. Mappings are page aligned, so their contents may be reinterpreted as
+// any type with alignment up to the page size (ex: SPIR-V words) without copying.
+// Every member has a default, so a MappedFile that was never mapped is safe to unmap.
+struct MappedFile {
+  const u8* data = nullptr;
+  u64 size = 0;
+#if defined(_WIN32)
+  void* fileHandle = nullptr;
+  void* mappingHandle = nullptr;
+#else
+  int fileDescriptor = -1; // not 0 once reset with {}, which is a valid descriptor (stdin)
+#endif
+};
+
+// Returns false if the file can't be opened or mapped. Empty files map successfully with a null data pointer.
+// NOTE: unmapFile is safe to call on a mapping that failed, or on a MappedFile that was never mapped
+bool32 mapFile(const char* filePath, MappedFile* mappedFile);
+void unmapFile(MappedFile* mappedFile);
@@ -0,0 +1,110 @@
+#include "MeshFile.h"
+
+#include <stdexcept>
+#include <string>
+#include <stdint.h>
+
+internal_access bool32 isSectionValid(const MappedFile& file, u64 offset, u64 size) {
+  return offset % MESH_FILE_SECTION_ALIGNMENT == 0 && offset <= file.size && size <= file.size - offset;
+}
+
+// Index range within the index section, whole triangles, and every index plus vertexOffset within the vertex section
+template<typename Index>
+internal_access bool32 isSubmeshValid(const MeshFileSubmesh& submesh, const Index* indices, const MeshFileHeader& header) {
+  if (submesh.indexCount % 3 != 0 || submesh.firstIndex > header.indexCount ||
+      submesh.indexCount > header.indexCount - submesh.firstIndex) {
+    return false;
+  }
+  u32 maxIndex = 0;
+  for (u32 i = submesh.firstIndex; i < submesh.firstIndex + submesh.indexCount; ++i) {
+    maxIndex = indices[i] > maxIndex ? indices[i] : maxIndex;
+  }
+  s64 firstVertex = submesh.vertexOffset;
+  return submesh.indexCount == 0 || (firstVertex >= 0 && firstVertex + maxIndex < (s64)header.vertexCount);
+}
+
+template<typename Index>
+internal_access bool32 areSubmeshesValid(const MeshFileSubmesh* submeshes, u32 submeshCount, const u8* indexData, const MeshFileHeader& header) {
+  const Index* indices = (const Index*)indexData;
+  for (u32 i = 0; i < submeshCount; ++i) {
+    if (!isSubmeshValid(submeshes[i], indices, header)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Sections are aligned to MESH_FILE_SECTION_ALIGNMENT (see isSectionValid), which covers the submesh table and both index sizes
+static_assert(MESH_FILE_SECTION_ALIGNMENT % alignof(MeshFileSubmesh) == 0, "misaligned submesh table");
+static_assert(MESH_FILE_SECTION_ALIGNMENT % alignof(u32) == 0, "misaligned index data");
+
+/*
+ * - Map the whole file, the page aligned mapping satisfies the alignment of every section
+ * - Validate the header, that every section lies within the file and that every submesh only draws whole triangles
+ *   of vertices and indices within the file. Vertex and index sections must also fit VertexAtt's 32 bit sizes. Indices are scanned once here, so that no draw reads past the GPU buffers.
+ * - Point a VertexAtt at the vertex and index sections
+ */
+void loadMeshFile(const char* filePath, MeshFile* mesh) {
+  *mesh = {};
+  if (!mapFile(filePath, &mesh->file)) {
+    throw std::runtime_error(std::string("failed to open file:") + filePath);
+  }
+
+  const MeshFileHeader* header = (const MeshFileHeader*)mesh->file.data;
+  u64 vertexSectionSize = 0;
+  u64 indexSectionSize = 0;
+  if (mesh->file.size >= sizeof(MeshFileHeader)) {
+    vertexSectionSize = (u64)header->vertexCount * header->vertexStride;
+    indexSectionSize = (u64)header->indexCount * header->indexSize;
+  }
+  bool32 valid = mesh->file.size >= sizeof(MeshFileHeader) &&
+                 header->magic == MESH_FILE_MAGIC &&
+                 header->version == MESH_FILE_VERSION &&
+                 header->fileSize == mesh->file.size &&
+                 header->attributeCount > 0 && header->attributeCount <= MESH_FILE_MAX_ATTRIBUTES &&
+                 header->vertexStride > 0 && header->indexCount % 3 == 0 &&
+                 header->positionQuantization <= POSITION_QUANTIZATION_FLOAT16 &&
+                 (header->indexSize == sizeof(u16) || header->indexSize == sizeof(u32)) &&
+                 vertexSectionSize <= UINT32_MAX && indexSectionSize <= UINT32_MAX &&
+                 isSectionValid(mesh->file, header->vertexDataOffset, vertexSectionSize) &&
+                 isSectionValid(mesh->file, header->indexDataOffset, indexSectionSize) &&
+                 isSectionValid(mesh->file, header->submeshTableOffset, (u64)header->submeshCount * sizeof(MeshFileSubmesh));
+  if (valid) {
+    const MeshFileSubmesh* submeshes = (const MeshFileSubmesh*)(mesh->file.data + header->submeshTableOffset);
+    const u8* indexData = mesh->file.data + header->indexDataOffset;
+    valid = header->indexSize == sizeof(u16) ? areSubmeshesValid<u16>(submeshes, header->submeshCount, indexData, *header)
+                                             : areSubmeshesValid<u32>(submeshes, header->submeshCount, indexData, *header);
+  }
+  if (!valid) {
+    unmapFile(&mesh->file);
+    throw std::runtime_error(std::string("invalid mesh file:") + filePath);
+  }
+
+  mesh->header = header;
+  mesh->submeshes = (const MeshFileSubmesh*)(mesh->file.data + header->submeshTableOffset);
+  mesh->submeshCount = header->submeshCount;
+  for (u32 i = 0; i < header->attributeCount; ++i) {
+    mesh->attributes[i] = header->attributes[i];
+  }
+
+  VertexAtt* vertexAtt = &mesh->vertexAtt;
+  vertexAtt->strideInBytes = header->vertexStride;
+  vertexAtt->sizeInBytes = (u32)vertexSectionSize;
+  vertexAtt->attributeFormat = mesh->attributes;
+  vertexAtt->attributeCount = header->attributeCount;
+  vertexAtt->primitiveTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+  vertexAtt->data = (void*)(mesh->file.data + header->vertexDataOffset);
+  vertexAtt->indices.sizeInBytes = (u32)indexSectionSize;
+  vertexAtt->indices.count = header->indexCount;
+  vertexAtt->indices.type = header->indexSize == sizeof(u16) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+  vertexAtt->indices.data = (void*)(mesh->file.data + header->indexDataOffset);
+}
+
+void unloadMeshFile(MeshFile* mesh) {
+  unmapFile(&mesh->file);
+  mesh->header = nullptr;
+  mesh->submeshes = nullptr;
+  mesh->submeshCount = 0;
+  mesh->vertexAtt.data = nullptr;
+  mesh->vertexAtt.indices.data = nullptr;
+}
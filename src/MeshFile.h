@@ -0,0 +1,22 @@
+#pragma once
+
+#include "KuringTypes.h"
+#include "Models.h"
+#include "MappedFile.h"
+#include "MeshFormat.h"
+
+// Memory mapped .kmesh file. vertexAtt and submeshes point into the mapping, vertex and index data are uploaded by
+// copying straight from it (nothing is parsed or converted at load time).
+struct MeshFile {
+  MappedFile file;
+  const MeshFileHeader* header;
+  const MeshFileSubmesh* submeshes;
+  u32 submeshCount;
+  VertexAttFormat attributes[MESH_FILE_MAX_ATTRIBUTES]; // owned copy, outlives the mapping (ex: pipeline rebuilds)
+  VertexAtt vertexAtt;
+};
+
+// Maps and validates the file, throws if it can't be opened or isn't a valid .kmesh file
+void loadMeshFile(const char* filePath, MeshFile* mesh);
+// Unmaps the file. vertexAtt keeps its layout (strides, attributes) but its data pointers are cleared.
+void unloadMeshFile(MeshFile* mesh);
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "KuringTypes.h"
+#include "Models.h"
+#include "VertexQuantization.h"
+
+// On disk layout of .kmesh files, written offline by tools/MeshImporter and memory mapped at runtime (MeshFile.h).
+// Sections are stored exactly as they are uploaded, so loading is a validation of the header followed by copies
+// straight out of the mapping:
+//    MeshFileHeader | vertex data (vertexCount * vertexStride) | index data (indexCount * indexSize) | MeshFileSubmesh table
+// Every section starts at a multiple of MESH_FILE_SECTION_ALIGNMENT. Values are little endian.
+
+const u32 MESH_FILE_MAGIC = 0x48534D4B; // "KMSH"
+const u32 MESH_FILE_VERSION = 3; // 2: quantized vertices, 3: 16 bit indices
+const u32 MESH_FILE_MAX_ATTRIBUTES = 8;
+const u64 MESH_FILE_SECTION_ALIGNMENT = 16;
+
+struct MeshFileHeader {
+  u32 magic;
+  u32 version;
+  u32 vertexStride;
+  u32 attributeCount;
+  VertexAttFormat attributes[MESH_FILE_MAX_ATTRIBUTES]; // shader locations in order
+  u32 vertexCount;
+  u32 indexCount; // relative to their submesh's vertexOffset
+  u32 submeshCount;
+  u32 positionQuantization; // PositionQuantization of the position attribute
+  u32 indexSize; // 2 (VK_INDEX_TYPE_UINT16) when every submesh has fewer than 65536 vertices, 4 (VK_INDEX_TYPE_UINT32) otherwise
+  u32 reserved;
+  u64 vertexDataOffset; // from the start of the file
+  u64 indexDataOffset;
+  u64 submeshTableOffset;
+  u64 fileSize;
+  f32 boundsMin[3]; // of every vertex position
+  f32 boundsMax[3];
+  PositionDequantization positionDequantization; // decoded position * scale + offset, identity if not quantized
+};
+
+// Range of the index buffer drawn with a single vkCmdDrawIndexed, one per imported mesh
+struct MeshFileSubmesh {
+  u32 firstIndex;
+  u32 indexCount;
+  s32 vertexOffset; // added to each index
+  u32 materialIndex; // as imported, materials are not loaded yet
+};
+
+static_assert(sizeof(VertexAttFormat) == 8, "VertexAttFormat is stored in MeshFileHeader");
+static_assert(sizeof(MeshFileSubmesh) == 16, "MeshFileSubmesh layout is part of the file format");
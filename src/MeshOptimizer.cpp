@@ -0,0 +1,315 @@
+#include "MeshOptimizer.h"
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+// Forsyth's scoring favours vertices recently used (but not the last triangle's, which a strip-like order would reuse
+// anyway) and vertices with few triangles left, to finish off fans instead of leaving isolated triangles behind
+internal_access const u32 FORSYTH_CACHE_SIZE = 32;
+internal_access const f32 FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+internal_access const f32 FORSYTH_CACHE_DECAY_POWER = 1.5f;
+internal_access const f32 FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+internal_access const f32 FORSYTH_VALENCE_BOOST_POWER = -0.5f;
+
+internal_access f32 forsythVertexScore(s32 cachePosition, u32 remainingValence) {
+  if (remainingValence == 0) {
+    return -1.0f;
+  }
+  f32 score = 0.0f;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      score = FORSYTH_LAST_TRIANGLE_SCORE;
+    } else {
+      score = powf(1.0f - (f32)(cachePosition - 3) / (FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+    }
+  }
+  return score + FORSYTH_VALENCE_BOOST_SCALE * powf((f32)remainingValence, FORSYTH_VALENCE_BOOST_POWER);
+}
+
+// FIFO cache simulated with timestamps: a vertex is cached if fewer than cacheSize misses happened since its own miss
+struct FifoCache {
+  std::vector<u32> timestamps;
+  u32 timestamp;
+  u32 size;
+};
+
+internal_access void initFifoCache(u32 vertexCount, u32 cacheSize, FifoCache* cache) {
+  cache->timestamps.assign(vertexCount, 0);
+  cache->timestamp = cacheSize + 1;
+  cache->size = cacheSize;
+}
+
+internal_access void flushFifoCache(FifoCache* cache) {
+  cache->timestamp += cache->size + 1;
+}
+
+internal_access u32 fifoCacheTriangleMisses(FifoCache* cache, const u32* triangle) {
+  u32 misses = 0;
+  for (u32 i = 0; i < 3; ++i) {
+    u32 vertex = triangle[i];
+    if (cache->timestamp - cache->timestamps[vertex] > cache->size) {
+      cache->timestamps[vertex] = cache->timestamp++;
+      ++misses;
+    }
+  }
+  return misses;
+}
+
+VertexCacheStats analyzeVertexCache(const u32* indices, u32 indexCount, u32 vertexCount, u32 cacheSize) {
+  VertexCacheStats stats = {};
+  stats.triangleCount = indexCount / 3;
+  FifoCache cache;
+  initFifoCache(vertexCount, cacheSize, &cache);
+  std::vector<u8> referenced(vertexCount, 0);
+  for (u32 i = 0; i < stats.triangleCount * 3; i += 3) {
+    stats.cacheMisses += fifoCacheTriangleMisses(&cache, &indices[i]);
+    for (u32 j = 0; j < 3; ++j) {
+      stats.vertexCount += referenced[indices[i + j]] ? 0 : 1;
+      referenced[indices[i + j]] = 1;
+    }
+  }
+  return stats;
+}
+
+/*
+ * - Triangles adjacent to each vertex are kept in one array, emitted triangles are swap removed from their vertices
+ * - After each emitted triangle only the scores of vertices in the cache change, the next triangle is the best one
+ *   adjacent to the cache, or the next triangle not emitted yet in input order when the cache has none left
+ */
+void optimizeVertexCache(const u32* indices, u32 indexCount, u32 vertexCount, u32* optimizedIndices) {
+  u32 triangleCount = indexCount / 3;
+  std::vector<u32> valence(vertexCount, 0);
+  for (u32 i = 0; i < triangleCount * 3; ++i) {
+    ++valence[indices[i]];
+  }
+  std::vector<u32> adjacencyOffsets(vertexCount + 1, 0);
+  for (u32 vertex = 0; vertex < vertexCount; ++vertex) {
+    adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + valence[vertex];
+  }
+  std::vector<u32> adjacency(triangleCount * 3);
+  std::vector<u32> adjacencyCursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+  for (u32 i = 0; i < triangleCount * 3; ++i) {
+    adjacency[adjacencyCursor[indices[i]]++] = i / 3;
+  }
+
+  std::vector<s32> cachePosition(vertexCount, -1);
+  std::vector<f32> vertexScore(vertexCount);
+  for (u32 vertex = 0; vertex < vertexCount; ++vertex) {
+    vertexScore[vertex] = forsythVertexScore(-1, valence[vertex]);
+  }
+  std::vector<f32> triangleScore(triangleCount);
+  for (u32 triangle = 0; triangle < triangleCount; ++triangle) {
+    const u32* vertices = &indices[triangle * 3];
+    triangleScore[triangle] = vertexScore[vertices[0]] + vertexScore[vertices[1]] + vertexScore[vertices[2]];
+  }
+  std::vector<u8> emitted(triangleCount, 0);
+
+  u32 cache[FORSYTH_CACHE_SIZE + 3];
+  u32 cacheCount = 0;
+  u32 bestTriangle = UNUSED_VERTEX;
+  u32 inputCursor = 0;
+  for (u32 output = 0; output < triangleCount; ++output) {
+    if (bestTriangle == UNUSED_VERTEX) {
+      while (emitted[inputCursor]) {
+        ++inputCursor;
+      }
+      bestTriangle = inputCursor;
+    }
+    const u32* vertices = &indices[bestTriangle * 3];
+    optimizedIndices[output * 3 + 0] = vertices[0];
+    optimizedIndices[output * 3 + 1] = vertices[1];
+    optimizedIndices[output * 3 + 2] = vertices[2];
+    emitted[bestTriangle] = 1;
+
+    for (u32 i = 0; i < 3; ++i) {
+      u32 vertex = vertices[i];
+      u32* triangles = &adjacency[adjacencyOffsets[vertex]];
+      for (u32 j = 0; j < valence[vertex]; ++j) {
+        if (triangles[j] == bestTriangle) {
+          triangles[j] = triangles[valence[vertex] - 1];
+          break;
+        }
+      }
+      --valence[vertex];
+    }
+
+    // Most recently used first, entries past FORSYTH_CACHE_SIZE are evicted
+    u32 newCache[FORSYTH_CACHE_SIZE + 3];
+    u32 newCacheCount = 0;
+    for (u32 i = 0; i < 3; ++i) {
+      if (std::find(newCache, newCache + newCacheCount, vertices[i]) == newCache + newCacheCount) {
+        newCache[newCacheCount++] = vertices[i];
+      }
+    }
+    for (u32 i = 0; i < cacheCount; ++i) {
+      u32 vertex = cache[i];
+      if (vertex != vertices[0] && vertex != vertices[1] && vertex != vertices[2]) {
+        newCache[newCacheCount++] = vertex;
+      }
+    }
+
+    for (u32 i = 0; i < newCacheCount; ++i) {
+      u32 vertex = newCache[i];
+      cachePosition[vertex] = i < FORSYTH_CACHE_SIZE ? (s32)i : -1;
+      f32 score = forsythVertexScore(cachePosition[vertex], valence[vertex]);
+      f32 scoreDelta = score - vertexScore[vertex];
+      vertexScore[vertex] = score;
+      const u32* triangles = &adjacency[adjacencyOffsets[vertex]];
+      for (u32 j = 0; j < valence[vertex]; ++j) {
+        triangleScore[triangles[j]] += scoreDelta;
+      }
+    }
+    cacheCount = newCacheCount < FORSYTH_CACHE_SIZE ? newCacheCount : FORSYTH_CACHE_SIZE;
+    std::copy(newCache, newCache + cacheCount, cache);
+
+    bestTriangle = UNUSED_VERTEX;
+    f32 bestScore = -1.0f;
+    for (u32 i = 0; i < cacheCount; ++i) {
+      u32 vertex = cache[i];
+      const u32* triangles = &adjacency[adjacencyOffsets[vertex]];
+      for (u32 j = 0; j < valence[vertex]; ++j) {
+        if (triangleScore[triangles[j]] > bestScore) {
+          bestScore = triangleScore[triangles[j]];
+          bestTriangle = triangles[j];
+        }
+      }
+    }
+  }
+}
+
+struct TriangleCluster {
+  u32 firstTriangle;
+  u32 triangleCount;
+  f32 sortKey;
+};
+
+/*
+ * - Hard boundaries where the cache optimized order restarts (a triangle missing all 3 vertices), moving clusters
+ *   around there costs nothing
+ * - Soft boundaries split hard clusters wherever the running ACMR drops to threshold x the cluster's own ACMR
+ * - Clusters are sorted by how much they face away from the mesh centroid, the outermost drawn first occlude the rest
+ */
+void optimizeOverdraw(const u32* indices, u32 indexCount, const f32* vertexPositions, u32 vertexPositionStride, u32 vertexCount,
+                      f32 threshold, u32* optimizedIndices) {
+  u32 triangleCount = indexCount / 3;
+  FifoCache cache;
+  initFifoCache(vertexCount, VERTEX_CACHE_SIZE, &cache);
+  std::vector<u32> hardBoundaries;
+  for (u32 triangle = 0; triangle < triangleCount; ++triangle) {
+    if (fifoCacheTriangleMisses(&cache, &indices[triangle * 3]) == 3) {
+      hardBoundaries.push_back(triangle);
+    }
+  }
+  if (hardBoundaries.empty() || hardBoundaries[0] != 0) {
+    hardBoundaries.insert(hardBoundaries.begin(), 0);
+  }
+  hardBoundaries.push_back(triangleCount);
+
+  std::vector<TriangleCluster> clusters;
+  for (u32 hard = 0; hard + 1 < hardBoundaries.size(); ++hard) {
+    u32 start = hardBoundaries[hard];
+    u32 end = hardBoundaries[hard + 1];
+    if (start == end) {
+      continue;
+    }
+    flushFifoCache(&cache);
+    u32 clusterMisses = 0;
+    for (u32 triangle = start; triangle < end; ++triangle) {
+      clusterMisses += fifoCacheTriangleMisses(&cache, &indices[triangle * 3]);
+    }
+    f32 clusterThreshold = threshold * (f32)clusterMisses / (f32)(end - start);
+
+    // Each soft cluster starts with a cold cache, as it would once the clusters are reordered
+    flushFifoCache(&cache);
+    u32 firstSoftCluster = (u32)clusters.size();
+    u32 softStart = start;
+    u32 runningMisses = 0;
+    for (u32 triangle = start; triangle < end; ++triangle) {
+      runningMisses += fifoCacheTriangleMisses(&cache, &indices[triangle * 3]);
+      if ((f32)runningMisses <= clusterThreshold * (f32)(triangle + 1 - softStart)) {
+        clusters.push_back({softStart, triangle + 1 - softStart, 0.0f});
+        softStart = triangle + 1;
+        runningMisses = 0;
+        flushFifoCache(&cache);
+      }
+    }
+    // The tail never reached the threshold, merge it into the previous soft cluster
+    if (softStart < end) {
+      if ((u32)clusters.size() > firstSoftCluster) {
+        clusters.back().triangleCount += end - softStart;
+      } else {
+        clusters.push_back({softStart, end - softStart, 0.0f});
+      }
+    }
+  }
+
+  // Area weighted centroids, the unnormalized face normal has twice the triangle's area as its length
+  const u8* positionBytes = (const u8*)vertexPositions;
+  f32 meshCentroid[3] = {};
+  f32 meshArea = 0.0f;
+  std::vector<f32> clusterCentroids(clusters.size() * 3, 0.0f);
+  std::vector<f32> clusterNormals(clusters.size() * 3, 0.0f);
+  for (u32 clusterIndex = 0; clusterIndex < clusters.size(); ++clusterIndex) {
+    const TriangleCluster& cluster = clusters[clusterIndex];
+    f32* centroid = &clusterCentroids[clusterIndex * 3];
+    f32* normal = &clusterNormals[clusterIndex * 3];
+    f32 clusterArea = 0.0f;
+    for (u32 triangle = cluster.firstTriangle; triangle < cluster.firstTriangle + cluster.triangleCount; ++triangle) {
+      const f32* p0 = (const f32*)(positionBytes + (u64)indices[triangle * 3 + 0] * vertexPositionStride);
+      const f32* p1 = (const f32*)(positionBytes + (u64)indices[triangle * 3 + 1] * vertexPositionStride);
+      const f32* p2 = (const f32*)(positionBytes + (u64)indices[triangle * 3 + 2] * vertexPositionStride);
+      f32 e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+      f32 e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+      f32 faceNormal[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+      f32 area = sqrtf(faceNormal[0] * faceNormal[0] + faceNormal[1] * faceNormal[1] + faceNormal[2] * faceNormal[2]);
+      for (u32 axis = 0; axis < 3; ++axis) {
+        centroid[axis] += (p0[axis] + p1[axis] + p2[axis]) / 3.0f * area;
+        normal[axis] += faceNormal[axis];
+      }
+      clusterArea += area;
+    }
+    for (u32 axis = 0; axis < 3; ++axis) {
+      meshCentroid[axis] += centroid[axis];
+      centroid[axis] = clusterArea > 0.0f ? centroid[axis] / clusterArea : 0.0f;
+    }
+    meshArea += clusterArea;
+  }
+  for (u32 axis = 0; axis < 3; ++axis) {
+    meshCentroid[axis] = meshArea > 0.0f ? meshCentroid[axis] / meshArea : 0.0f;
+  }
+
+  for (u32 clusterIndex = 0; clusterIndex < clusters.size(); ++clusterIndex) {
+    const f32* centroid = &clusterCentroids[clusterIndex * 3];
+    const f32* normal = &clusterNormals[clusterIndex * 3];
+    f32 normalLength = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    f32 sortKey = 0.0f;
+    for (u32 axis = 0; axis < 3; ++axis) {
+      sortKey += (centroid[axis] - meshCentroid[axis]) * (normalLength > 0.0f ? normal[axis] / normalLength : 0.0f);
+    }
+    clusters[clusterIndex].sortKey = sortKey;
+  }
+  std::stable_sort(clusters.begin(), clusters.end(), [](const TriangleCluster& a, const TriangleCluster& b) {
+    return a.sortKey > b.sortKey;
+  });
+
+  u32 output = 0;
+  for (const TriangleCluster& cluster : clusters) {
+    for (u32 i = cluster.firstTriangle * 3; i < (cluster.firstTriangle + cluster.triangleCount) * 3; ++i) {
+      optimizedIndices[output++] = indices[i];
+    }
+  }
+}
+
+u32 optimizeVertexFetch(u32* indices, u32 indexCount, u32 vertexCount, u32* remap) {
+  std::fill(remap, remap + vertexCount, UNUSED_VERTEX);
+  u32 usedVertexCount = 0;
+  for (u32 i = 0; i < indexCount; ++i) {
+    u32* index = &indices[i];
+    if (remap[*index] == UNUSED_VERTEX) {
+      remap[*index] = usedVertexCount++;
+    }
+    *index = remap[*index];
+  }
+  return usedVertexCount;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "KuringTypes.h"
+
+// Triangle list reordering run by tools/MeshImporter on each submesh, in this order:
+//  - optimizeVertexCache: triangle order for post-transform vertex cache hits (Forsyth, linear speed)
+//  - optimizeOverdraw: reorders clusters of the cache optimized order so that outward facing ones are drawn first,
+//    trading at most threshold x the cluster's ACMR for fewer overdrawn fragments (Sander et al., Tipsify)
+//  - optimizeVertexFetch: vertex order of first use so that vertex fetches walk memory linearly
+// Indices are u32 relative to the submesh's first vertex, narrowed when written out.
+
+const u32 VERTEX_CACHE_SIZE = 16; // FIFO size used to measure ACMR/ATVR, typical of hardware post-transform caches
+const f32 DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+const u32 UNUSED_VERTEX = 0xFFFFFFFF;
+
+struct VertexCacheStats {
+  u32 triangleCount;
+  u32 vertexCount;
+  u32 cacheMisses; // ACMR = cacheMisses / triangleCount, ATVR = cacheMisses / vertexCount
+};
+
+// Simulates a FIFO cache of cacheSize vertices
+VertexCacheStats analyzeVertexCache(const u32* indices, u32 indexCount, u32 vertexCount, u32 cacheSize);
+void optimizeVertexCache(const u32* indices, u32 indexCount, u32 vertexCount, u32* optimizedIndices);
+// vertexPositions points at the first vertex's position, vertexPositionStride is in bytes
+void optimizeOverdraw(const u32* indices, u32 indexCount, const f32* vertexPositions, u32 vertexPositionStride, u32 vertexCount,
+                      f32 threshold, u32* optimizedIndices);
+// Rewrites the indices in place and fills remap[old vertex] = new vertex (UNUSED_VERTEX if unreferenced).
+// Returns the number of referenced vertices.
+u32 optimizeVertexFetch(u32* indices, u32 indexCount, u32 vertexCount, u32* remap);
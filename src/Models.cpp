@@ -5,7 +5,8 @@ const u32 quadIndexData[] = {0, 1, 2,
 const VertexAttIndices quadIndices {
         sizeof(quadIndexData),
         ArrayCount(quadIndexData),
-        (void*)quadIndexData
+        (void*)quadIndexData,
+        VK_INDEX_TYPE_UINT32
 };
 
 VertexAttFormat posVertexAttDatumFormat[]{
@@ -17,6 +18,32 @@ VertexAttFormat posColVertexAttDatumFormat[]{
         { (u32)offsetof(PosColVertexAttDatum, color),    VK_FORMAT_R32G32B32_SFLOAT },
 };
 
+VertexAttFormat posColNormVertexAttDatumFormat[POS_COL_NORM_VERTEX_ATT_FORMAT_COUNT]{
+        { (u32)offsetof(PosColNormVertexAttDatum, position), VK_FORMAT_R32G32B32_SFLOAT },
+        { (u32)offsetof(PosColNormVertexAttDatum, color),    VK_FORMAT_R32G32B32_SFLOAT },
+        { (u32)offsetof(PosColNormVertexAttDatum, normal),   VK_FORMAT_R32G32B32_SFLOAT },
+};
+
+VertexAttFormat snorm16QuantizedVertexAttDatumFormat[QUANTIZED_VERTEX_ATT_FORMAT_COUNT]{
+        { (u32)offsetof(QuantizedVertexAttDatum, position), VK_FORMAT_R16G16B16A16_SNORM },
+        { (u32)offsetof(QuantizedVertexAttDatum, color),    VK_FORMAT_R8G8B8A8_UNORM },
+        { (u32)offsetof(QuantizedVertexAttDatum, normal),   VK_FORMAT_R16G16_SNORM },
+};
+
+VertexAttFormat float16QuantizedVertexAttDatumFormat[QUANTIZED_VERTEX_ATT_FORMAT_COUNT]{
+        { (u32)offsetof(QuantizedVertexAttDatum, position), VK_FORMAT_R16G16B16A16_SFLOAT },
+        { (u32)offsetof(QuantizedVertexAttDatum, color),    VK_FORMAT_R8G8B8A8_UNORM },
+        { (u32)offsetof(QuantizedVertexAttDatum, normal),   VK_FORMAT_R16G16_SNORM },
+};
+
+VertexAttFormat instanceAttDatumFormat[INSTANCE_ATT_FORMAT_COUNT]{
+        { (u32)offsetof(InstanceAttDatum, model) + 0 * 4 * sizeof(f32), VK_FORMAT_R32G32B32A32_SFLOAT },
+        { (u32)offsetof(InstanceAttDatum, model) + 1 * 4 * sizeof(f32), VK_FORMAT_R32G32B32A32_SFLOAT },
+        { (u32)offsetof(InstanceAttDatum, model) + 2 * 4 * sizeof(f32), VK_FORMAT_R32G32B32A32_SFLOAT },
+        { (u32)offsetof(InstanceAttDatum, model) + 3 * 4 * sizeof(f32), VK_FORMAT_R32G32B32A32_SFLOAT },
+        { (u32)offsetof(InstanceAttDatum, color),                       VK_FORMAT_R32G32B32A32_SFLOAT },
+};
+
 const PosColVertexAttDatum quadPosColVertexAttData[] =
         {
                 { // VERTEX ATTRIBUTE
@@ -19,6 +19,7 @@ struct VertexAttIndices {
   u32 sizeInBytes;
   u32 count;
   void* data;
+  VkIndexType type;
 };
 
 struct VertexAtt {
@@ -42,5 +43,35 @@ struct PosColVertexAttDatum {
 };
 extern VertexAttFormat posColVertexAttDatumFormat[];
 
+// Imported meshes (see MeshFile.h), color is the first vertex color channel or derived from the normal
+struct PosColNormVertexAttDatum {
+  f32 position[3];
+  f32 color[3];
+  f32 normal[3];
+};
+const u32 POS_COL_NORM_VERTEX_ATT_FORMAT_COUNT = 3;
+extern VertexAttFormat posColNormVertexAttDatumFormat[POS_COL_NORM_VERTEX_ATT_FORMAT_COUNT];
+
+// PosColNormVertexAttDatum compressed by VertexQuantization.h, 16 bytes instead of 36. Positions are SNORM16 or half
+// floats (4 components, 3 component 16 bit formats are rarely supported for vertex buffers) and are dequantized by the
+// model matrix, colors are UNORM8 and normals octahedral encoded SNORM16.
+struct QuantizedVertexAttDatum {
+  u16 position[4];
+  u8 color[4];
+  s16 normal[2];
+};
+const u32 QUANTIZED_VERTEX_ATT_FORMAT_COUNT = 3;
+extern VertexAttFormat snorm16QuantizedVertexAttDatumFormat[QUANTIZED_VERTEX_ATT_FORMAT_COUNT];
+extern VertexAttFormat float16QuantizedVertexAttDatumFormat[QUANTIZED_VERTEX_ATT_FORMAT_COUNT];
+
+// Per instance attributes (VK_VERTEX_INPUT_RATE_INSTANCE), see InstanceBuffer.h. The column major model matrix takes one
+// location per column.
+struct InstanceAttDatum {
+  f32 model[16];
+  f32 color[4]; // multiplies the vertex color
+};
+const u32 INSTANCE_ATT_FORMAT_COUNT = 5;
+extern VertexAttFormat instanceAttDatumFormat[INSTANCE_ATT_FORMAT_COUNT];
+
 extern VertexAtt quadPosColVertexAtt;
 extern VertexAtt quadPosVertexAtt;
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "ParallelCommandRecorder.h"
+
+#include <stdexcept>
+#include <future>
+#include <memory>
+#include <vector>
+#include "Profiler.h"
+
+void initParallelCommandRecorder(VkDevice device, u32 queueFamilyIndex, ThreadPool* threadPool, u32 frameCount, u32 sliceCount,
+                                 ParallelCommandRecorder* recorder) {
+  if (sliceCount == 0) {
+    throw std::runtime_error("at least one command buffer slice is required!");
+  }
+  recorder->device = device;
+  recorder->threadPool = threadPool;
+  recorder->frameCount = frameCount;
+  recorder->sliceCount = sliceCount;
+  u32 poolCount = frameCount * sliceCount;
+  recorder->commandPools = new VkCommandPool[poolCount];
+  recorder->commandBuffers = new VkCommandBuffer[poolCount];
+
+  VkCommandPoolCreateInfo commandPoolCI{};
+  commandPoolCI.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCI.queueFamilyIndex = queueFamilyIndex;
+  commandPoolCI.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // re-recorded every frame, reset with the whole pool
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
+  commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+
+  for (u32 i = 0; i < poolCount; ++i) {
+    if (vkCreateCommandPool(device, &commandPoolCI, nullptr, &recorder->commandPools[i]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create secondary command pool!");
+    }
+    commandBufferAllocateInfo.commandPool = recorder->commandPools[i];
+    if (vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &recorder->commandBuffers[i]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate secondary command buffer!");
+    }
+  }
+}
+
+void destroyParallelCommandRecorder(ParallelCommandRecorder* recorder) {
+  // command buffers are freed along with their pool
+  for (u32 i = 0; i < recorder->frameCount * recorder->sliceCount; ++i) {
+    vkDestroyCommandPool(recorder->device, recorder->commandPools[i], nullptr);
+  }
+  delete[] recorder->commandPools;
+  delete[] recorder->commandBuffers;
+  *recorder = {};
+}
+
+internal_access void recordSliceCommands(VkDevice device, VkCommandPool commandPool, VkCommandBuffer commandBuffer,
+                                         const VkCommandBufferInheritanceInfo& inheritanceInfo, u32 slice, u32 first, u32 count,
+                                         const SliceRecorder& record) {
+  ProfileScope("record slice");
+  vkResetCommandPool(device, commandPool, 0);
+
+  VkCommandBufferBeginInfo commandBufferBeginInfo{};
+  commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  // RENDER_PASS_CONTINUE: executed entirely inside the render pass given by the inheritance info
+  commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+  if (vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("failed to begin recording secondary command buffer!");
+  }
+  record(commandBuffer, slice, first, count);
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record secondary command buffer!");
+  }
+}
+
+/*
+ * - Slices are as even as possible, the first itemCount % sliceCount slices get one more item. Empty slices are
+ *   still recorded (begin/end only) so that every frame executes the same secondary command buffers.
+ * - packaged_task carries exceptions thrown by the recorder across to the future
+ * - The caller's captures outlive the jobs since every job is waited on before returning, even when one throws
+ */
+void recordSecondaryCommandBuffers(ParallelCommandRecorder* recorder, u32 frameIndex, const VkCommandBufferInheritanceInfo& inheritanceInfo,
+                                   u32 itemCount, const SliceRecorder& recordSlice) {
+  ProfileFunction();
+  u32 sliceCount = recorder->sliceCount;
+  VkCommandPool* commandPools = recorder->commandPools + frameIndex * sliceCount;
+  VkCommandBuffer* commandBuffers = recorder->commandBuffers + frameIndex * sliceCount;
+  VkDevice device = recorder->device;
+  const SliceRecorder* record = &recordSlice;
+  const VkCommandBufferInheritanceInfo* inheritance = &inheritanceInfo;
+
+  u32 sliceSize = itemCount / sliceCount;
+  u32 remainder = itemCount % sliceCount;
+  std::vector<std::future<void>> slices;
+  slices.reserve(sliceCount - 1);
+  u32 first = 0;
+  for (u32 slice = 0; slice < sliceCount; ++slice) {
+    u32 count = sliceSize + (slice < remainder ? 1 : 0);
+    if (slice == sliceCount - 1) {
+      try {
+        recordSliceCommands(device, commandPools[slice], commandBuffers[slice], inheritanceInfo, slice, first, count, recordSlice);
+      } catch (...) {
+        for (std::future<void>& future : slices) {
+          future.wait();
+        }
+        throw;
+      }
+    } else {
+      VkCommandPool commandPool = commandPools[slice];
+      VkCommandBuffer commandBuffer = commandBuffers[slice];
+      auto task = std::make_shared<std::packaged_task<void()>>([=]() {
+        recordSliceCommands(device, commandPool, commandBuffer, *inheritance, slice, first, count, *record);
+      });
+      slices.push_back(task->get_future());
+      submitJob(recorder->threadPool, [task]() { (*task)(); });
+    }
+    first += count;
+  }
+  for (std::future<void>& future : slices) {
+    future.wait();
+  }
+  for (std::future<void>& future : slices) {
+    future.get(); // rethrows
+  }
+}
+
+void cmdExecuteSecondaryCommandBuffers(VkCommandBuffer commandBuffer, const ParallelCommandRecorder* recorder, u32 frameIndex) {
+  vkCmdExecuteCommands(commandBuffer, recorder->sliceCount, recorder->commandBuffers + frameIndex * recorder->sliceCount);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <functional>
+#include "KuringTypes.h"
+#include "ThreadPool.h"
+
+// Records slices of a frame's draw list into secondary command buffers concurrently, to be executed by the frame's
+// primary command buffer within a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+// Command pools must be externally synchronized, so every slice of every frame in flight gets its own transient pool,
+// only ever used by the job recording that slice. Pools are reset as a whole each frame rather than buffer by buffer.
+struct ParallelCommandRecorder {
+  VkDevice device;
+  ThreadPool* threadPool; // should be dedicated to recording, slices queued behind other jobs (ex: pipeline compiles) stall the frame
+  u32 frameCount;
+  u32 sliceCount;
+  VkCommandPool* commandPools; // [frameIndex * sliceCount + slice]
+  VkCommandBuffer* commandBuffers; // secondary, one per command pool
+};
+
+// Records a slice's commands into its secondary command buffer: items [first, first + count) of the draw list.
+// Secondary command buffers inherit no state from the primary, the pipeline, dynamic state, buffers, descriptor sets
+// and push constants must all be set again.
+// NOTE: Called concurrently for different slices, anything shared must be read only or written to disjoint ranges
+typedef std::function<void(VkCommandBuffer commandBuffer, u32 slice, u32 first, u32 count)> SliceRecorder;
+
+void initParallelCommandRecorder(VkDevice device, u32 queueFamilyIndex, ThreadPool* threadPool, u32 frameCount, u32 sliceCount,
+                                 ParallelCommandRecorder* recorder);
+// NOTE: The command buffers must no longer be in use by the GPU
+void destroyParallelCommandRecorder(ParallelCommandRecorder* recorder);
+// Splits itemCount items into sliceCount contiguous slices and records them on the thread pool, the last slice on the
+// calling thread. Blocks until every slice is recorded and rethrows the first failure.
+// NOTE: Only call once the frame in flight's fence has been waited on, its pools are reset
+void recordSecondaryCommandBuffers(ParallelCommandRecorder* recorder, u32 frameIndex, const VkCommandBufferInheritanceInfo& inheritanceInfo,
+                                   u32 itemCount, const SliceRecorder& recordSlice);
+// Executes the frame's secondary command buffers in slice order
+void cmdExecuteSecondaryCommandBuffers(VkCommandBuffer commandBuffer, const ParallelCommandRecorder* recorder, u32 frameIndex);
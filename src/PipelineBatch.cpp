@@ -0,0 +1,78 @@
+#include "PipelineBatch.h"
+
+#include <memory>
+#include <exception>
+#include "GraphicsPipelineBuilder.h"
+#include "Profiler.h"
+
+void initPipelineBatch(VkDevice device, VkPipelineCache pipelineCache, ShaderModuleCache* shaderModuleCache, ThreadPool* threadPool,
+                       PipelineBatch* batch) {
+  batch->device = device;
+  batch->pipelineCache = pipelineCache;
+  batch->shaderModuleCache = shaderModuleCache;
+  batch->threadPool = threadPool;
+  batch->pipelines.clear();
+}
+
+/*
+ * - Shader modules are loaded (or acquired from the shader module cache) on the worker, alongside the pipeline itself
+ */
+std::shared_future<BuiltPipeline> submitPipeline(PipelineBatch* batch, PipelineDescription description) {
+  VkDevice device = batch->device;
+  VkPipelineCache pipelineCache = batch->pipelineCache;
+  ShaderModuleCache* shaderModuleCache = batch->shaderModuleCache;
+  return submitPipelineBuild(batch, [device, pipelineCache, shaderModuleCache, description](VkPipeline* pipeline, VkPipelineLayout* pipelineLayout) {
+    GraphicsPipelineBuilder builder(device, shaderModuleCache);
+    description(builder);
+    builder.setPipelineCache(pipelineCache)
+           .build(pipeline, pipelineLayout);
+  });
+}
+
+// packaged_task carries exceptions thrown by the build across to the future
+std::shared_future<BuiltPipeline> submitPipelineBuild(PipelineBatch* batch, PipelineBuild build) {
+  auto task = std::make_shared<std::packaged_task<BuiltPipeline()>>([build]() {
+    ProfileScope("build pipeline");
+    BuiltPipeline builtPipeline;
+    build(&builtPipeline.pipeline, &builtPipeline.pipelineLayout);
+    return builtPipeline;
+  });
+
+  std::shared_future<BuiltPipeline> future = task->get_future().share();
+  batch->pipelines.push_back(future);
+  submitJob(batch->threadPool, [task]() { (*task)(); });
+  return future;
+}
+
+/*
+ * - Wait on every pipeline before looking at any result, so that no worker still uses the batch when a failure is rethrown
+ * - On failure, the pipelines that did build are destroyed: the caller only gets the exception and could not reach them
+ */
+void waitForPipelineBatch(PipelineBatch* batch) {
+  ProfileFunction();
+  for (std::shared_future<BuiltPipeline>& pipeline : batch->pipelines) {
+    pipeline.wait();
+  }
+  std::exception_ptr firstFailure;
+  for (std::shared_future<BuiltPipeline>& pipeline : batch->pipelines) {
+    try {
+      pipeline.get();
+    } catch (...) {
+      firstFailure = std::current_exception();
+      break;
+    }
+  }
+  if (!firstFailure) {
+    return;
+  }
+  for (std::shared_future<BuiltPipeline>& pipeline : batch->pipelines) {
+    try {
+      const BuiltPipeline& builtPipeline = pipeline.get();
+      vkDestroyPipeline(batch->device, builtPipeline.pipeline, nullptr);
+      vkDestroyPipelineLayout(batch->device, builtPipeline.pipelineLayout, nullptr);
+    } catch (...) {
+      // failed to build, nothing to destroy
+    }
+  }
+  std::rethrow_exception(firstFailure);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <vector>
+#include <future>
+#include <functional>
+#include "KuringTypes.h"
+#include "ThreadPool.h"
+#include "ShaderModuleCache.h"
+
+class GraphicsPipelineBuilder;
+
+struct BuiltPipeline {
+  VkPipeline pipeline;
+  VkPipelineLayout pipelineLayout;
+};
+
+// Configures a builder on a worker thread (shaders, state, render pass, etc.), without calling build.
+// NOTE: Anything captured must remain valid until the pipeline's future is ready.
+typedef std::function<void(GraphicsPipelineBuilder& builder)> PipelineDescription;
+// Builds a pipeline and its layout on a worker thread, for pipelines that aren't described with a GraphicsPipelineBuilder
+// (ex: compute pipelines). Same lifetime rule as PipelineDescription.
+typedef std::function<void(VkPipeline* pipeline, VkPipelineLayout* pipelineLayout)> PipelineBuild;
+
+// Batch of pipelines compiled concurrently on a thread pool, all through the same pipeline cache.
+// Vulkan synchronizes concurrent pipeline creation through a cache internally; what must be synchronized externally
+// is reading or merging the cache (ex: savePipelineCache), which is only safe once waitForPipelineBatch has returned.
+struct PipelineBatch {
+  VkDevice device;
+  VkPipelineCache pipelineCache;
+  ShaderModuleCache* shaderModuleCache; // optional, shares shader modules across the batch
+  ThreadPool* threadPool;
+  std::vector<std::shared_future<BuiltPipeline>> pipelines;
+};
+
+void initPipelineBatch(VkDevice device, VkPipelineCache pipelineCache, ShaderModuleCache* shaderModuleCache, ThreadPool* threadPool,
+                       PipelineBatch* batch);
+// Queues the pipeline for compilation and returns immediately. get() on the future blocks until the pipeline is
+// built and rethrows any build failure.
+std::shared_future<BuiltPipeline> submitPipeline(PipelineBatch* batch, PipelineDescription description);
+// As submitPipeline, the build is responsible for using the batch's pipeline cache and shader module cache
+std::shared_future<BuiltPipeline> submitPipelineBuild(PipelineBatch* batch, PipelineBuild build);
+// Blocks until every submitted pipeline has finished building, rethrows the first failure.
+// On failure every pipeline and layout of the batch that did build has been destroyed, the futures must not be used.
+void waitForPipelineBatch(PipelineBatch* batch);
@@ -0,0 +1,118 @@
+#include "PipelineCache.h"
+
+#include <stdexcept>
+#include <fstream>
+#include <string>
+#include <string.h>
+#include <stdio.h>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#endif
+
+#include "Util.h"
+
+internal_access PipelineCacheFileHeader expectedHeader(VkPhysicalDevice physicalDevice) {
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+  PipelineCacheFileHeader header{};
+  header.magic = PIPELINE_CACHE_FILE_MAGIC;
+  header.version = PIPELINE_CACHE_FILE_VERSION;
+  header.vendorID = deviceProperties.vendorID;
+  header.deviceID = deviceProperties.deviceID;
+  header.driverVersion = deviceProperties.driverVersion;
+  memcpy(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+  return header;
+}
+
+/*
+ * - Read the cache file, if any, and validate its header against the current device and driver
+ *    - The driver also validates the data it is given, but rejected data is silently discarded and some drivers have
+ *      been known to misbehave when handed stale caches
+ * - Create the pipeline cache with the validated data, or empty
+ */
+VkPipelineCache loadPipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const char* filePath, bool32* loadedFromDisk) {
+  PipelineCacheFileHeader expected = expectedHeader(physicalDevice);
+  u8* data = nullptr;
+  u64 dataSize = 0;
+
+  std::ifstream file(filePath, std::ios::binary);
+  if (file.is_open()) {
+    PipelineCacheFileHeader header;
+    bool32 headerValid = file.read((char*)&header, sizeof(header))
+                         && header.magic == expected.magic
+                         && header.version == expected.version
+                         && header.vendorID == expected.vendorID
+                         && header.deviceID == expected.deviceID
+                         && header.driverVersion == expected.driverVersion
+                         && memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) == 0
+                         && header.dataSize > 0;
+    if (headerValid) {
+      data = new u8[header.dataSize];
+      if (file.read((char*)data, header.dataSize) && hashBytes(data, header.dataSize) == header.dataHash) {
+        dataSize = header.dataSize;
+      } else {
+        delete[] data;
+        data = nullptr;
+      }
+    }
+  }
+
+  VkPipelineCacheCreateInfo pipelineCacheCI{};
+  pipelineCacheCI.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  pipelineCacheCI.initialDataSize = dataSize;
+  pipelineCacheCI.pInitialData = data;
+
+  VkPipelineCache pipelineCache;
+  if (vkCreatePipelineCache(device, &pipelineCacheCI, nullptr, &pipelineCache) != VK_SUCCESS) {
+    delete[] data;
+    throw std::runtime_error("failed to create pipeline cache!");
+  }
+  delete[] data;
+
+  if (loadedFromDisk != nullptr) {
+    *loadedFromDisk = dataSize > 0;
+  }
+  return pipelineCache;
+}
+
+void savePipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, VkPipelineCache pipelineCache, const char* filePath) {
+  size_t dataSize = 0;
+  vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr);
+  if (dataSize == 0) {
+    return;
+  }
+  u8* data = new u8[dataSize];
+  if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, data) != VK_SUCCESS) {
+    delete[] data;
+    throw std::runtime_error("failed to get pipeline cache data!");
+  }
+
+  PipelineCacheFileHeader header = expectedHeader(physicalDevice);
+  header.dataSize = dataSize;
+  header.dataHash = hashBytes(data, dataSize);
+
+  std::string tempFilePath = std::string(filePath) + ".tmp";
+  std::ofstream file(tempFilePath, std::ios::binary | std::ios::trunc);
+  bool32 written = file.is_open()
+                   && file.write((const char*)&header, sizeof(header))
+                   && file.write((const char*)data, dataSize);
+  file.close();
+  delete[] data;
+
+  if (!written) {
+    remove(tempFilePath.c_str());
+    throw std::runtime_error(std::string("failed to write pipeline cache:") + tempFilePath);
+  }
+
+#if defined(_WIN32)
+  bool32 replaced = MoveFileExA(tempFilePath.c_str(), filePath, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+  bool32 replaced = rename(tempFilePath.c_str(), filePath) == 0; // atomic on POSIX
+#endif
+  if (!replaced) {
+    remove(tempFilePath.c_str());
+    throw std::runtime_error(std::string("failed to replace pipeline cache:") + filePath);
+  }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include "KuringTypes.h"
+
+// Header prepended to the VkPipelineCache data on disk. Cache data is only handed to the driver if it was saved by
+// the same device and driver version, and hasn't been truncated or corrupted.
+struct PipelineCacheFileHeader {
+  u32 magic;
+  u32 version;
+  u32 vendorID;
+  u32 deviceID;
+  u32 driverVersion;
+  u8 pipelineCacheUUID[VK_UUID_SIZE];
+  u64 dataSize;
+  u64 dataHash;
+};
+
+const u32 PIPELINE_CACHE_FILE_MAGIC = 0x4843504B; // "KPCH"
+const u32 PIPELINE_CACHE_FILE_VERSION = 1;
+
+// Creates an empty pipeline cache if the file is missing or invalid. loadedFromDisk is optional.
+VkPipelineCache loadPipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const char* filePath, bool32* loadedFromDisk);
+// Writes to a temporary file which then replaces filePath, so a crash mid-save never leaves a partial cache behind
+void savePipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, VkPipelineCache pipelineCache, const char* filePath);
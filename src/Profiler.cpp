@@ -0,0 +1,93 @@
+#include "Profiler.h"
+
+#include <chrono>
+#include <vector>
+#include <mutex>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "Util.h"
+
+const size_t PROFILE_THREAD_BUFFER_INITIAL_CAPACITY = 1 << 16;
+
+struct ProfileZone {
+  const char* name;
+  u64 startNanoseconds;
+  u64 endNanoseconds;
+};
+
+struct ProfileThreadBuffer {
+  u32 threadId;
+  std::vector<ProfileZone> zones;
+};
+
+internal_access bool32 profilerEnabled = false;
+internal_access std::chrono::steady_clock::time_point profilerEpoch = std::chrono::steady_clock::now();
+// Buffers are owned by the profiler rather than the threads so that zones outlive the threads that recorded them
+internal_access std::mutex threadBuffersMutex;
+internal_access std::vector<ProfileThreadBuffer*> threadBuffers;
+thread_local ProfileThreadBuffer* threadBuffer = nullptr;
+
+internal_access u64 profilerNanoseconds() {
+  return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - profilerEpoch).count();
+}
+
+internal_access ProfileThreadBuffer* getThreadBuffer() {
+  if (threadBuffer == nullptr) {
+    std::lock_guard<std::mutex> lock(threadBuffersMutex);
+    threadBuffer = new ProfileThreadBuffer;
+    threadBuffer->threadId = (u32)threadBuffers.size();
+    threadBuffer->zones.reserve(PROFILE_THREAD_BUFFER_INITIAL_CAPACITY);
+    threadBuffers.push_back(threadBuffer);
+  }
+  return threadBuffer;
+}
+
+ProfileScopeTimer::ProfileScopeTimer(const char* name) {
+  this->name = name;
+  this->startNanoseconds = profilerEnabled ? profilerNanoseconds() : 0;
+}
+
+ProfileScopeTimer::~ProfileScopeTimer() {
+  // NOTE: zones straddling enableProfiler(true) are dropped
+  if (profilerEnabled && startNanoseconds != 0) {
+    getThreadBuffer()->zones.push_back({name, startNanoseconds, profilerNanoseconds()});
+  }
+}
+
+void enableProfiler(bool32 enabled) {
+  profilerEnabled = enabled;
+}
+
+bool32 isProfilerEnabled() {
+  return profilerEnabled;
+}
+
+/*
+ * - Write every recorded zone as a complete ("X") trace event, timestamps and durations in microseconds
+ * - Each thread buffer is reported as its own tid
+ */
+void writeProfilerTrace(const char* filePath) {
+  std::ofstream file(filePath);
+  if (!file.is_open()) {
+    throw std::runtime_error(std::string("failed to open file for writing:") + filePath);
+  }
+
+  std::lock_guard<std::mutex> lock(threadBuffersMutex);
+  file << std::fixed;
+  file.precision(3); // nanosecond resolution
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool32 firstEvent = true;
+  for (ProfileThreadBuffer* buffer : threadBuffers) {
+    for (const ProfileZone& zone : buffer->zones) {
+      file << (firstEvent ? "\n" : ",\n") << "{\"name\":";
+      writeJsonString(file, zone.name);
+      file << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->threadId
+           << ",\"ts\":" << zone.startNanoseconds / 1000.0
+           << ",\"dur\":" << (zone.endNanoseconds - zone.startNanoseconds) / 1000.0 << "}";
+      firstEvent = false;
+    }
+  }
+  file << "\n]}\n";
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "KuringTypes.h"
+
+// Scoped CPU zone profiler. Zones are recorded into per thread buffers (no locking after a thread's first zone) and
+// exported as Chrome trace_event JSON, viewable in chrome://tracing or Perfetto. Zones cost a single branch while the
+// profiler is disabled.
+//
+// Usage:
+//    ProfileFunction();          // zone named after the enclosing function, ends with the enclosing scope
+//    ProfileScope("acquire");    // zone names must outlive the profiler (ex: string literals)
+
+struct ProfileScopeTimer {
+  const char* name;
+  u64 startNanoseconds;
+
+  ProfileScopeTimer(const char* name);
+  ~ProfileScopeTimer();
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define ProfileScope(name) ProfileScopeTimer PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define ProfileFunction() ProfileScope(__func__)
+
+void enableProfiler(bool32 enabled);
+bool32 isProfilerEnabled();
+// NOTE: Expects profiled threads to be idle while writing
+void writeProfilerTrace(const char* filePath);
@@ -0,0 +1,288 @@
+#include "RayMarchPass.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <string.h>
+
+/*
+ * - One descriptor set per frame in flight: the stats buffer is the frame's own, the image and tile buffer are written
+ *   once the frame first records against a target (see cmdRayMarch)
+ * - Stats buffers are host visible and coherent, cleared on the GPU at the start of each frame
+ */
+void initRayMarchPass(VkDevice device, GpuMemoryAllocator* memoryAllocator, u32 frameCount, bool32 tileSkipping, RayMarchPass* pass) {
+  *pass = {};
+  pass->tileSkipping = tileSkipping;
+  pass->frameCount = frameCount;
+  pass->latest.frameNumber = UINT64_MAX;
+
+  VkDescriptorSetLayoutBinding bindings[3]{};
+  bindings[0].binding = RAY_MARCH_IMAGE_BINDING;
+  bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  bindings[0].descriptorCount = 1;
+  bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT; // written by the passes, read by the composite
+  bindings[1].binding = RAY_MARCH_TILE_BUFFER_BINDING;
+  bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[1].descriptorCount = 1;
+  bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  bindings[2].binding = RAY_MARCH_STATS_BUFFER_BINDING;
+  bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[2].descriptorCount = 1;
+  bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  VkDescriptorSetLayoutCreateInfo layoutCI{};
+  layoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutCI.bindingCount = 3;
+  layoutCI.pBindings = bindings;
+  if (vkCreateDescriptorSetLayout(device, &layoutCI, nullptr, &pass->descriptorSetLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create ray march descriptor set layout!");
+  }
+
+  VkDescriptorPoolSize poolSizes[2]{};
+  poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  poolSizes[0].descriptorCount = frameCount;
+  poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSizes[1].descriptorCount = 2 * frameCount;
+
+  VkDescriptorPoolCreateInfo poolCI{};
+  poolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolCI.poolSizeCount = 2;
+  poolCI.pPoolSizes = poolSizes;
+  poolCI.maxSets = frameCount;
+  if (vkCreateDescriptorPool(device, &poolCI, nullptr, &pass->descriptorPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create ray march descriptor pool!");
+  }
+
+  pass->frames = new RayMarchFrame[frameCount];
+  for (u32 i = 0; i < frameCount; ++i) {
+    RayMarchFrame* frame = &pass->frames[i];
+    *frame = {};
+    frame->statsBuffer = createBuffer(device, sizeof(RayMarchStats), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+    frame->statsMemory = allocateBufferMemory(memoryAllocator, frame->statsBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pass->descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &pass->descriptorSetLayout;
+    if (vkAllocateDescriptorSets(device, &allocInfo, &frame->descriptorSet) != VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate ray march descriptor set!");
+    }
+
+    VkDescriptorBufferInfo statsInfo{};
+    statsInfo.buffer = frame->statsBuffer;
+    statsInfo.offset = 0;
+    statsInfo.range = sizeof(RayMarchStats);
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = frame->descriptorSet;
+    descriptorWrite.dstBinding = RAY_MARCH_STATS_BUFFER_BINDING;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &statsInfo;
+    vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+  }
+}
+
+void destroyRayMarchPass(VkDevice device, GpuMemoryAllocator* memoryAllocator, RayMarchPass* pass) {
+  for (u32 i = 0; i < pass->frameCount; ++i) {
+    vkDestroyBuffer(device, pass->frames[i].statsBuffer, nullptr);
+    freeGpuMemory(memoryAllocator, &pass->frames[i].statsMemory);
+  }
+  if (pass->tilePipeline != VK_NULL_HANDLE) {
+    vkDestroyPipeline(device, pass->tilePipeline, nullptr);
+    vkDestroyPipelineLayout(device, pass->tilePipelineLayout, nullptr);
+  }
+  vkDestroyPipeline(device, pass->pixelPipeline, nullptr);
+  vkDestroyPipelineLayout(device, pass->pixelPipelineLayout, nullptr);
+  vkDestroyPipeline(device, pass->compositePipeline, nullptr);
+  vkDestroyPipelineLayout(device, pass->compositePipelineLayout, nullptr);
+  // descriptor sets are freed along with their pool
+  vkDestroyDescriptorPool(device, pass->descriptorPool, nullptr);
+  vkDestroyDescriptorSetLayout(device, pass->descriptorSetLayout, nullptr);
+  delete[] pass->frames;
+  *pass = {};
+}
+
+internal_access u64 nextTargetGeneration = 1;
+
+void initRayMarchTarget(VkDevice device, GpuMemoryAllocator* memoryAllocator, VkExtent2D extent, RayMarchTarget* target) {
+  *target = {};
+  target->generation = nextTargetGeneration++;
+  target->extent = extent;
+  target->tileCountX = dispatchGroupCount(extent.width, RAY_MARCH_TILE_SIZE);
+  target->tileCountY = dispatchGroupCount(extent.height, RAY_MARCH_TILE_SIZE);
+
+  // storage image support is mandatory for R8G8B8A8_UNORM
+  VkImageCreateInfo imageCI{};
+  imageCI.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageCI.imageType = VK_IMAGE_TYPE_2D;
+  imageCI.format = VK_FORMAT_R8G8B8A8_UNORM;
+  imageCI.extent = { extent.width, extent.height, 1 };
+  imageCI.mipLevels = 1;
+  imageCI.arrayLayers = 1;
+  imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageCI.usage = VK_IMAGE_USAGE_STORAGE_BIT;
+  imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  if (vkCreateImage(device, &imageCI, nullptr, &target->image) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create ray march image!");
+  }
+  target->imageMemory = allocateImageMemory(memoryAllocator, target->image, imageCI.tiling, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  VkImageViewCreateInfo imageViewCI{};
+  imageViewCI.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  imageViewCI.image = target->image;
+  imageViewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  imageViewCI.format = imageCI.format;
+  imageViewCI.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  imageViewCI.subresourceRange.baseMipLevel = 0;
+  imageViewCI.subresourceRange.levelCount = 1;
+  imageViewCI.subresourceRange.baseArrayLayer = 0;
+  imageViewCI.subresourceRange.layerCount = 1;
+  if (vkCreateImageView(device, &imageViewCI, nullptr, &target->imageView) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create ray march image view!");
+  }
+
+  target->tileBuffer = createBuffer(device, (VkDeviceSize)target->tileCountX * target->tileCountY * sizeof(f32), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+  target->tileMemory = allocateBufferMemory(memoryAllocator, target->tileBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void destroyRayMarchTarget(VkDevice device, GpuMemoryAllocator* memoryAllocator, RayMarchTarget* target) {
+  vkDestroyImageView(device, target->imageView, nullptr);
+  vkDestroyImage(device, target->image, nullptr);
+  freeGpuMemory(memoryAllocator, &target->imageMemory);
+  vkDestroyBuffer(device, target->tileBuffer, nullptr);
+  freeGpuMemory(memoryAllocator, &target->tileMemory);
+  *target = {};
+}
+
+void readRayMarchStats(RayMarchPass* pass, u32 frameIndex) {
+  RayMarchFrame* frame = &pass->frames[frameIndex];
+  if (!frame->pending) {
+    return;
+  }
+  frame->pending = false;
+
+  RayMarchResults results;
+  results.frameNumber = frame->frameNumber;
+  results.pixelCount = frame->pixelCount;
+  results.tileCount = frame->tileCount;
+  memcpy(&results.stats, frame->statsMemory.mapped, sizeof(results.stats));
+  pass->latest = results;
+}
+
+const RayMarchResults* getLatestRayMarchResults(const RayMarchPass* pass) {
+  return pass->latest.frameNumber != UINT64_MAX ? &pass->latest : nullptr;
+}
+
+void printRayMarchResults(const RayMarchPass* pass) {
+  const RayMarchResults* results = getLatestRayMarchResults(pass);
+  if (results == nullptr) {
+    return;
+  }
+  const RayMarchStats& stats = results->stats;
+  u64 totalSteps = (u64)stats.tileSteps + stats.pixelSteps;
+  std::cout << "ray march (" << (pass->tileSkipping ? "tiled" : "per pixel") << "): " << totalSteps << " steps in frame "
+            << results->frameNumber << " (tiles " << stats.tileSteps << ", pixels " << stats.pixelSteps << "), "
+            << (f64)totalSteps / results->pixelCount << " steps/pixel, " << stats.hitPixels << " of " << results->pixelCount
+            << " pixels hit, " << stats.emptyTiles << " of " << results->tileCount << " tiles empty" << std::endl;
+}
+
+/*
+ * - Point the frame's descriptor set at the target if it refers to another one (ex: the swap chain was recreated).
+ *   The frame's previous command buffer has completed, so the set is no longer in use. Targets are compared by
+ *   generation rather than by handle, a new target may reuse a destroyed one's handles.
+ * - Clear the stats, the image's previous contents are discarded
+ * - Tile pass, when skipping, then the pixel pass reading the tile distances
+ * - Make the image visible to the composite and the stats to the host
+ */
+void cmdRayMarch(VkCommandBuffer commandBuffer, VkDevice device, RayMarchPass* pass, u32 frameIndex, u64 frameNumber,
+                 const RayMarchTarget& target, const RayMarchScene& scene, GpuQueries* gpuQueries) {
+  RayMarchFrame* frame = &pass->frames[frameIndex];
+  if (frame->boundGeneration != target.generation) {
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageView = target.imageView;
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    VkDescriptorBufferInfo tileInfo{};
+    tileInfo.buffer = target.tileBuffer;
+    tileInfo.offset = 0;
+    tileInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet descriptorWrites[2]{};
+    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[0].dstSet = frame->descriptorSet;
+    descriptorWrites[0].dstBinding = RAY_MARCH_IMAGE_BINDING;
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    descriptorWrites[0].descriptorCount = 1;
+    descriptorWrites[0].pImageInfo = &imageInfo;
+    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[1].dstSet = frame->descriptorSet;
+    descriptorWrites[1].dstBinding = RAY_MARCH_TILE_BUFFER_BINDING;
+    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[1].descriptorCount = 1;
+    descriptorWrites[1].pBufferInfo = &tileInfo;
+    vkUpdateDescriptorSets(device, 2, descriptorWrites, 0, nullptr);
+    frame->boundGeneration = target.generation;
+  }
+  frame->frameNumber = frameNumber;
+  frame->pixelCount = target.extent.width * target.extent.height;
+  frame->tileCount = target.tileCountX * target.tileCountY;
+  frame->pending = true;
+
+  vkCmdFillBuffer(commandBuffer, frame->statsBuffer, 0, VK_WHOLE_SIZE, 0);
+  cmdBufferBarrier(commandBuffer, frame->statsBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+  // The previous frame's composite and pixel pass may still be reading the image and tile buffer (write after read)
+  cmdImageBarrier(commandBuffer, target.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+
+  RayMarchPushConstants pushConstants;
+  pushConstants.scene = scene;
+  pushConstants.scene.resolution = glm::vec2((f32)target.extent.width, (f32)target.extent.height);
+  pushConstants.tileCount[0] = target.tileCountX;
+  pushConstants.tileCount[1] = target.tileCountY;
+
+  if (pass->tileSkipping) {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pass->tilePipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pass->tilePipelineLayout, 0, 1, &frame->descriptorSet, 0, nullptr);
+    cmdPushConstants(commandBuffer, pass->tilePipelineLayout, RAY_MARCH_PUSH_CONSTANT_RANGE, pushConstants);
+    cmdDispatchThreads(commandBuffer, target.tileCountX, target.tileCountY, 1, RAY_MARCH_TILE_SIZE, RAY_MARCH_TILE_SIZE, 1);
+    cmdWriteGpuTimestamp(commandBuffer, gpuQueries, frameIndex, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, "ray march tiles");
+    cmdBufferBarrier(commandBuffer, target.tileBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+  }
+
+  // one workgroup per tile
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pass->pixelPipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pass->pixelPipelineLayout, 0, 1, &frame->descriptorSet, 0, nullptr);
+  cmdPushConstants(commandBuffer, pass->pixelPipelineLayout, RAY_MARCH_PUSH_CONSTANT_RANGE, pushConstants);
+  cmdDispatchThreads(commandBuffer, target.extent.width, target.extent.height, 1, RAY_MARCH_TILE_SIZE, RAY_MARCH_TILE_SIZE, 1);
+  cmdWriteGpuTimestamp(commandBuffer, gpuQueries, frameIndex, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, "ray march pixels");
+
+  cmdImageBarrier(commandBuffer, target.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+  cmdBufferBarrier(commandBuffer, frame->statsBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                   VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+}
+
+void cmdDrawRayMarchComposite(VkCommandBuffer commandBuffer, const RayMarchPass* pass, u32 frameIndex, VkExtent2D extent) {
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pass->compositePipeline);
+
+  VkViewport viewport{};
+  viewport.width = (f32)extent.width;
+  viewport.height = (f32)extent.height;
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  VkRect2D scissor{};
+  scissor.extent = extent;
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pass->compositePipelineLayout, 0, 1,
+                          &pass->frames[frameIndex].descriptorSet, 0, nullptr);
+  vkCmdDraw(commandBuffer, 3, 1, 0, 0); // FullScreenTriangle.vert
+}
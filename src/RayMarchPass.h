@@ -0,0 +1,113 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include "KuringTypes.h"
+#include "VulkanUtil.h"
+#include "GpuMemoryAllocator.h"
+#include "GpuQueries.h"
+#include "UniformStructs.h"
+
+// Compute alternative to RayMarchSphere.frag: the scene is ray marched into a storage image by two dispatches of
+// RayMarchSphere.comp, then composited inside the render pass by a full screen triangle (RayMarchComposite.frag).
+//  - Tile pass: one cone per RAY_MARCH_TILE_SIZE^2 pixel tile, enclosing all of the tile's rays, is marched until it
+//    may touch a surface. The distance reached is a conservative start for every ray of the tile, tiles whose cone
+//    escapes past the miss distance are empty.
+//  - Pixel pass: one workgroup per tile, rays start at their tile's distance and empty tiles are not marched at all.
+// Without tile skipping the tile pass is not dispatched and every ray starts at the camera, as in RayMarchSphere.frag.
+// Steps (distance evaluations) of both passes are counted on the GPU and read back per frame in flight.
+const u32 RAY_MARCH_TILE_SIZE = 8; // in pixels, also the local size of both passes (see RayMarchSphere.comp)
+const u32 RAY_MARCH_IMAGE_BINDING = 0;
+const u32 RAY_MARCH_TILE_BUFFER_BINDING = 1;
+const u32 RAY_MARCH_STATS_BUFFER_BINDING = 2;
+// constant_id of the specialization constants, quality ones are shared by RayMarchSphere.frag and RayMarchSphere.comp
+const u32 RAY_MARCH_MAX_STEPS_CONSTANT_ID = 0;
+const u32 RAY_MARCH_HIT_DIST_CONSTANT_ID = 1;
+const u32 RAY_MARCH_PASS_CONSTANT_ID = 2;
+const u32 RAY_MARCH_TILE_SKIPPING_CONSTANT_ID = 3;
+const u32 RAY_MARCH_TILE_PASS = 0;
+const u32 RAY_MARCH_PIXEL_PASS = 1;
+
+// Matches RayMarchSphere.comp's Stats buffer, zeroed at the start of every frame
+struct RayMarchStats {
+  u32 tileSteps;
+  u32 pixelSteps;
+  u32 emptyTiles;
+  u32 hitPixels;
+};
+
+// Matches RayMarchSphere.comp's PushConstants, the scene is the one RayMarchSphere.frag is given
+struct RayMarchPushConstants {
+  RayMarchScene scene; // resolution is the target's extent
+  alignas(8) u32 tileCount[2];
+};
+
+const VkPushConstantRange RAY_MARCH_PUSH_CONSTANT_RANGE = pushConstantRange<RayMarchPushConstants>(VK_SHADER_STAGE_COMPUTE_BIT);
+
+// Extent dependent resources, recreated along with the swap chain
+struct RayMarchTarget {
+  VkImage image; // VK_FORMAT_R8G8B8A8_UNORM, alpha 0 where the ray missed. Kept in VK_IMAGE_LAYOUT_GENERAL.
+  GpuAllocation imageMemory;
+  VkImageView imageView;
+  VkBuffer tileBuffer; // f32 start distance per tile, negative when empty
+  GpuAllocation tileMemory;
+  VkExtent2D extent;
+  u32 tileCountX;
+  u32 tileCountY;
+  u64 generation; // unique per target, handles may be reused once a target is destroyed
+};
+
+struct RayMarchFrame {
+  VkBuffer statsBuffer;
+  GpuAllocation statsMemory; // host visible, read once the frame's fence has been waited on
+  VkDescriptorSet descriptorSet;
+  u64 boundGeneration; // target the descriptor set refers to, 0 before the first, updated when the frame records against another one
+  u64 frameNumber; // frame that last wrote the stats
+  u32 pixelCount;
+  u32 tileCount;
+  bool32 pending; // written and submitted, but not yet read back
+};
+
+// Read back stats of a single frame
+struct RayMarchResults {
+  u64 frameNumber;
+  u32 pixelCount;
+  u32 tileCount;
+  RayMarchStats stats;
+};
+
+struct RayMarchPass {
+  bool32 tileSkipping;
+  VkDescriptorSetLayout descriptorSetLayout; // image, tiles and stats, shared by both passes and the composite
+  VkDescriptorPool descriptorPool;
+  VkPipeline tilePipeline; // VK_NULL_HANDLE without tile skipping
+  VkPipelineLayout tilePipelineLayout;
+  VkPipeline pixelPipeline;
+  VkPipelineLayout pixelPipelineLayout;
+  VkPipeline compositePipeline;
+  VkPipelineLayout compositePipelineLayout;
+  u32 frameCount;
+  RayMarchFrame* frames;
+  RayMarchResults latest; // most recently read back stats, see getLatestRayMarchResults
+};
+
+// NOTE: The pipelines are built by the caller with descriptorSetLayout, RAY_MARCH_PUSH_CONSTANT_RANGE and the
+// specialization constants above, they are destroyed along with the pass
+void initRayMarchPass(VkDevice device, GpuMemoryAllocator* memoryAllocator, u32 frameCount, bool32 tileSkipping, RayMarchPass* pass);
+void destroyRayMarchPass(VkDevice device, GpuMemoryAllocator* memoryAllocator, RayMarchPass* pass);
+void initRayMarchTarget(VkDevice device, GpuMemoryAllocator* memoryAllocator, VkExtent2D extent, RayMarchTarget* target);
+// NOTE: The target must no longer be in use by the GPU
+void destroyRayMarchTarget(VkDevice device, GpuMemoryAllocator* memoryAllocator, RayMarchTarget* target);
+
+// NOTE: Only call once the frame in flight's fence has been waited on
+void readRayMarchStats(RayMarchPass* pass, u32 frameIndex);
+// Returns nullptr until the first stats have been read back
+const RayMarchResults* getLatestRayMarchResults(const RayMarchPass* pass);
+void printRayMarchResults(const RayMarchPass* pass);
+
+// Recorded outside of a render pass: clears the frame's stats, dispatches the tile (when skipping) and pixel passes
+// and makes the image visible to fragment shaders. Timestamps follow each dispatch.
+// NOTE: Only call once the frame in flight's fence has been waited on, its descriptor set may be updated
+void cmdRayMarch(VkCommandBuffer commandBuffer, VkDevice device, RayMarchPass* pass, u32 frameIndex, u64 frameNumber,
+                 const RayMarchTarget& target, const RayMarchScene& scene, GpuQueries* gpuQueries);
+// Recorded inside the render pass, before anything that should be drawn over the ray marched scene
+void cmdDrawRayMarchComposite(VkCommandBuffer commandBuffer, const RayMarchPass* pass, u32 frameIndex, VkExtent2D extent);
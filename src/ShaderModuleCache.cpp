@@ -0,0 +1,168 @@
+#include "ShaderModuleCache.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <string.h>
+#include "MappedFile.h"
+#include "Util.h"
+
+const u32 SPIRV_MAGIC_NUMBER = 0x07230203;
+
+internal_access s32 findPath(const ShaderModuleCache* cache, const char* filePath) {
+  for (u32 i = 0; i < cache->paths.size(); ++i) {
+    if (cache->paths[i].filePath == filePath) {
+      return (s32)i;
+    }
+  }
+  return -1;
+}
+
+internal_access s32 findEntry(const ShaderModuleCache* cache, u64 contentHash, const u32* code, u64 codeSize) {
+  for (u32 i = 0; i < cache->entries.size(); ++i) {
+    const ShaderModuleCacheEntry& entry = cache->entries[i];
+    if (entry.contentHash == contentHash && entry.code.size() * sizeof(u32) == codeSize && memcmp(entry.code.data(), code, codeSize) == 0) {
+      return (s32)i;
+    }
+  }
+  return -1;
+}
+
+internal_access void bindPath(ShaderModuleCache* cache, const char* filePath, u32 entryIndex) {
+  s32 pathIndex = findPath(cache, filePath);
+  if (pathIndex >= 0) {
+    cache->paths[pathIndex].entryIndex = entryIndex;
+  } else {
+    cache->paths.push_back({filePath, entryIndex});
+  }
+}
+
+internal_access VkShaderModule reuseEntry(ShaderModuleCache* cache, const char* filePath, u32 entryIndex) {
+  bindPath(cache, filePath, entryIndex);
+  const ShaderModuleCacheEntry& entry = cache->entries[entryIndex];
+  cache->stats.modulesAvoided++;
+  cache->stats.bytesAvoided += entry.code.size() * sizeof(u32);
+  return entry.module;
+}
+
+void initShaderModuleCache(VkDevice device, ShaderModuleCache* cache) {
+  cache->device = device;
+  cache->entries.clear();
+  cache->paths.clear();
+  cache->stats = {};
+}
+
+void destroyShaderModuleCache(ShaderModuleCache* cache) {
+  for (ShaderModuleCacheEntry& entry : cache->entries) {
+    vkDestroyShaderModule(cache->device, entry.module, nullptr);
+  }
+  cache->entries.clear();
+  cache->paths.clear();
+}
+
+/*
+ * - Return the module the path was last loaded into, without touching the file
+ * - Otherwise map the SPIR-V file, the mapping is page aligned so the code is handed to the driver in place
+ * - Hash its contents and return the existing module with identical code, if any. Hash hits are compared in full.
+ * - Otherwise create a new module
+ *    - The cache isn't locked while the file is read or the driver creates the module, if another thread created an
+ *      identical module in the meantime, it is returned instead and ours is destroyed
+ */
+VkShaderModule acquireShaderModule(ShaderModuleCache* cache, const char* filePath) {
+  {
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    s32 pathIndex = findPath(cache, filePath);
+    if (pathIndex >= 0) {
+      return reuseEntry(cache, filePath, cache->paths[pathIndex].entryIndex);
+    }
+  }
+
+  MappedFile spirvFile;
+  mapSpirvFile(filePath, &spirvFile);
+  const u32* code = (const u32*)spirvFile.data;
+  u64 codeSize = spirvFile.size;
+  u64 contentHash = hashBytes(code, codeSize);
+
+  {
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    s32 entryIndex = findEntry(cache, contentHash, code, codeSize);
+    if (entryIndex >= 0) {
+      unmapFile(&spirvFile);
+      return reuseEntry(cache, filePath, (u32)entryIndex);
+    }
+  }
+
+  VkShaderModuleCreateInfo shaderModuleCI = {};
+  shaderModuleCI.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCI.codeSize = codeSize;
+  shaderModuleCI.pCode = code;
+
+  VkShaderModule shaderModule;
+  VkResult result = vkCreateShaderModule(cache->device, &shaderModuleCI, nullptr, &shaderModule);
+  if (result != VK_SUCCESS) {
+    unmapFile(&spirvFile);
+    throw std::runtime_error("failed to create shader module!");
+  }
+
+  std::lock_guard<std::mutex> lock(cache->mutex);
+  s32 racingIndex = findEntry(cache, contentHash, code, codeSize);
+  if (racingIndex >= 0) {
+    unmapFile(&spirvFile);
+    vkDestroyShaderModule(cache->device, shaderModule, nullptr);
+    return reuseEntry(cache, filePath, (u32)racingIndex);
+  }
+
+  ShaderModuleCacheEntry entry;
+  entry.contentHash = contentHash;
+  entry.code.assign(code, code + codeSize / sizeof(u32));
+  entry.module = shaderModule;
+  unmapFile(&spirvFile);
+  cache->entries.push_back(std::move(entry));
+  bindPath(cache, filePath, (u32)cache->entries.size() - 1);
+  cache->stats.modulesCreated++;
+  cache->stats.bytesCreated += codeSize;
+  return shaderModule;
+}
+
+void invalidateShaderModule(ShaderModuleCache* cache, const char* filePath) {
+  std::lock_guard<std::mutex> lock(cache->mutex);
+  s32 pathIndex = findPath(cache, filePath);
+  if (pathIndex >= 0) {
+    cache->paths.erase(cache->paths.begin() + pathIndex);
+  }
+}
+
+void mapSpirvFile(const char* filePath, MappedFile* spirvFile) {
+  if (!mapFile(filePath, spirvFile)) {
+    throw std::runtime_error(std::string("failed to open file:") + filePath);
+  }
+  // empty files map with a null data pointer, the size is checked before the magic number is read
+  const u32* code = (const u32*)spirvFile->data;
+  if (spirvFile->size < sizeof(u32) || (spirvFile->size % sizeof(u32)) != 0 || code[0] != SPIRV_MAGIC_NUMBER) {
+    unmapFile(spirvFile);
+    throw std::runtime_error(std::string("invalid SPIR-V file:") + filePath);
+  }
+}
+
+// Mapping is page aligned, so the SPIR-V words can be handed to the driver in place
+VkShaderModule createShaderModule(VkDevice device, const char* filePath, const VkAllocationCallbacks* allocator) {
+  MappedFile spirvFile;
+  mapSpirvFile(filePath, &spirvFile);
+
+  VkShaderModuleCreateInfo shaderModuleCI = {};
+  shaderModuleCI.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCI.codeSize = spirvFile.size;
+  shaderModuleCI.pCode = (const u32*)spirvFile.data;
+  VkShaderModule shaderModule;
+  VkResult result = vkCreateShaderModule(device, &shaderModuleCI, allocator, &shaderModule);
+  unmapFile(&spirvFile);
+  if (result != VK_SUCCESS) {
+    throw std::runtime_error("failed to create shader module!");
+  }
+  return shaderModule;
+}
+
+void printShaderModuleCacheStats(ShaderModuleCache* cache) {
+  std::lock_guard<std::mutex> lock(cache->mutex);
+  std::cout << "shader module cache: " << cache->stats.modulesCreated << " modules created (" << cache->stats.bytesCreated << " bytes), "
+            << cache->stats.modulesAvoided << " avoided (" << cache->stats.bytesAvoided << " bytes)" << std::endl;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <vector>
+#include <string>
+#include <mutex>
+#include "KuringTypes.h"
+#include "MappedFile.h"
+
+struct ShaderModuleCacheEntry {
+  u64 contentHash;
+  std::vector<u32> code; // compared on hash hits, a collision must not return another shader's module
+  VkShaderModule module;
+};
+
+struct ShaderModuleCachePath {
+  std::string filePath;
+  u32 entryIndex; // module the file was last loaded into
+};
+
+// Shader modules shared across pipelines. Modules are looked up by path first, so a file is only mapped and hashed the
+// first time it is acquired (or after invalidateShaderModule). New files are memory mapped rather than read into
+// intermediate buffers and matched by content, so an identical copy under another path is only handed to the driver
+// once. A file whose contents change gets a new module once invalidated, earlier modules remain valid for the cache's
+// lifetime. Safe to use from multiple threads (ex: PipelineBatch workers).
+struct ShaderModuleCache {
+  VkDevice device;
+  std::mutex mutex;
+  std::vector<ShaderModuleCacheEntry> entries;
+  std::vector<ShaderModuleCachePath> paths;
+  struct {
+    u32 modulesCreated;
+    u64 bytesCreated;
+    u32 modulesAvoided; // requests served by an existing module
+    u64 bytesAvoided;
+  } stats;
+};
+
+void initShaderModuleCache(VkDevice device, ShaderModuleCache* cache);
+void destroyShaderModuleCache(ShaderModuleCache* cache);
+// NOTE: The returned module is owned by the cache and must not be destroyed by the caller
+VkShaderModule acquireShaderModule(ShaderModuleCache* cache, const char* filePath);
+// The file changed on disk (ex: recompiled by a shader hot reload), the next acquire loads it again
+void invalidateShaderModule(ShaderModuleCache* cache, const char* filePath);
+void printShaderModuleCacheStats(ShaderModuleCache* cache);
+
+// Maps a SPIR-V file, throws if it can't be opened or isn't SPIR-V (not a whole number of words, wrong magic number)
+void mapSpirvFile(const char* filePath, MappedFile* spirvFile);
+// Uncached, the module is owned by the caller
+VkShaderModule createShaderModule(VkDevice device, const char* filePath, const VkAllocationCallbacks* allocator);
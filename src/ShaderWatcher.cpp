@@ -0,0 +1,184 @@
+#include "ShaderWatcher.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+internal_access bool32 endsWith(const std::string& str, const char* suffix) {
+  size_t suffixLength = strlen(suffix);
+  return str.size() >= suffixLength && str.compare(str.size() - suffixLength, suffixLength, suffix) == 0;
+}
+
+internal_access bool32 isShaderSource(const std::string& fileName) {
+  return endsWith(fileName, ".vert") || endsWith(fileName, ".frag") || endsWith(fileName, ".comp");
+}
+
+internal_access void addUnique(std::vector<std::string>* names, const std::string& name) {
+  for (const std::string& existing : *names) {
+    if (existing == name) {
+      return;
+    }
+  }
+  names->push_back(name);
+}
+
+// Shader sources currently in the directory, along with their last write time
+internal_access std::vector<WatchedShaderSource> listShaderSources(const std::string& directory) {
+  std::vector<WatchedShaderSource> sources;
+#if defined(_WIN32)
+  WIN32_FIND_DATAA findData;
+  HANDLE findHandle = FindFirstFileA((directory + "/*").c_str(), &findData);
+  if (findHandle == INVALID_HANDLE_VALUE) {
+    return sources;
+  }
+  do {
+    std::string name = findData.cFileName;
+    if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && isShaderSource(name)) {
+      s64 lastWriteTime = ((s64)findData.ftLastWriteTime.dwHighDateTime << 32) | findData.ftLastWriteTime.dwLowDateTime;
+      sources.push_back({name, lastWriteTime});
+    }
+  } while (FindNextFileA(findHandle, &findData));
+  FindClose(findHandle);
+#else
+  DIR* dir = opendir(directory.c_str());
+  if (dir == nullptr) {
+    return sources;
+  }
+  while (dirent* entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    struct stat fileStat;
+    if (isShaderSource(name) && stat((directory + "/" + name).c_str(), &fileStat) == 0 && S_ISREG(fileStat.st_mode)) {
+      sources.push_back({name, (s64)fileStat.st_mtime});
+    }
+  }
+  closedir(dir);
+#endif
+  return sources;
+}
+
+/*
+ * - Watch the source directory with inotify where available, only close-after-write and rename-into events are
+ *   reported so that sources are never picked up half written (editors often save through a rename)
+ * - Otherwise snapshot the modification time of every source, to be compared against when polling
+ */
+void initShaderWatcher(const char* sourceDirectory, const char* outputDirectory, ShaderWatcher* watcher) {
+  watcher->sourceDirectory = sourceDirectory;
+  watcher->outputDirectory = outputDirectory;
+  const char* compilerPath = getenv("GLSLC");
+  watcher->compilerPath = compilerPath != nullptr ? compilerPath : "glslc";
+  watcher->inotifyFileDescriptor = -1;
+  watcher->lastPoll = std::chrono::steady_clock::now();
+
+#if defined(__linux__)
+  int inotifyFileDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotifyFileDescriptor >= 0) {
+    if (inotify_add_watch(inotifyFileDescriptor, sourceDirectory, IN_CLOSE_WRITE | IN_MOVED_TO) >= 0) {
+      watcher->inotifyFileDescriptor = inotifyFileDescriptor;
+      return;
+    }
+    close(inotifyFileDescriptor);
+  }
+#endif
+
+  watcher->sources = listShaderSources(watcher->sourceDirectory);
+}
+
+void destroyShaderWatcher(ShaderWatcher* watcher) {
+#if defined(__linux__)
+  if (watcher->inotifyFileDescriptor >= 0) {
+    close(watcher->inotifyFileDescriptor);
+    watcher->inotifyFileDescriptor = -1;
+  }
+#endif
+  watcher->sources.clear();
+}
+
+internal_access void pollModificationTimes(ShaderWatcher* watcher, std::vector<std::string>* changedSources) {
+  std::chrono::steady_clock::time_point currentTime = std::chrono::steady_clock::now();
+  if (std::chrono::duration<f64>(currentTime - watcher->lastPoll).count() < SHADER_WATCHER_POLL_INTERVAL_SECONDS) {
+    return;
+  }
+  watcher->lastPoll = currentTime;
+
+  std::vector<WatchedShaderSource> currentSources = listShaderSources(watcher->sourceDirectory);
+  for (const WatchedShaderSource& current : currentSources) {
+    bool32 changed = true;
+    for (const WatchedShaderSource& previous : watcher->sources) {
+      if (previous.name == current.name) {
+        changed = previous.lastWriteTime != current.lastWriteTime;
+        break;
+      }
+    }
+    if (changed) {
+      addUnique(changedSources, current.name);
+    }
+  }
+  watcher->sources = currentSources;
+}
+
+void pollShaderChanges(ShaderWatcher* watcher, std::vector<std::string>* changedSources) {
+#if defined(__linux__)
+  if (watcher->inotifyFileDescriptor >= 0) {
+    alignas(inotify_event) char buffer[4096];
+    for (;;) {
+      ssize_t bytesRead = read(watcher->inotifyFileDescriptor, buffer, sizeof(buffer));
+      if (bytesRead <= 0) {
+        return; // EAGAIN, no more pending events
+      }
+      for (char* event = buffer; event < buffer + bytesRead; ) {
+        inotify_event* inotifyEvent = (inotify_event*)event;
+        if (inotifyEvent->len > 0 && isShaderSource(inotifyEvent->name)) {
+          addUnique(changedSources, inotifyEvent->name);
+        }
+        event += sizeof(inotify_event) + inotifyEvent->len;
+      }
+    }
+  }
+#endif
+  pollModificationTimes(watcher, changedSources);
+}
+
+std::string shaderOutputPath(const ShaderWatcher* watcher, const std::string& sourceName) {
+  return watcher->outputDirectory + sourceName + ".spv";
+}
+
+/*
+ * - Compile to a temporary file next to the output with glslc
+ * - Replace the output only once compilation succeeded, so a failed compile leaves the last good SPIR-V in place
+ */
+bool32 compileShader(const ShaderWatcher* watcher, const std::string& sourceName) {
+  std::string sourcePath = watcher->sourceDirectory + "/" + sourceName;
+  std::string outputPath = shaderOutputPath(watcher, sourceName);
+  std::string tempOutputPath = outputPath + ".tmp";
+
+  std::string command = "\"" + watcher->compilerPath + "\" -o \"" + tempOutputPath + "\" \"" + sourcePath + "\"";
+#if defined(_WIN32)
+  command = "\"" + command + "\""; // cmd.exe strips the outer quotes
+#endif
+  if (system(command.c_str()) != 0) {
+    remove(tempOutputPath.c_str());
+    return false;
+  }
+
+#if defined(_WIN32)
+  bool32 replaced = MoveFileExA(tempOutputPath.c_str(), outputPath.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+  bool32 replaced = rename(tempOutputPath.c_str(), outputPath.c_str()) == 0; // atomic on POSIX
+#endif
+  if (!replaced) {
+    remove(tempOutputPath.c_str());
+  }
+  return replaced;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include "KuringTypes.h"
+
+const f64 SHADER_WATCHER_POLL_INTERVAL_SECONDS = 0.25;
+
+struct WatchedShaderSource {
+  std::string name; // file name within the source directory, ex: "RayMarchSphere.frag"
+  s64 lastWriteTime;
+};
+
+// Watches a directory of GLSL sources (.vert/.frag/.comp) for changes. Uses inotify on Linux and falls back to polling
+// modification times elsewhere, or if inotify is unavailable. Never blocks.
+struct ShaderWatcher {
+  std::string sourceDirectory;
+  std::string outputDirectory; // compiled SPIR-V is written here as "<name>.spv"
+  std::string compilerPath; // glslc, from the GLSLC environment variable when set
+  int inotifyFileDescriptor; // -1 when polling
+  std::vector<WatchedShaderSource> sources; // polling only
+  std::chrono::steady_clock::time_point lastPoll;
+};
+
+void initShaderWatcher(const char* sourceDirectory, const char* outputDirectory, ShaderWatcher* watcher);
+void destroyShaderWatcher(ShaderWatcher* watcher);
+// Appends the names of sources changed since the last call to changedSources, skipping names already present
+void pollShaderChanges(ShaderWatcher* watcher, std::vector<std::string>* changedSources);
+// Compiles a source to SPIR-V. The existing SPIR-V file is only replaced when compilation succeeds, compiler errors
+// are left on stderr.
+bool32 compileShader(const ShaderWatcher* watcher, const std::string& sourceName);
+std::string shaderOutputPath(const ShaderWatcher* watcher, const std::string& sourceName);
@@ -0,0 +1,122 @@
+#include "StagingRingBuffer.h"
+
+#include <stdexcept>
+#include "Util.h"
+
+internal_access void createStagingBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator, VkDeviceSize capacity,
+                                         StagingRingBuffer* ringBuffer) {
+  ringBuffer->buffer = createBuffer(device, capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+
+  // Coherent memory may stay mapped for its entire lifetime, no flushes required
+  ringBuffer->memory = allocateBufferMemory(memoryAllocator, ringBuffer->buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  ringBuffer->capacity = capacity;
+  ringBuffer->head = 0;
+  ringBuffer->tail = 0;
+  ringBuffer->regionStart = 0;
+}
+
+void initStagingRingBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator, VkDeviceSize capacity, VkDeviceSize maxCapacity,
+                           StagingRingBuffer* ringBuffer) {
+  ringBuffer->maxCapacity = alignUp(maxCapacity, STAGING_RING_ALIGNMENT);
+  ringBuffer->growCount = 0;
+  createStagingBuffer(device, memoryAllocator, min(alignUp(capacity, STAGING_RING_ALIGNMENT), ringBuffer->maxCapacity), ringBuffer);
+}
+
+void destroyStagingRingBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator, StagingRingBuffer* ringBuffer) {
+  for (RetiredStagingBuffer& retired : ringBuffer->retiredBuffers) {
+    vkDestroyBuffer(device, retired.buffer, nullptr);
+    freeGpuMemory(memoryAllocator, &retired.memory);
+  }
+  ringBuffer->retiredBuffers.clear();
+  ringBuffer->regions.clear();
+  vkDestroyBuffer(device, ringBuffer->buffer, nullptr);
+  freeGpuMemory(memoryAllocator, &ringBuffer->memory);
+}
+
+/*
+ * - Allocations never straddle the end of the buffer, the remainder is skipped and the allocation starts over at zero
+ * - In use positions span [tail, head), so the allocation fits while its end is within capacity of the tail
+ */
+bool32 allocateStaging(StagingRingBuffer* ringBuffer, VkDeviceSize size, StagingAllocation* allocation) {
+  VkDeviceSize alignedSize = alignUp(size, STAGING_RING_ALIGNMENT);
+  if (alignedSize > ringBuffer->capacity) {
+    return false;
+  }
+  if (ringBuffer->head == ringBuffer->tail) {
+    // Nothing in use, restart at offset zero so the whole capacity is contiguous
+    ringBuffer->head = alignUp(ringBuffer->head, ringBuffer->capacity);
+    ringBuffer->tail = ringBuffer->head;
+    ringBuffer->regionStart = ringBuffer->head;
+  }
+
+  u64 start = ringBuffer->head;
+  VkDeviceSize offset = start % ringBuffer->capacity;
+  if (offset + alignedSize > ringBuffer->capacity) {
+    start += ringBuffer->capacity - offset;
+    offset = 0;
+  }
+  if (start + alignedSize - ringBuffer->tail > ringBuffer->capacity) {
+    return false;
+  }
+
+  ringBuffer->head = start + alignedSize;
+  allocation->data = ringBuffer->memory.mapped + offset;
+  allocation->buffer = ringBuffer->buffer;
+  allocation->offset = offset;
+  return true;
+}
+
+void closeStagingRegion(StagingRingBuffer* ringBuffer, u64 timelineValue) {
+  if (ringBuffer->head == ringBuffer->regionStart) {
+    return;
+  }
+  ringBuffer->regions.push_back({ringBuffer->head, timelineValue});
+  ringBuffer->regionStart = ringBuffer->head;
+}
+
+void releaseStagingRegions(VkDevice device, GpuMemoryAllocator* memoryAllocator, StagingRingBuffer* ringBuffer, u64 completedValue) {
+  while (!ringBuffer->regions.empty() && ringBuffer->regions.front().timelineValue <= completedValue) {
+    ringBuffer->tail = ringBuffer->regions.front().endPosition;
+    ringBuffer->regions.pop_front();
+  }
+
+  u32 keptCount = 0;
+  for (RetiredStagingBuffer& retired : ringBuffer->retiredBuffers) {
+    if (retired.timelineValue <= completedValue) {
+      vkDestroyBuffer(device, retired.buffer, nullptr);
+      freeGpuMemory(memoryAllocator, &retired.memory);
+    } else {
+      ringBuffer->retiredBuffers[keptCount++] = retired;
+    }
+  }
+  ringBuffer->retiredBuffers.resize(keptCount);
+}
+
+/*
+ * - Retire the current buffer rather than waiting on the copies still reading from it
+ * - The new buffer starts out empty, regions of the retired buffer are covered by its retire value
+ */
+bool32 growStagingRingBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator, StagingRingBuffer* ringBuffer, VkDeviceSize minCapacity,
+                             u64 retireValue) {
+  if (ringBuffer->capacity >= ringBuffer->maxCapacity) {
+    return false;
+  }
+
+  VkDeviceSize capacity = ringBuffer->capacity * 2;
+  while (capacity < minCapacity) {
+    capacity *= 2;
+  }
+  capacity = min(capacity, ringBuffer->maxCapacity);
+
+  if (ringBuffer->head == ringBuffer->tail) {
+    // Nothing in use, destroy right away
+    vkDestroyBuffer(device, ringBuffer->buffer, nullptr);
+    freeGpuMemory(memoryAllocator, &ringBuffer->memory);
+  } else {
+    ringBuffer->retiredBuffers.push_back({ringBuffer->buffer, ringBuffer->memory, retireValue});
+  }
+  ringBuffer->regions.clear();
+  createStagingBuffer(device, memoryAllocator, capacity, ringBuffer);
+  ++ringBuffer->growCount;
+  return true;
+}
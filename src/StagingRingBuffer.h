@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <vector>
+#include <deque>
+#include "KuringTypes.h"
+#include "GpuMemoryAllocator.h"
+
+const VkDeviceSize DEFAULT_STAGING_RING_CAPACITY = 4ull * 1024 * 1024;
+// Half of a memory block, so the ring stays sub-allocated rather than getting a dedicated allocation
+const VkDeviceSize DEFAULT_STAGING_RING_MAX_CAPACITY = DEFAULT_GPU_MEMORY_BLOCK_SIZE / 2;
+// Copy source offsets are kept aligned for the copy engines (and texel block sizes of future image uploads)
+const VkDeviceSize STAGING_RING_ALIGNMENT = 16;
+
+// Range of the ring written since the previous region, in use until the timeline reaches timelineValue
+struct StagingRegion {
+  u64 endPosition;
+  u64 timelineValue;
+};
+
+// Buffer replaced by growing the ring, may still be read by submitted copies
+struct RetiredStagingBuffer {
+  VkBuffer buffer;
+  GpuAllocation memory;
+  u64 timelineValue;
+};
+
+// Persistently mapped staging buffer shared by every upload. Space is handed out linearly, wrapping around to the
+// start, and grouped into regions that are recycled in bulk once the timeline semaphore signaled by their submit
+// has been reached. Positions increase monotonically, the offset within the buffer is position % capacity.
+struct StagingRingBuffer {
+  VkBuffer buffer;
+  GpuAllocation memory;
+  VkDeviceSize capacity;
+  VkDeviceSize maxCapacity;
+  u64 head; // next free position
+  u64 tail; // oldest position still in use
+  u64 regionStart; // start of the region not yet closed
+  std::deque<StagingRegion> regions; // closed, oldest first
+  std::vector<RetiredStagingBuffer> retiredBuffers;
+  u32 growCount;
+};
+
+struct StagingAllocation {
+  u8* data;
+  VkBuffer buffer;
+  VkDeviceSize offset; // within buffer
+};
+
+void initStagingRingBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator, VkDeviceSize capacity, VkDeviceSize maxCapacity,
+                           StagingRingBuffer* ringBuffer);
+// NOTE: The GPU must have finished every copy reading from the ring
+void destroyStagingRingBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator, StagingRingBuffer* ringBuffer);
+
+// Returns false when there is not enough contiguous free space, without allocating
+bool32 allocateStaging(StagingRingBuffer* ringBuffer, VkDeviceSize size, StagingAllocation* allocation);
+// Everything allocated since the previous close is recycled once the timeline reaches timelineValue
+void closeStagingRegion(StagingRingBuffer* ringBuffer, u64 timelineValue);
+// Recycles regions and destroys retired buffers the GPU is done with
+void releaseStagingRegions(VkDevice device, GpuMemoryAllocator* memoryAllocator, StagingRingBuffer* ringBuffer, u64 completedValue);
+// Replaces the buffer with one of at least minCapacity (doubling, up to maxCapacity). The previous buffer is destroyed
+// once the timeline reaches retireValue. Returns false when already at maxCapacity.
+bool32 growStagingRingBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator, StagingRingBuffer* ringBuffer, VkDeviceSize minCapacity,
+                             u64 retireValue);
@@ -0,0 +1,50 @@
+#include "ThreadPool.h"
+
+internal_access void workerLoop(ThreadPool* threadPool) {
+  for (;;) {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(threadPool->mutex);
+      threadPool->jobAvailable.wait(lock, [threadPool] { return threadPool->stopping || !threadPool->jobs.empty(); });
+      if (threadPool->jobs.empty()) {
+        return; // stopping and drained
+      }
+      job = std::move(threadPool->jobs.front());
+      threadPool->jobs.pop_front();
+    }
+    job();
+  }
+}
+
+u32 defaultWorkerCount() {
+  u32 hardwareThreads = std::thread::hardware_concurrency();
+  return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+}
+
+void initThreadPool(u32 workerCount, ThreadPool* threadPool) {
+  threadPool->stopping = false;
+  threadPool->workers.reserve(workerCount);
+  for (u32 i = 0; i < workerCount; ++i) {
+    threadPool->workers.emplace_back(workerLoop, threadPool);
+  }
+}
+
+void destroyThreadPool(ThreadPool* threadPool) {
+  {
+    std::lock_guard<std::mutex> lock(threadPool->mutex);
+    threadPool->stopping = true;
+  }
+  threadPool->jobAvailable.notify_all();
+  for (std::thread& worker : threadPool->workers) {
+    worker.join();
+  }
+  threadPool->workers.clear();
+}
+
+void submitJob(ThreadPool* threadPool, std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock(threadPool->mutex);
+    threadPool->jobs.push_back(std::move(job));
+  }
+  threadPool->jobAvailable.notify_one();
+}
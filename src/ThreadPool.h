@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "KuringTypes.h"
+
+// Fixed set of worker threads pulling jobs from a shared FIFO queue
+struct ThreadPool {
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> jobs;
+  std::mutex mutex;
+  std::condition_variable jobAvailable;
+  bool32 stopping;
+};
+
+// One worker per hardware thread, less the calling (main) thread
+u32 defaultWorkerCount();
+void initThreadPool(u32 workerCount, ThreadPool* threadPool);
+// Finishes all queued jobs before joining the workers
+void destroyThreadPool(ThreadPool* threadPool);
+void submitJob(ThreadPool* threadPool, std::function<void()> job);
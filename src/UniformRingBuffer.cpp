@@ -0,0 +1,52 @@
+#include "UniformRingBuffer.h"
+
+#include <stdexcept>
+#include "Util.h"
+#include "VulkanUtil.h"
+
+/*
+ * - Create a single uniform buffer large enough for every frame partition
+ * - Sub-allocate host visible & coherent memory, which the allocator keeps mapped for the lifetime of the ring buffer
+ * - Partitions and sub-allocations are aligned to minUniformBufferOffsetAlignment so that their offsets are valid
+ *   dynamic offsets
+ */
+void initUniformRingBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator,
+                           VkDeviceSize minUniformBufferOffsetAlignment, VkDeviceSize frameCapacity, u32 frameCount,
+                           UniformRingBuffer* ringBuffer) {
+  ringBuffer->alignment = max(minUniformBufferOffsetAlignment, (VkDeviceSize)1);
+  ringBuffer->frameCapacity = alignUp(frameCapacity, ringBuffer->alignment);
+  ringBuffer->frameCount = frameCount;
+  ringBuffer->currentFrame = 0;
+  ringBuffer->head = 0;
+
+  ringBuffer->buffer = createBuffer(device, ringBuffer->frameCapacity * frameCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+  ringBuffer->memory = allocateBufferMemory(memoryAllocator, ringBuffer->buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  ringBuffer->mapped = ringBuffer->memory.mapped;
+}
+
+void destroyUniformRingBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator, UniformRingBuffer* ringBuffer) {
+  vkDestroyBuffer(device, ringBuffer->buffer, nullptr);
+  freeGpuMemory(memoryAllocator, &ringBuffer->memory);
+  ringBuffer->mapped = nullptr;
+}
+
+void beginUniformRingBufferFrame(UniformRingBuffer* ringBuffer, u32 frameIndex) {
+  Assert(frameIndex < ringBuffer->frameCount);
+  ringBuffer->currentFrame = frameIndex;
+  ringBuffer->head = 0;
+}
+
+UniformAllocation allocateUniforms(UniformRingBuffer* ringBuffer, VkDeviceSize size) {
+  VkDeviceSize alignedSize = alignUp(size, ringBuffer->alignment);
+  if (ringBuffer->head + alignedSize > ringBuffer->frameCapacity) {
+    throw std::runtime_error("uniform ring buffer frame partition exhausted!");
+  }
+
+  VkDeviceSize offset = (ringBuffer->currentFrame * ringBuffer->frameCapacity) + ringBuffer->head;
+  ringBuffer->head += alignedSize;
+
+  UniformAllocation allocation;
+  allocation.data = ringBuffer->mapped + offset;
+  allocation.offset = (u32)offset;
+  return allocation;
+}
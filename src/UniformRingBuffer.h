@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include "KuringTypes.h"
+#include "GpuMemoryAllocator.h"
+
+// Persistently mapped uniform buffer split into one partition per frame in flight. Each partition is a linear
+// allocator that hands out transient uniform space for the frame and is reset in bulk once the GPU has finished
+// with that frame. Allocations are bound using dynamic uniform buffer descriptors and their offset.
+struct UniformRingBuffer {
+  VkBuffer buffer;
+  GpuAllocation memory;
+  u8* mapped;
+  VkDeviceSize alignment;
+  VkDeviceSize frameCapacity; // bytes per frame partition
+  u32 frameCount;
+  u32 currentFrame;
+  VkDeviceSize head; // bytes used in the current frame partition
+};
+
+struct UniformAllocation {
+  void* data;
+  u32 offset; // offset from the start of UniformRingBuffer.buffer, to be used as a dynamic offset
+};
+
+void initUniformRingBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator,
+                           VkDeviceSize minUniformBufferOffsetAlignment, VkDeviceSize frameCapacity, u32 frameCount,
+                           UniformRingBuffer* ringBuffer);
+void destroyUniformRingBuffer(VkDevice device, GpuMemoryAllocator* memoryAllocator, UniformRingBuffer* ringBuffer);
+
+// NOTE: Only call once the GPU has finished with the frame previously using the partition (ex: frame fence waited on)
+void beginUniformRingBufferFrame(UniformRingBuffer* ringBuffer, u32 frameIndex);
+UniformAllocation allocateUniforms(UniformRingBuffer* ringBuffer, VkDeviceSize size);
@@ -2,8 +2,21 @@
 
 #include <glm/glm.hpp>
 
+// Per frame data, uniform buffer
 struct TransMats {
-  alignas(16) glm::mat4 model;
   alignas(16) glm::mat4 view;
   alignas(16) glm::mat4 proj;
+};
+
+// Per draw data, push constants
+struct ModelPushConstants {
+  alignas(16) glm::mat4 model;
+};
+
+// RayMarchSphere.frag's camera and scene, push constants
+struct RayMarchScene {
+  alignas(16) glm::vec4 rayOrigin; // xyz
+  alignas(16) glm::vec4 sphere; // xyz center, w radius
+  alignas(8) glm::vec2 resolution;
+  float planeHeight;
 };
\ No newline at end of file
@@ -0,0 +1,298 @@
+#include "UploadQueue.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <string.h>
+#include "Util.h"
+
+/*
+ * - Command pool on the transfer queue family, batches are recorded once (TRANSIENT) and their command buffers reused
+ * - Timeline semaphore starting at zero, each submitted batch signals the next value
+ * - Staging ring starting small, it grows as larger uploads come in
+ */
+void initUploadQueue(VkDevice device, GpuMemoryAllocator* memoryAllocator, VkQueue transferQueue, u32 transferQueueFamilyIndex,
+                     u32 graphicsQueueFamilyIndex, UploadQueue* uploadQueue) {
+  uploadQueue->device = device;
+  uploadQueue->memoryAllocator = memoryAllocator;
+  uploadQueue->transferQueue = transferQueue;
+  uploadQueue->transferQueueFamilyIndex = transferQueueFamilyIndex;
+  uploadQueue->graphicsQueueFamilyIndex = graphicsQueueFamilyIndex;
+  uploadQueue->submittedValue = 0;
+  uploadQueue->completedValue = 0;
+  uploadQueue->recording = {};
+  uploadQueue->pendingWait = {};
+  uploadQueue->pendingAccessMask = 0;
+  uploadQueue->stats = {};
+
+  VkCommandPoolCreateInfo commandPoolCI{};
+  commandPoolCI.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCI.queueFamilyIndex = transferQueueFamilyIndex;
+  commandPoolCI.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  if (vkCreateCommandPool(device, &commandPoolCI, nullptr, &uploadQueue->commandPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create upload command pool!");
+  }
+
+  VkSemaphoreTypeCreateInfo semaphoreTypeCI{};
+  semaphoreTypeCI.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+  semaphoreTypeCI.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+  semaphoreTypeCI.initialValue = 0;
+  VkSemaphoreCreateInfo semaphoreCI{};
+  semaphoreCI.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  semaphoreCI.pNext = &semaphoreTypeCI;
+  if (vkCreateSemaphore(device, &semaphoreCI, nullptr, &uploadQueue->timelineSemaphore) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create upload timeline semaphore!");
+  }
+
+  initStagingRingBuffer(device, memoryAllocator, DEFAULT_STAGING_RING_CAPACITY, DEFAULT_STAGING_RING_MAX_CAPACITY, &uploadQueue->staging);
+}
+
+internal_access void releaseBatch(UploadQueue* uploadQueue, UploadBatch* batch) {
+  if (batch->commandBuffer != VK_NULL_HANDLE) {
+    vkFreeCommandBuffers(uploadQueue->device, uploadQueue->commandPool, 1, &batch->commandBuffer);
+    batch->commandBuffer = VK_NULL_HANDLE;
+  }
+}
+
+internal_access void waitForUploads(UploadQueue* uploadQueue, u64 timelineValue) {
+  if (timelineValue <= uploadQueue->completedValue) {
+    return;
+  }
+  VkSemaphoreWaitInfo waitInfo{};
+  waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+  waitInfo.semaphoreCount = 1;
+  waitInfo.pSemaphores = &uploadQueue->timelineSemaphore;
+  waitInfo.pValues = &timelineValue;
+  if (vkWaitSemaphores(uploadQueue->device, &waitInfo, UINT64_MAX) != VK_SUCCESS) {
+    throw std::runtime_error("failed to wait for uploads!");
+  }
+  uploadQueue->completedValue = timelineValue;
+}
+
+void destroyUploadQueue(UploadQueue* uploadQueue) {
+  VkDevice device = uploadQueue->device;
+  waitForUploads(uploadQueue, uploadQueue->submittedValue);
+
+  for (UploadBatch& batch : uploadQueue->inFlight) {
+    releaseBatch(uploadQueue, &batch);
+  }
+  uploadQueue->inFlight.clear();
+  releaseBatch(uploadQueue, &uploadQueue->recording);
+  uploadQueue->recording = {};
+  uploadQueue->pendingAcquireBarriers.clear();
+  uploadQueue->pendingWait = {};
+
+  destroyStagingRingBuffer(device, uploadQueue->memoryAllocator, &uploadQueue->staging);
+  vkDestroySemaphore(device, uploadQueue->timelineSemaphore, nullptr);
+  vkDestroyCommandPool(device, uploadQueue->commandPool, nullptr);
+}
+
+internal_access void beginBatch(UploadQueue* uploadQueue) {
+  UploadBatch* batch = &uploadQueue->recording;
+
+  VkCommandBufferAllocateInfo commandBufferAI{};
+  commandBufferAI.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAI.commandPool = uploadQueue->commandPool;
+  commandBufferAI.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAI.commandBufferCount = 1;
+  if (vkAllocateCommandBuffers(uploadQueue->device, &commandBufferAI, &batch->commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate upload command buffer!");
+  }
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  if (vkBeginCommandBuffer(batch->commandBuffer, &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("failed to begin recording upload command buffer!");
+  }
+}
+
+/*
+ * - Allocate from the staging ring, growing it when the allocation doesn't fit
+ * - At maximum capacity, submit the recorded copies (they may hold the space) and wait for the oldest region in use
+ */
+internal_access StagingAllocation allocateUploadStaging(UploadQueue* uploadQueue, VkDeviceSize size) {
+  StagingRingBuffer* staging = &uploadQueue->staging;
+  StagingAllocation allocation;
+  while (!allocateStaging(staging, size, &allocation)) {
+    // The batch being recorded may read from the current buffer as well
+    u64 retireValue = uploadQueue->submittedValue + (uploadQueue->recording.commandBuffer != VK_NULL_HANDLE ? 1 : 0);
+    if (growStagingRingBuffer(uploadQueue->device, uploadQueue->memoryAllocator, staging, size, retireValue)) {
+      continue;
+    }
+
+    submitUploads(uploadQueue);
+    Assert(!staging->regions.empty());
+    waitForUploads(uploadQueue, staging->regions.front().timelineValue);
+    releaseCompletedUploads(uploadQueue);
+    ++uploadQueue->stats.stagingStallCount;
+  }
+  return allocation;
+}
+
+/*
+ * - Record the buffer copy into the batch, starting it on the first copy
+ * - When the transfer and graphics families differ, record the release half of the ownership transfer after the copy
+ *   and keep the matching acquire to be recorded on the graphics queue. Both barriers must describe the same range
+ *   and families. Otherwise the semaphore wait alone (a full memory dependency) makes the copy visible.
+ */
+internal_access void recordUploadCopy(UploadQueue* uploadQueue, const StagingAllocation& staging, VkBuffer dstBuffer, VkDeviceSize dstOffset,
+                                      VkDeviceSize size, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask) {
+  UploadBatch* batch = &uploadQueue->recording;
+  if (batch->commandBuffer == VK_NULL_HANDLE) {
+    beginBatch(uploadQueue);
+  }
+
+  VkBufferCopy copyRegion;
+  copyRegion.srcOffset = staging.offset;
+  copyRegion.dstOffset = dstOffset;
+  copyRegion.size = size;
+  vkCmdCopyBuffer(batch->commandBuffer, staging.buffer, dstBuffer, 1, &copyRegion);
+
+  if (uploadQueue->transferQueueFamilyIndex != uploadQueue->graphicsQueueFamilyIndex) {
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = uploadQueue->transferQueueFamilyIndex;
+    barrier.dstQueueFamilyIndex = uploadQueue->graphicsQueueFamilyIndex;
+    barrier.buffer = dstBuffer;
+    barrier.offset = dstOffset;
+    barrier.size = size;
+    // Release, dstAccessMask is ignored
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(batch->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                         0, nullptr, 1, &barrier, 0, nullptr);
+    // Acquire, srcAccessMask is ignored
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = dstAccessMask;
+    batch->acquireBarriers.push_back(barrier);
+  }
+  batch->acquireStageMask |= dstStageMask;
+  batch->acquireAccessMask |= dstAccessMask;
+
+  ++uploadQueue->stats.copyCount;
+}
+
+/*
+ * - Split the upload into chunks of at most half the largest staging ring, so that a chunk always fits once the copies
+ *   of earlier chunks have completed. Copies are only submitted when the ring is full (see allocateUploadStaging),
+ *   writing a chunk does not overlap with copying the previous one.
+ * - Write each chunk straight into the persistently mapped ring and record its copy
+ */
+void uploadToBuffer(UploadQueue* uploadQueue, VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size,
+                    VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask) {
+  const u8* source = (const u8*)data;
+  VkDeviceSize maxChunkSize = uploadQueue->staging.maxCapacity / 2;
+  while (size > 0) {
+    VkDeviceSize chunkSize = min(size, maxChunkSize);
+    StagingAllocation staging = allocateUploadStaging(uploadQueue, chunkSize);
+    memcpy(staging.data, source, chunkSize);
+    recordUploadCopy(uploadQueue, staging, dstBuffer, dstOffset, chunkSize, dstStageMask, dstAccessMask);
+
+    source += chunkSize;
+    dstOffset += chunkSize;
+    size -= chunkSize;
+    uploadQueue->stats.bytesUploaded += chunkSize;
+  }
+}
+
+/*
+ * - Submit the batch signaling the next timeline value, no fence
+ * - Hand the batch's acquire barriers over to the next graphics command buffer calling cmdAcquireUploads
+ */
+u64 submitUploads(UploadQueue* uploadQueue) {
+  UploadBatch* batch = &uploadQueue->recording;
+  if (batch->commandBuffer == VK_NULL_HANDLE) {
+    return 0;
+  }
+  if (vkEndCommandBuffer(batch->commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record upload command buffer!");
+  }
+
+  batch->timelineValue = uploadQueue->submittedValue + 1;
+
+  VkTimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+  timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timelineSubmitInfo.signalSemaphoreValueCount = 1;
+  timelineSubmitInfo.pSignalSemaphoreValues = &batch->timelineValue;
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.pNext = &timelineSubmitInfo;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &batch->commandBuffer;
+  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pSignalSemaphores = &uploadQueue->timelineSemaphore;
+  if (vkQueueSubmit(uploadQueue->transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+    throw std::runtime_error("failed to submit upload command buffer!");
+  }
+  uploadQueue->submittedValue = batch->timelineValue;
+  closeStagingRegion(&uploadQueue->staging, batch->timelineValue);
+  ++uploadQueue->stats.batchCount;
+
+  // Timeline values only increase, so waiting on the latest value covers every earlier batch
+  uploadQueue->pendingAcquireBarriers.insert(uploadQueue->pendingAcquireBarriers.end(),
+                                             batch->acquireBarriers.begin(), batch->acquireBarriers.end());
+  uploadQueue->pendingWait.semaphore = uploadQueue->timelineSemaphore;
+  uploadQueue->pendingWait.value = batch->timelineValue;
+  uploadQueue->pendingWait.stageMask |= batch->acquireStageMask;
+  uploadQueue->pendingAccessMask |= batch->acquireAccessMask;
+  batch->acquireBarriers.clear();
+  batch->acquireStageMask = 0;
+  batch->acquireAccessMask = 0;
+
+  uploadQueue->inFlight.push_back(std::move(*batch));
+  *batch = {};
+  return uploadQueue->submittedValue;
+}
+
+void releaseCompletedUploads(UploadQueue* uploadQueue) {
+  if (uploadQueue->inFlight.empty()) {
+    return;
+  }
+  vkGetSemaphoreCounterValue(uploadQueue->device, uploadQueue->timelineSemaphore, &uploadQueue->completedValue);
+
+  // Batches complete in submission order on a single queue
+  size_t completedCount = 0;
+  while (completedCount < uploadQueue->inFlight.size() && uploadQueue->inFlight[completedCount].timelineValue <= uploadQueue->completedValue) {
+    releaseBatch(uploadQueue, &uploadQueue->inFlight[completedCount]);
+    ++completedCount;
+  }
+  uploadQueue->inFlight.erase(uploadQueue->inFlight.begin(), uploadQueue->inFlight.begin() + completedCount);
+  releaseStagingRegions(uploadQueue->device, uploadQueue->memoryAllocator, &uploadQueue->staging, uploadQueue->completedValue);
+}
+
+/*
+ * - Record every pending acquire barrier at once, at the stages consuming the uploads. The semaphore wait on those
+ *   same stages orders the barrier after the copies (and after the releases).
+ * - Without ownership transfers a memory barrier still chains the semaphore wait to later submits, which don't wait
+ *   on the semaphore themselves
+ * - Pending barriers are handed out once, later submits of the graphics queue are ordered after them
+ */
+UploadWait cmdAcquireUploads(UploadQueue* uploadQueue, VkCommandBuffer commandBuffer) {
+  UploadWait wait = uploadQueue->pendingWait;
+  if (wait.semaphore == VK_NULL_HANDLE) {
+    return wait;
+  }
+
+  VkMemoryBarrier memoryBarrier{};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = 0;
+  memoryBarrier.dstAccessMask = uploadQueue->pendingAccessMask;
+  bool32 ownershipTransfer = !uploadQueue->pendingAcquireBarriers.empty();
+  vkCmdPipelineBarrier(commandBuffer, wait.stageMask, wait.stageMask, 0,
+                       ownershipTransfer ? 0 : 1, &memoryBarrier,
+                       (u32)uploadQueue->pendingAcquireBarriers.size(), uploadQueue->pendingAcquireBarriers.data(),
+                       0, nullptr);
+  uploadQueue->pendingAccessMask = 0;
+  uploadQueue->pendingAcquireBarriers.clear();
+  uploadQueue->pendingWait = {};
+  return wait;
+}
+
+void printUploadQueueStats(const UploadQueue* uploadQueue) {
+  std::cout << "uploads: " << uploadQueue->stats.bytesUploaded << " bytes, " << uploadQueue->stats.copyCount << " copies in "
+            << uploadQueue->stats.batchCount << " batches (transfer family " << uploadQueue->transferQueueFamilyIndex << ", "
+            << (uploadQueue->transferQueueFamilyIndex != uploadQueue->graphicsQueueFamilyIndex ? "dedicated" : "shared with graphics") << ")\n"
+            << "staging ring: " << uploadQueue->staging.capacity / 1024 << " KiB (max " << uploadQueue->staging.maxCapacity / 1024
+            << " KiB), grown " << uploadQueue->staging.growCount << " times, " << uploadQueue->stats.stagingStallCount << " stalls" << std::endl;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <vector>
+#include "KuringTypes.h"
+#include "GpuMemoryAllocator.h"
+#include "StagingRingBuffer.h"
+
+// Copies recorded into a single transfer command buffer, submitted together and tracked by one timeline value
+struct UploadBatch {
+  VkCommandBuffer commandBuffer; // VK_NULL_HANDLE until the first copy is recorded
+  u64 timelineValue; // signaled once every copy of the batch has completed
+  std::vector<VkBufferMemoryBarrier> acquireBarriers; // to be recorded on the graphics queue
+  VkPipelineStageFlags acquireStageMask; // stages of the graphics queue consuming the uploaded data
+  VkAccessFlags acquireAccessMask;
+};
+
+// Semaphore wait to add to the graphics submit that records the upload acquire barriers
+struct UploadWait {
+  VkSemaphore semaphore; // VK_NULL_HANDLE when there is nothing to wait on
+  u64 value;
+  VkPipelineStageFlags stageMask;
+};
+
+// Host to device buffer uploads on the transfer queue. Copies are batched into one command buffer per submit and
+// signal a timeline semaphore, so neither the host nor the transfer queue waits on a fence per upload. The graphics
+// queue waits on the timeline value in the first submit using the data, which also records the queue family
+// ownership acquire matching the release recorded after the copies (when the transfer and graphics families differ).
+// Data is staged through a single ring buffer, whose space is recycled lazily once the timeline shows the batches
+// reading from it have completed.
+struct UploadQueue {
+  VkDevice device;
+  GpuMemoryAllocator* memoryAllocator;
+  VkQueue transferQueue;
+  u32 transferQueueFamilyIndex;
+  u32 graphicsQueueFamilyIndex;
+  VkCommandPool commandPool; // transfer queue family
+  VkSemaphore timelineSemaphore;
+  StagingRingBuffer staging;
+  u64 submittedValue; // signaled by the most recently submitted batch
+  u64 completedValue; // most recent value observed on the host
+  UploadBatch recording; // batch being recorded, not yet submitted
+  std::vector<UploadBatch> inFlight; // submitted, command buffers not yet released
+  UploadWait pendingWait; // submitted batches whose acquire barriers have not been recorded on the graphics queue yet
+  std::vector<VkBufferMemoryBarrier> pendingAcquireBarriers; // ownership transfers only
+  VkAccessFlags pendingAccessMask;
+  struct {
+    u64 bytesUploaded;
+    u32 copyCount; // uploads larger than the staging ring are split into several copies
+    u32 batchCount;
+    u32 stagingStallCount; // host waits for staging space, with the ring at its maximum capacity
+  } stats;
+};
+
+void initUploadQueue(VkDevice device, GpuMemoryAllocator* memoryAllocator, VkQueue transferQueue, u32 transferQueueFamilyIndex,
+                     u32 graphicsQueueFamilyIndex, UploadQueue* uploadQueue);
+// Waits for every submitted batch, unsubmitted copies are discarded
+void destroyUploadQueue(UploadQueue* uploadQueue);
+
+// Records a copy of size bytes into dstBuffer at dstOffset. The data is copied into staging memory immediately and
+// may be reused by the caller. Uploads that don't fit in the staging ring are split into chunks, submitting the
+// recorded copies and waiting for staging space as needed. dstStageMask/dstAccessMask describe how the graphics queue will consume the buffer
+// (ex: VERTEX_INPUT, VERTEX_ATTRIBUTE_READ | INDEX_READ).
+// NOTE: dstBuffer must use VK_SHARING_MODE_EXCLUSIVE and not be in use by the GPU until the upload is acquired
+void uploadToBuffer(UploadQueue* uploadQueue, VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size,
+                    VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask);
+// Submits the recorded copies to the transfer queue, returns the timeline value signaled on completion
+// (zero when nothing was recorded)
+u64 submitUploads(UploadQueue* uploadQueue);
+// Recycles staging space and command buffers of completed batches without waiting, call once per frame
+void releaseCompletedUploads(UploadQueue* uploadQueue);
+// Records the acquire barriers of submitted uploads into a graphics command buffer, outside of a render pass.
+// The command buffer's submit must wait on the returned semaphore value.
+UploadWait cmdAcquireUploads(UploadQueue* uploadQueue, VkCommandBuffer commandBuffer);
+void printUploadQueueStats(const UploadQueue* uploadQueue);
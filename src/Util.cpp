@@ -40,4 +40,26 @@ void readFile(const char* filename, u32* fileSize, char* fileBuffer) {
   }
 
   file.close();
-}
\ No newline at end of file
+}
+
+void writeJsonString(std::ostream& stream, const char* str)
+{
+  stream << '"';
+  for (const char* c = str; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      stream << '\\';
+    }
+    stream << *c;
+  }
+  stream << '"';
+}
+
+u64 hashBytes(const void* data, u64 size) {
+  const u8* bytes = (const u8*)data;
+  u64 hash = 14695981039346656037ull;
+  for (u64 i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
@@ -2,16 +2,26 @@
 
 #include "KuringTypes.h"
 #include <glm/glm.hpp>
+#include <iosfwd>
 
 #define min(x, y) (x < y ? x : y)
 #define max(x, y) (x > y ? x : y)
 #define clamp(lowerBound, upperBound, desiredVal) (desiredVal < lowerBound ? lowerBound : (desiredVal > upperBound ? upperBound : desiredVal))
 
+// Rounds size up to a multiple of alignment (ex: minUniformBufferOffsetAlignment, mesh file sections)
+inline u64 alignUp(u64 size, u64 alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
 void swap(f32* a, f32* b);
 glm::mat4& reverseZ(glm::mat4& mat);
 f32 getTime();
 bool consume(bool& val);
 void readFile(const char* filename, u32* fileSize, char* fileBuffer);
+// Quoted, with quotes and backslashes escaped (ex: names in benchmark results and profiler traces)
+void writeJsonString(std::ostream& stream, const char* str);
+// FNV-1a (ex: pipeline cache file integrity, shader module cache lookups)
+u64 hashBytes(const void* data, u64 size);
 
 class Consumabool {
 public:
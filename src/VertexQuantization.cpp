@@ -0,0 +1,221 @@
+#include "VertexQuantization.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+internal_access f32 clampf(f32 value, f32 minValue, f32 maxValue) {
+  return value < minValue ? minValue : (value > maxValue ? maxValue : value);
+}
+
+internal_access f32 distance3(const f32 a[3], const f32 b[3]) {
+  f32 dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+  return sqrtf(dx * dx + dy * dy + dz * dz);
+}
+
+s16 encodeSnorm16(f32 value) {
+  return (s16)lroundf(clampf(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+// -32768 and -32767 both decode to -1, as in the Vulkan SNORM conversion
+f32 decodeSnorm16(s16 value) {
+  f32 decoded = value / 32767.0f;
+  return decoded < -1.0f ? -1.0f : decoded;
+}
+
+u16 encodeHalf(f32 value) {
+  u32 bits;
+  memcpy(&bits, &value, sizeof(bits));
+  u32 sign = (bits >> 16) & 0x8000;
+  u32 floatExponent = (bits >> 23) & 0xff;
+  u32 mantissa = bits & 0x7fffff;
+  if (floatExponent == 0xff) {
+    return (u16)(sign | 0x7c00 | (mantissa ? 0x200 : 0)); // infinity, quiet NaN
+  }
+  s32 exponent = (s32)floatExponent - 127 + 15;
+  if (exponent >= 31) {
+    return (u16)(sign | 0x7c00);
+  }
+  if (exponent <= 0) {
+    if (exponent < -10) {
+      return (u16)sign;
+    }
+    // Subnormal half, the implicit bit becomes explicit
+    mantissa |= 0x800000;
+    u32 shift = (u32)(14 - exponent);
+    u32 half = mantissa >> shift;
+    u32 remainder = mantissa & ((1u << shift) - 1);
+    u32 halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1))) {
+      ++half;
+    }
+    return (u16)(sign | half);
+  }
+  u32 half = ((u32)exponent << 10) | (mantissa >> 13);
+  u32 remainder = mantissa & 0x1fff;
+  if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+    ++half; // a carry into the exponent is the correctly rounded result, up to infinity
+  }
+  return (u16)(sign | half);
+}
+
+f32 decodeHalf(u16 value) {
+  u32 sign = (u32)(value & 0x8000) << 16;
+  u32 exponent = (value >> 10) & 0x1f;
+  u32 mantissa = value & 0x3ff;
+  u32 bits;
+  if (exponent == 0) {
+    f32 subnormal = ldexpf((f32)mantissa, -24);
+    return sign ? -subnormal : subnormal;
+  } else if (exponent == 31) {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  } else {
+    bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+  }
+  f32 decoded;
+  memcpy(&decoded, &bits, sizeof(decoded));
+  return decoded;
+}
+
+/*
+ * - Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower hemisphere over the diagonals
+ * - Each component is rounded to the nearest SNORM16 value, the decode renormalizes
+ */
+void encodeOctahedral(const f32 normal[3], s16 encoded[2]) {
+  f32 norm = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+  if (norm == 0.0f) {
+    encoded[0] = 0;
+    encoded[1] = 0;
+    return;
+  }
+  f32 x = normal[0] / norm;
+  f32 y = normal[1] / norm;
+  if (normal[2] < 0.0f) {
+    f32 foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    f32 foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = foldedX;
+    y = foldedY;
+  }
+  encoded[0] = encodeSnorm16(x);
+  encoded[1] = encodeSnorm16(y);
+}
+
+void decodeOctahedral(const s16 encoded[2], f32 normal[3]) {
+  f32 x = decodeSnorm16(encoded[0]);
+  f32 y = decodeSnorm16(encoded[1]);
+  f32 z = 1.0f - fabsf(x) - fabsf(y);
+  if (z < 0.0f) {
+    f32 unfoldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    f32 unfoldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = unfoldedX;
+    y = unfoldedY;
+  }
+  f32 length = sqrtf(x * x + y * y + z * z);
+  normal[0] = x / length;
+  normal[1] = y / length;
+  normal[2] = z / length;
+}
+
+/*
+ * - Positions are stored relative to the bounds center, where both encodings are the most precise
+ * - SNORM16 is additionally scaled by the half extent of each axis so that the bounds map onto [-1, 1]
+ */
+PositionDequantization computePositionDequantization(PositionQuantization quantization, const f32 boundsMin[3], const f32 boundsMax[3]) {
+  PositionDequantization dequantization;
+  for (u32 axis = 0; axis < 3; ++axis) {
+    f32 halfExtent = (boundsMax[axis] - boundsMin[axis]) * 0.5f;
+    dequantization.offset[axis] = quantization == POSITION_QUANTIZATION_NONE ? 0.0f : boundsMin[axis] + halfExtent;
+    dequantization.scale[axis] = quantization == POSITION_QUANTIZATION_SNORM16 && halfExtent > 0.0f ? halfExtent : 1.0f;
+  }
+  return dequantization;
+}
+
+void quantizeVertices(const PosColNormVertexAttDatum* vertices, u32 vertexCount, PositionQuantization quantization,
+                      const PositionDequantization& dequantization, QuantizedVertexAttDatum* quantizedVertices) {
+  for (u32 i = 0; i < vertexCount; ++i) {
+    const PosColNormVertexAttDatum& vertex = vertices[i];
+    QuantizedVertexAttDatum* quantized = &quantizedVertices[i];
+    for (u32 axis = 0; axis < 3; ++axis) {
+      f32 relative = (vertex.position[axis] - dequantization.offset[axis]) / dequantization.scale[axis];
+      quantized->position[axis] = quantization == POSITION_QUANTIZATION_FLOAT16 ? encodeHalf(relative) : (u16)encodeSnorm16(relative);
+      quantized->color[axis] = (u8)lroundf(clampf(vertex.color[axis], 0.0f, 1.0f) * 255.0f);
+    }
+    // w = 1.0
+    quantized->position[3] = quantization == POSITION_QUANTIZATION_FLOAT16 ? 0x3c00 : 0x7fff;
+    quantized->color[3] = 255;
+    encodeOctahedral(vertex.normal, quantized->normal);
+  }
+}
+
+void dequantizeVertex(const QuantizedVertexAttDatum& quantizedVertex, PositionQuantization quantization,
+                      const PositionDequantization& dequantization, PosColNormVertexAttDatum* vertex) {
+  for (u32 axis = 0; axis < 3; ++axis) {
+    f32 decoded = quantization == POSITION_QUANTIZATION_FLOAT16 ? decodeHalf(quantizedVertex.position[axis])
+                                                                 : decodeSnorm16((s16)quantizedVertex.position[axis]);
+    vertex->position[axis] = decoded * dequantization.scale[axis] + dequantization.offset[axis];
+    vertex->color[axis] = quantizedVertex.color[axis] / 255.0f;
+  }
+  decodeOctahedral(quantizedVertex.normal, vertex->normal);
+}
+
+const VertexAttFormat* quantizedVertexAttFormat(PositionQuantization quantization) {
+  switch (quantization) {
+    case POSITION_QUANTIZATION_SNORM16: return snorm16QuantizedVertexAttDatumFormat;
+    case POSITION_QUANTIZATION_FLOAT16: return float16QuantizedVertexAttDatumFormat;
+    default: return posColNormVertexAttDatumFormat;
+  }
+}
+
+/*
+ * - Colors are compared after clamping to [0, 1], the range UNORM8 can represent
+ * - Normals are compared after normalization, the length of the source normal is not preserved
+ */
+QuantizationError measureQuantizationError(const PosColNormVertexAttDatum* vertices, const QuantizedVertexAttDatum* quantizedVertices,
+                                           u32 vertexCount, PositionQuantization quantization, const PositionDequantization& dequantization) {
+  QuantizationError error = {};
+  for (u32 i = 0; i < vertexCount; ++i) {
+    const PosColNormVertexAttDatum& vertex = vertices[i];
+    PosColNormVertexAttDatum decoded;
+    dequantizeVertex(quantizedVertices[i], quantization, dequantization, &decoded);
+
+    error.position = fmaxf(error.position, distance3(vertex.position, decoded.position));
+    for (u32 channel = 0; channel < 3; ++channel) {
+      error.color = fmaxf(error.color, fabsf(clampf(vertex.color[channel], 0.0f, 1.0f) - decoded.color[channel]));
+    }
+    f32 length = sqrtf(vertex.normal[0] * vertex.normal[0] + vertex.normal[1] * vertex.normal[1] + vertex.normal[2] * vertex.normal[2]);
+    if (length > 0.0f) {
+      f32 normal[3] = {vertex.normal[0] / length, vertex.normal[1] / length, vertex.normal[2] / length};
+      error.normal = fmaxf(error.normal, distance3(normal, decoded.normal));
+    }
+  }
+  return error;
+}
+
+/*
+ * - SNORM16: half a quantization step per axis, halfExtent / 32767 / 2
+ * - FLOAT16: half an ulp of the largest coordinate relative to the center, 2^-11 of the half extent, plus the
+ *   absolute precision of subnormals
+ * - Octahedral SNORM16: half a step in both components, stretched by less than 4 when projected back onto the sphere
+ * - Every bound allows for float rounding of the dequantization itself
+ */
+QuantizationError quantizationErrorBounds(PositionQuantization quantization, const f32 boundsMin[3], const f32 boundsMax[3]) {
+  f32 halfExtent[3];
+  f32 magnitude = 0.0f;
+  for (u32 axis = 0; axis < 3; ++axis) {
+    halfExtent[axis] = (boundsMax[axis] - boundsMin[axis]) * 0.5f;
+    magnitude = fmaxf(magnitude, fmaxf(fabsf(boundsMin[axis]), fabsf(boundsMax[axis])));
+  }
+  f32 halfExtentLength = sqrtf(halfExtent[0] * halfExtent[0] + halfExtent[1] * halfExtent[1] + halfExtent[2] * halfExtent[2]);
+  f32 floatRounding = 4.0f * FLT_EPSILON * magnitude * sqrtf(3.0f);
+
+  QuantizationError bounds;
+  switch (quantization) {
+    case POSITION_QUANTIZATION_SNORM16: bounds.position = halfExtentLength * 0.5f / 32767.0f; break;
+    case POSITION_QUANTIZATION_FLOAT16: bounds.position = halfExtentLength * ldexpf(1.0f, -11) + ldexpf(1.0f, -24) * sqrtf(3.0f); break;
+    default: bounds.position = 0.0f; break;
+  }
+  bounds.position += floatRounding;
+  bounds.color = 0.5f / 255.0f + FLT_EPSILON;
+  bounds.normal = 4.0f * sqrtf(2.0f) * 0.5f / 32767.0f + 4.0f * FLT_EPSILON;
+  return bounds;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "KuringTypes.h"
+#include "Models.h"
+
+// Attribute compression of PosColNormVertexAttDatum into QuantizedVertexAttDatum, run by tools/MeshImporter.
+// Decoding happens in the vertex input stage (SNORM/UNORM/SFLOAT formats), except for:
+//  - Positions, relative to the mesh bounds: position = decoded * scale + offset, folded into the model matrix
+//  - Normals, octahedral encoded. GLSL decode of the R16G16_SNORM attribute e:
+//      vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+//      if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * sign(n.xy);
+//      n = normalize(n);
+
+enum PositionQuantization {
+  POSITION_QUANTIZATION_NONE, // PosColNormVertexAttDatum as is
+  POSITION_QUANTIZATION_SNORM16, // uniform precision of half extent / 32767 across the bounds
+  POSITION_QUANTIZATION_FLOAT16, // precision relative to the distance from the bounds center, 11 significant bits
+};
+
+struct PositionDequantization {
+  f32 scale[3];
+  f32 offset[3];
+};
+
+// Largest error of any decoded vertex, as the distance to the source position/normal and per color channel
+struct QuantizationError {
+  f32 position;
+  f32 color;
+  f32 normal;
+};
+
+s16 encodeSnorm16(f32 value);
+f32 decodeSnorm16(s16 value);
+// Round to nearest even, out of range values become infinity
+u16 encodeHalf(f32 value);
+f32 decodeHalf(u16 value);
+// Normal must be unit length
+void encodeOctahedral(const f32 normal[3], s16 encoded[2]);
+void decodeOctahedral(const s16 encoded[2], f32 normal[3]);
+
+PositionDequantization computePositionDequantization(PositionQuantization quantization, const f32 boundsMin[3], const f32 boundsMax[3]);
+void quantizeVertices(const PosColNormVertexAttDatum* vertices, u32 vertexCount, PositionQuantization quantization,
+                      const PositionDequantization& dequantization, QuantizedVertexAttDatum* quantizedVertices);
+void dequantizeVertex(const QuantizedVertexAttDatum& quantizedVertex, PositionQuantization quantization,
+                      const PositionDequantization& dequantization, PosColNormVertexAttDatum* vertex);
+const VertexAttFormat* quantizedVertexAttFormat(PositionQuantization quantization);
+
+// Decodes every vertex and measures the error against the source vertices
+QuantizationError measureQuantizationError(const PosColNormVertexAttDatum* vertices, const QuantizedVertexAttDatum* quantizedVertices,
+                                           u32 vertexCount, PositionQuantization quantization, const PositionDequantization& dequantization);
+// Largest error the encoding may introduce for vertices within the bounds
+QuantizationError quantizationErrorBounds(PositionQuantization quantization, const f32 boundsMin[3], const f32 boundsMax[3]);
@@ -19,6 +19,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <chrono>
+#include <vector>
+#include <fstream>
 
 #include "VulkanApp.h"
 #include "KuringTypes.h"
@@ -29,6 +31,23 @@
 #include "VulkanUtil.h"
 #include "UniformStructs.h"
 #include "GraphicsPipelineBuilder.h"
+#include "UniformRingBuffer.h"
+#include "Benchmark.h"
+#include "GpuQueries.h"
+#include "Profiler.h"
+#include "PipelineCache.h"
+#include "ThreadPool.h"
+#include "PipelineBatch.h"
+#include "ShaderModuleCache.h"
+#include "ShaderWatcher.h"
+#include "GpuMemoryAllocator.h"
+#include "UploadQueue.h"
+#include "MeshFile.h"
+#include "InstanceBuffer.h"
+#include "GeometryStore.h"
+#include "ParallelCommandRecorder.h"
+#include "ComputePipelineBuilder.h"
+#include "RayMarchPass.h"
 
 #define SWAP_CHAIN_IMAGE_FORMAT VK_FORMAT_B8G8R8A8_SRGB
 #define SWAP_CHAIN_IMAGE_COLOR_SPACE VK_COLOR_SPACE_SRGB_NONLINEAR_KHR
@@ -42,32 +61,106 @@ struct SwapChain {
     VkImageView* imageViews;
     u32 framebufferCount;
     VkFramebuffer* framebuffers;
+    GpuAllocation* imageMemory; // headless offscreen images only, swap chain images are owned by the swap chain
+    VkPresentModeKHR presentMode;
+    RayMarchTarget rayMarchTarget; // sized to the extent, null handles unless ray marching
+};
+
+// Resources owned by a single frame in flight. Decoupled from the swap chain image count so that the CPU can
+// record frame N+1 while the GPU is still working on frame N, without re-signaling semaphores that haven't been consumed.
+struct FrameInFlight {
+  VkCommandBuffer commandBuffer;
+  VkFence fence; // signaled when the GPU has finished executing this frame's command buffer
+  VkSemaphore imageAcquiredSemaphore; // signaled when the acquired swap chain image is ready to be rendered to
+  VkSemaphore renderFinishedSemaphore; // signaled when rendering is complete and the image may be presented
+  u32 transMatsOffset; // dynamic offset of this frame's TransMats in the uniform ring buffer
+  ModelPushConstants quadPushConstants;
+  UploadWait uploadWait; // uploads acquired by this frame's command buffer, waited on by its submit
+  IndirectDrawBuffer indirectDraws; // draws of the quad pipeline, written while recording
+};
+
+typedef std::chrono::high_resolution_clock::time_point TimePoint;
+
+// Swap chain dependent resources that may still be referenced by frames in flight or the presentation engine after
+// the swap chain has been recreated. They are destroyed once enough frames have completed rather than idling the device.
+struct RetiredSwapChain {
+  SwapChain swapChain;
+  u64 retiredFrameNumber;
+};
+
+// Pipeline replaced by a shader hot reload, may still be bound by frames in flight
+struct RetiredPipeline {
+  BuiltPipeline pipeline;
+  u64 retiredFrameNumber;
+};
+
+// Pipeline rebuilt by a shader hot reload whenever one of the SPIR-V files it is built from is recompiled
+struct HotReloadPipeline {
+  std::string name; // reported when swapped in
+  std::vector<std::string> shaderPaths; // SPIR-V, as set on the pipeline's builder
+  VkPipeline* pipeline; // in VulkanContext, replaced in place once rebuilt
+  VkPipelineLayout* pipelineLayout;
+  PipelineBuild build; // on the thread pool
+};
+
+struct PipelineRebuild {
+  u32 pipelineIndex; // in shaderHotReload.pipelines
+  std::shared_future<BuiltPipeline> rebuilt;
 };
 
 struct VulkanContext {
+  bool32 headless; // render into offscreen images, no window/surface/swap chain
   VkInstance instance;
   VkDebugUtilsMessengerEXT debugMessenger;
   VkSurfaceKHR surface;
   VkExtent2D windowExtent;
   SwapChain swapChain;
+  std::vector<RetiredSwapChain> retiredSwapChains;
   VkRenderPass renderPass;
   VkPipelineLayout pipelineLayout;
   VkPipeline graphicsPipeline;
+  VkPipelineCache pipelineCache;
+  ThreadPool threadPool; // pipeline compilation, including shader hot reload compiles and rebuilds
+  u32 recordingThreadCount; // 0: the draw list is recorded by the main thread, otherwise by this many threads (see parallelRecorder)
+  ThreadPool recordingThreadPool; // parallel command recording only, so that slices never queue behind pipeline compiles
+  ParallelCommandRecorder parallelRecorder; // secondary command buffers, one per recording thread and frame in flight
+  ShaderModuleCache shaderModuleCache;
+  const char* pipelineCachePath; // pipeline cache is neither loaded nor saved when null
+  struct {
+    bool32 loadedFromDisk;
+    f64 initialBuildSeconds; // initGraphicsPipeline at startup
+  } pipelineCacheStats;
   VkCommandPool graphicsCommandPool;
-  VkCommandPool transferCommandPool;
-  u32 commandBufferCount;
-  VkCommandBuffer* commandBuffers;
-  VkFence* commandBufferFences;
+  GpuMemoryAllocator memoryAllocator;
+  UploadQueue uploadQueue; // buffer uploads on the transfer queue
+
+  // Shader sources are recompiled and pipelines rebuilt on the thread pool, see updateShaderHotReload
+  struct {
+    bool32 enabled;
+    const char* sourceDirectory; // GLSL sources, compiled SPIR-V is written to SHADER_LOC_BASE
+    ShaderWatcher watcher;
+    std::vector<std::string> changedSources; // changed since the last compile was queued
+    std::vector<HotReloadPipeline> pipelines; // every pipeline that may be rebuilt, see initHotReloadPipelines
+    std::shared_future<std::vector<std::string>> compile; // SPIR-V paths of the sources that compiled successfully
+    std::vector<PipelineRebuild> rebuilds; // swapped in together once all of them have finished
+    TimePoint rebuildStart;
+    std::vector<RetiredPipeline> retiredPipelines;
+  } shaderHotReload;
+
+  u32 frameCount; // number of frames in flight
+  u32 currentFrame;
+  u64 frameNumber; // total frames submitted
+  u32 lastImageIndex; // swap chain/offscreen image most recently rendered to
+  FrameInFlight* frames;
+  VkFence* imagesInFlight; // indexed by swap chain image, fence of the frame currently rendering to that image
+  GpuQueries gpuQueries;
+  bool32 enablePipelineStatistics; // requested, only enabled if the device supports pipeline statistics queries (and inherited queries when recording in parallel)
 
   struct {
     VkDescriptorPool descriptorPool;
-    VkDescriptorSet* descriptorSets;
+    VkDescriptorSet descriptorSet;
     VkDescriptorSetLayout descriptorSetLayout;
-    VkDeviceMemory memory;
-    VkBuffer buffer;
-    u32* offsets;
-    u32 count;
-    u32 alignment;
+    UniformRingBuffer ringBuffer;
   } uniformBuffers;
 
   struct {
@@ -75,34 +168,87 @@ struct VulkanContext {
     VkPhysicalDevice physical;
     VkPhysicalDeviceMemoryProperties memoryProperties;
     VkDeviceSize minUniformBufferOffsetAlignment;
+    QueueFamilyIndices queueFamilyIndices;
+    // VK_EXT_extended_dynamic_state, allows cull mode and front face to be set per command buffer
+    struct {
+      bool32 supported;
+      PFN_vkCmdSetCullModeEXT vkCmdSetCullMode;
+      PFN_vkCmdSetFrontFaceEXT vkCmdSetFrontFace;
+    } extendedDynamicState;
+    bool32 pipelineStatisticsQuerySupported;
+    bool32 inheritedQueriesSupported; // secondary command buffers may execute while a query is active
+    IndirectDrawSupport indirectDraw;
     struct{
       VkQueue graphics;
       VkQueue present;
       VkQueue transfer;
+      VkQueue compute; // may be the graphics queue, see QueueFamilyIndices
     } queues;
   } device;
 
-  struct{
-      VkSemaphore present;
-      VkSemaphore render;
-  } semaphores;
+  const char* meshPath; // .kmesh file drawn instead of the quad when set
+  MeshFile mesh; // unmapped once uploaded, keeps the vertex layout used by the quad pipeline
+
+  GeometryStore geometryStore; // vertices and indices of every mesh, bound once per pass
 
   struct {
       VertexAtt info;
-      VkDeviceMemory memory;
-      VkBuffer buffer;
-      VkDeviceSize bufferOffset;
-      u32 verticesOffset;
-      u32 indicesOffset;
+      u32 meshIndex; // in the geometry store, one indirect draw per submesh
+      glm::mat4 modelNormalization; // fits the mesh bounds into the unit cube around the origin
   } vertexAtt;
+
+  u32 instanceCount; // copies of the mesh, drawn by one instanced draw per submesh
+  InstanceBuffer instances;
+
+  RayMarchMode rayMarchMode;
+  RayMarchQuality rayMarchQuality; // shaders are specialized with, switched at run time in fragment mode only
+  RayMarchPass rayMarch; // scene ray marched in compute and composited behind the quad, compute modes only
+  struct {
+    VkPipeline pipelines[RAY_MARCH_QUALITY_COUNT]; // one per quality, specialized from the same SPIR-V
+    VkPipelineLayout pipelineLayouts[RAY_MARCH_QUALITY_COUNT];
+  } rayMarchFragment; // RAY_MARCH_FRAGMENT only
+  RayMarchScene rayMarchScene; // camera, sphere and plane of every mode, resolution is set from the extent when drawn
+
+  struct {
+    u32 count;
+    f64 totalSeconds;
+    f64 maxSeconds;
+  } swapChainRecreation;
+
+  // CPU time spent in each stage of the most recently drawn frame
+  struct {
+    f64 fenceWaitSeconds; // waiting for the frame in flight to become available
+    f64 acquireSeconds; // zero when headless
+    f64 submitSeconds; // uniform update, command buffer recording and queue submission
+    f64 presentSeconds; // zero when headless
+  } frameTimings;
 };
 
+internal_access TimePoint now() {
+  return std::chrono::high_resolution_clock::now();
+}
+
+// Compute modes own a RayMarchPass and a ray march target, fragment mode only its pipelines
+internal_access bool32 isComputeRayMarch(RayMarchMode mode) {
+  return mode == RAY_MARCH_PER_PIXEL || mode == RAY_MARCH_TILED;
+}
+
+internal_access f64 secondsSince(TimePoint start) {
+  return std::chrono::duration<f64>(now() - start).count();
+}
+
 void initGLFW(GLFWwindow** window, VulkanContext* vulkanContext);
+void initVulkanContextSettings(const VulkanAppSettings& settings, VulkanContext* vulkanContext);
 void initVulkan(GLFWwindow* window, VulkanContext* vulkanContext);
 bool32 checkValidationLayerSupport();
-void initVulkanInstance(VkInstance* instance, VkDebugUtilsMessengerEXT* debugMessenger);
+void initVulkanInstance(VkInstance* instance, VkDebugUtilsMessengerEXT* debugMessenger, bool32 headless);
 void printAvailableExtensions();
 void mainLoop(GLFWwindow* window, VulkanContext* vulkanContext);
+void runResizeStorm(GLFWwindow* window, VulkanContext* vulkanContext, u32 toggleCount);
+void runUniformUploadBenchmark(VulkanContext* vulkanContext, u32 blocksPerFrame);
+void runHeadless(VulkanContext* vulkanContext, u32 headlessFrameCount, const char* outputImagePath);
+void runBenchmark(GLFWwindow* window, VulkanContext* vulkanContext, const VulkanAppSettings& settings);
+void writeOffscreenImage(VulkanContext* vulkanContext, u32 imageIndex, const char* filePath);
 void cleanup(GLFWwindow* window, VulkanContext* vulkanContext);
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
     VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
@@ -115,30 +261,76 @@ VkResult initDebugUtilsMessengerEXT(
     const VkAllocationCallbacks* pAllocator,
     VkDebugUtilsMessengerEXT* pDebugMessenger);
 void DestroyDebugUtilsMessengerEXT(VkInstance* instance, VkDebugUtilsMessengerEXT* debugMessenger, const VkAllocationCallbacks* pAllocator);
+FrameInFlight* beginFrame(VulkanContext* vulkanContext);
+void recordAndSubmitFrame(VulkanContext* vulkanContext, u32 swapChainImageIndex, VkSemaphore waitSemaphore, VkSemaphore signalSemaphore);
+void endFrame(VulkanContext* vulkanContext);
 void drawFrame(VulkanContext* vulkanContext);
-void getRequiredExtensions(const char ** extensions, u32 *extensionCount);
-void processKeyboardInput();
+void drawHeadlessFrame(VulkanContext* vulkanContext);
+void getRequiredExtensions(const char ** extensions, u32 *extensionCount, bool32 headless);
+void processKeyboardInput(VulkanContext* vulkanContext);
 void initFramebuffers(VulkanContext* vulkanContext);
-void destroyFramebuffers(VulkanContext* vulkanContext);
+void destroyFramebuffers(VkDevice device, SwapChain* swapChain);
 void initImageViews(VkDevice* logicalDevice, SwapChain* swapChain);
 void initDescriptorSetLayout(VulkanContext* vulkanContext);
-void destroyImageViews(VulkanContext* vulkanContext);
-void initSwapChainCommandBuffers(VulkanContext* vulkanContext);
-void populateCommandBuffers(VulkanContext* vulkanContext);
-void initSwapChain(VulkanContext* vulkanContext, QueueFamilyIndices queueFamilyIndices);
-void initRenderPass(VkDevice* logicalDevice, VkFormat colorAttachmentFormat, VkRenderPass* renderPass);
+void destroyImageViews(VkDevice device, SwapChain* swapChain);
+void destroySwapChain(VkDevice device, GpuMemoryAllocator* memoryAllocator, SwapChain* swapChain);
+void releaseRetiredSwapChains(VulkanContext* vulkanContext, bool32 releaseAll);
+void updateShaderHotReload(VulkanContext* vulkanContext);
+void releaseRetiredPipelines(VulkanContext* vulkanContext, bool32 releaseAll);
+void initFrameCommandBuffers(VulkanContext* vulkanContext);
+void populateCommandBuffer(VulkanContext* vulkanContext, u32 frameIndex, u32 swapChainImageIndex);
+void cmdBindQuadPipelineState(VulkanContext* vulkanContext, VkCommandBuffer commandBuffer, u32 frameIndex);
+void recordQuadDrawSlices(VulkanContext* vulkanContext, u32 frameIndex, VkFramebuffer framebuffer);
+void initSwapChain(VulkanContext* vulkanContext, QueueFamilyIndices queueFamilyIndices, VkSwapchainKHR oldSwapChain);
+void initOffscreenImages(VulkanContext* vulkanContext);
+void initRenderPass(VkDevice* logicalDevice, VkFormat colorAttachmentFormat, VkImageLayout finalLayout, VkRenderPass* renderPass);
+void initPipelineCache(VulkanContext* vulkanContext);
 void initGraphicsPipeline(VulkanContext* vulkanContext);
+void configureQuadPipeline(VulkanContext* vulkanContext, GraphicsPipelineBuilder& builder);
+void buildQuadPipeline(VulkanContext* vulkanContext, VkPipelineCache pipelineCache, VkPipeline* pipeline, VkPipelineLayout* pipelineLayout);
+void runPipelineCacheBenchmark(VulkanContext* vulkanContext, u32 iterations);
+void runPipelineBatchBenchmark(VulkanContext* vulkanContext, u32 pipelineCount);
+void runIndirectDrawBenchmark(VulkanContext* vulkanContext, u32 maxObjectCount);
 void initCommandPools(VulkanContext* vulkanContext, QueueFamilyIndices queueFamilyIndices);
 void prepareUniformBufferMemory(VulkanContext* vulkanContext);
 void initDescriptorPool(VulkanContext* vulkanContext);
 void initDescriptorSets(VulkanContext* vulkanContext);
+void initImagesInFlight(VulkanContext* vulkanContext);
+void initIndirectDraws(VulkanContext* vulkanContext);
+void initSwapChainRayMarchTarget(VulkanContext* vulkanContext);
+void initRayMarch(VulkanContext* vulkanContext);
+void configureRayMarchFragmentPipeline(VulkanContext* vulkanContext, RayMarchQuality quality, GraphicsPipelineBuilder& builder);
+void buildRayMarchTilePipeline(VulkanContext* vulkanContext, VkPipeline* pipeline, VkPipelineLayout* pipelineLayout);
+void buildRayMarchPixelPipeline(VulkanContext* vulkanContext, VkPipeline* pipeline, VkPipelineLayout* pipelineLayout);
+void buildRayMarchCompositePipeline(VulkanContext* vulkanContext, VkPipeline* pipeline, VkPipelineLayout* pipelineLayout);
+void initHotReloadPipelines(VulkanContext* vulkanContext);
+void cmdDrawRayMarchScene(VulkanContext* vulkanContext, VkCommandBuffer commandBuffer, u32 frameIndex);
 
 const u32 INITIAL_VIEWPORT_WIDTH = 1200;
 const u32 INITIAL_VIEWPORT_HEIGHT = 1200;
 
 const u32 TRANS_MATS_UNIFORM_BUFFER_BINDING_INDEX = 0;
+const VkDeviceSize UNIFORM_RING_BUFFER_FRAME_CAPACITY = 1024 * 1024; // bytes of transient uniform data per frame in flight
 
 const u32 QUAD_VERTEX_INPUT_BINDING_INDEX = 0;
+const u32 INSTANCE_VERTEX_INPUT_BINDING_INDEX = 1;
+const u32 INSTANCE_ATTRIBUTE_FIRST_LOCATION = 4; // after the vertex attributes of any mesh, see PosColor_3DTransMats_Instanced.vert
+const VkPushConstantRange QUAD_PUSH_CONSTANT_RANGE = pushConstantRange<ModelPushConstants>(VK_SHADER_STAGE_VERTEX_BIT);
+const VkCullModeFlags QUAD_CULL_MODE = VK_CULL_MODE_BACK_BIT;
+const VkFrontFace QUAD_FRONT_FACE = VK_FRONT_FACE_CLOCKWISE;
+const VkPushConstantRange RAY_MARCH_SCENE_PUSH_CONSTANT_RANGE = pushConstantRange<RayMarchScene>(VK_SHADER_STAGE_FRAGMENT_BIT);
+
+struct RayMarchQualitySettings {
+  const char* name;
+  u32 maxSteps;
+  f32 hitDist;
+};
+// Indexed by RayMarchQuality, medium matches the ray march shaders' defaults
+const RayMarchQualitySettings RAY_MARCH_QUALITY_SETTINGS[RAY_MARCH_QUALITY_COUNT] = {
+  { "low", 16, 0.05f },
+  { "medium", 30, 0.01f },
+  { "high", 64, 0.002f }
+};
 const u64 DEFAULT_FENCE_TIMEOUT = 100000000000;
 
 #ifdef NOT_DEBUG
@@ -154,22 +346,70 @@ const char* ENGINE_NAME = "Kuring";
 
 const VkAllocationCallbacks* nullAllocator = nullptr;
 
-void runVulkanApp() {
-  GLFWwindow* window;
+void runVulkanApp(const VulkanAppSettings& settings) {
+  GLFWwindow* window = nullptr; // remains null when headless
   VulkanContext vulkanContext;
 
-  initGLFW(&window, &vulkanContext);
-  initializeInput(window);
+  initVulkanContextSettings(settings, &vulkanContext);
+  enableProfiler(settings.profileTracePath != nullptr);
+  if(!vulkanContext.headless) {
+    initGLFW(&window, &vulkanContext);
+    initializeInput(window);
+  }
   initVulkan(window, &vulkanContext);
-  mainLoop(window, &vulkanContext);
+
+  if(settings.benchmarkFrames > 0) {
+    runBenchmark(window, &vulkanContext, settings);
+  } else if(vulkanContext.headless) {
+    runHeadless(&vulkanContext, settings.headlessFrameCount, settings.outputImagePath);
+  } else if(settings.resizeStormToggles > 0) {
+    runResizeStorm(window, &vulkanContext, settings.resizeStormToggles);
+  } else if(settings.pipelineBatchBenchmarkCount > 0) {
+    runPipelineBatchBenchmark(&vulkanContext, settings.pipelineBatchBenchmarkCount);
+  } else if(settings.pipelineCacheBenchmarkIterations > 0) {
+    runPipelineCacheBenchmark(&vulkanContext, settings.pipelineCacheBenchmarkIterations);
+  } else if(settings.indirectDrawBenchmarkObjects > 0) {
+    runIndirectDrawBenchmark(&vulkanContext, settings.indirectDrawBenchmarkObjects);
+  } else if(settings.uniformBenchmarkBlocks > 0) {
+    runUniformUploadBenchmark(&vulkanContext, settings.uniformBenchmarkBlocks);
+  } else {
+    mainLoop(window, &vulkanContext);
+  }
   cleanup(window, &vulkanContext);
+
+  if(settings.profileTracePath != nullptr) {
+    writeProfilerTrace(settings.profileTracePath);
+  }
 }
 
-void mainLoop(GLFWwindow* window, VulkanContext* vulkanContext) {
-  populateCommandBuffers(vulkanContext);
+void initVulkanContextSettings(const VulkanAppSettings& settings, VulkanContext* vulkanContext) {
+  if(settings.framesInFlight == 0) {
+    throw std::runtime_error("at least one frame in flight is required!");
+  }
+  vulkanContext->headless = settings.headless;
+  vulkanContext->enablePipelineStatistics = settings.pipelineStatistics;
+  vulkanContext->pipelineCachePath = settings.pipelineCachePath;
+  vulkanContext->pipelineCacheStats = {};
+  vulkanContext->shaderHotReload.enabled = settings.shaderHotReloadDirectory != nullptr;
+  vulkanContext->shaderHotReload.sourceDirectory = settings.shaderHotReloadDirectory;
+  vulkanContext->meshPath = settings.meshPath;
+  vulkanContext->geometryStore = {}; // created by the first mesh added
+  vulkanContext->instanceCount = settings.instanceCount;
+  vulkanContext->recordingThreadCount = settings.recordingThreadCount;
+  vulkanContext->rayMarchMode = settings.rayMarchMode;
+  vulkanContext->rayMarchQuality = settings.rayMarchQuality;
+  vulkanContext->rayMarchFragment = {};
+  vulkanContext->frameCount = settings.framesInFlight;
+  vulkanContext->currentFrame = 0;
+  vulkanContext->frameNumber = 0;
+  vulkanContext->lastImageIndex = 0;
+  vulkanContext->swapChainRecreation = {};
+  vulkanContext->frameTimings = {};
+}
 
+void mainLoop(GLFWwindow* window, VulkanContext* vulkanContext) {
   while (!glfwWindowShouldClose(window)) {
-    processKeyboardInput();
+    processKeyboardInput(vulkanContext);
     drawFrame(vulkanContext);
     glfwPollEvents();
   }
@@ -177,7 +417,407 @@ void mainLoop(GLFWwindow* window, VulkanContext* vulkanContext) {
   vkDeviceWaitIdle(vulkanContext->device.logical);
 }
 
-void processKeyboardInput() {
+/*
+ * Benchmark that toggles between windowed and full screen mode every few frames, forcing a swap chain recreation
+ * each time, and reports swap chain recreation and frame times
+ */
+void runResizeStorm(GLFWwindow* window, VulkanContext* vulkanContext, u32 toggleCount) {
+  const u32 framesPerToggle = 4;
+  u32 frameCount = 0;
+  f64 totalFrameSeconds = 0.0;
+  f64 maxFrameSeconds = 0.0;
+
+  for (u32 toggle = 0; toggle < toggleCount && !glfwWindowShouldClose(window); ++toggle) {
+    toggleWindowSize(INITIAL_VIEWPORT_WIDTH, INITIAL_VIEWPORT_HEIGHT);
+    for (u32 i = 0; i < framesPerToggle; ++i) {
+      TimePoint frameStart = now();
+      glfwPollEvents();
+      drawFrame(vulkanContext);
+      f64 frameSeconds = secondsSince(frameStart);
+      totalFrameSeconds += frameSeconds;
+      maxFrameSeconds = max(maxFrameSeconds, frameSeconds);
+      ++frameCount;
+    }
+  }
+
+  vkDeviceWaitIdle(vulkanContext->device.logical);
+
+  u32 recreationCount = vulkanContext->swapChainRecreation.count;
+  f64 meanRecreationSeconds = recreationCount > 0 ? vulkanContext->swapChainRecreation.totalSeconds / recreationCount : 0.0;
+  std::cout << "resize storm: " << toggleCount << " toggles, " << frameCount << " frames\n"
+            << "\tswap chain recreations: " << recreationCount
+            << " (mean " << meanRecreationSeconds * 1000.0 << " ms, max " << vulkanContext->swapChainRecreation.maxSeconds * 1000.0 << " ms)\n"
+            << "\tframe time: mean " << (frameCount > 0 ? totalFrameSeconds / frameCount : 0.0) * 1000.0
+            << " ms, max " << maxFrameSeconds * 1000.0 << " ms" << std::endl;
+}
+
+/*
+ * Microbenchmark comparing per-block uniform uploads through vkMapMemory/vkUnmapMemory of a host visible buffer (the
+ * previous updateUniformBuffer path) against sub-allocations from a persistently mapped uniform ring buffer
+ */
+void runUniformUploadBenchmark(VulkanContext* vulkanContext, u32 blocksPerFrame) {
+  const u32 benchmarkFrames = 100;
+  VkDevice device = vulkanContext->device.logical;
+  TransMats transMats{};
+
+  // every block is allocated at minUniformBufferOffsetAlignment, which may exceed sizeof(TransMats) (ex: 256)
+  VkDeviceSize blockStride = alignUp(sizeof(TransMats), max(vulkanContext->device.minUniformBufferOffsetAlignment, (VkDeviceSize)1));
+  UniformRingBuffer ringBuffer;
+  initUniformRingBuffer(device, &vulkanContext->memoryAllocator, vulkanContext->device.minUniformBufferOffsetAlignment,
+                        blockStride * blocksPerFrame, 1, &ringBuffer);
+
+  // The allocator keeps host visible blocks persistently mapped, and memory may only be mapped once at a time, so the
+  // map/unmap path needs an allocation of its own
+  VkBuffer mapUnmapBuffer = createBuffer(device, ringBuffer.frameCapacity, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+  VkMemoryRequirements memReqs;
+  vkGetBufferMemoryRequirements(device, mapUnmapBuffer, &memReqs);
+  VkMemoryAllocateInfo memAllocInfo{};
+  memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  memAllocInfo.allocationSize = memReqs.size;
+  memAllocInfo.memoryTypeIndex = getMemoryTypeIndex(&vulkanContext->device.memoryProperties, memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  VkDeviceMemory mapUnmapMemory;
+  if (vkAllocateMemory(device, &memAllocInfo, nullAllocator, &mapUnmapMemory) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate uniform benchmark memory!");
+  }
+  if (vkBindBufferMemory(device, mapUnmapBuffer, mapUnmapMemory, 0) != VK_SUCCESS) {
+    throw std::runtime_error("failed to bind uniform benchmark memory!");
+  }
+
+  TimePoint mapUnmapStart = now();
+  for(u32 frame = 0; frame < benchmarkFrames; ++frame) {
+    for(u32 block = 0; block < blocksPerFrame; ++block) {
+      void* uniformBufferMemoryPointer;
+      if (vkMapMemory(device, mapUnmapMemory, block * blockStride, sizeof(transMats), 0, &uniformBufferMemoryPointer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to map uniform benchmark memory!");
+      }
+      memcpy(uniformBufferMemoryPointer, &transMats, sizeof(transMats));
+      vkUnmapMemory(device, mapUnmapMemory);
+    }
+  }
+  f64 mapUnmapSeconds = secondsSince(mapUnmapStart);
+
+  TimePoint ringBufferStart = now();
+  for(u32 frame = 0; frame < benchmarkFrames; ++frame) {
+    beginUniformRingBufferFrame(&ringBuffer, 0);
+    for(u32 block = 0; block < blocksPerFrame; ++block) {
+      UniformAllocation allocation = allocateUniforms(&ringBuffer, sizeof(transMats));
+      memcpy(allocation.data, &transMats, sizeof(transMats));
+    }
+  }
+  f64 ringBufferSeconds = secondsSince(ringBufferStart);
+
+  vkDestroyBuffer(device, mapUnmapBuffer, nullAllocator);
+  vkFreeMemory(device, mapUnmapMemory, nullAllocator);
+  destroyUniformRingBuffer(device, &vulkanContext->memoryAllocator, &ringBuffer);
+
+  f64 totalBlocks = (f64)benchmarkFrames * blocksPerFrame;
+  std::cout << "uniform upload benchmark: " << benchmarkFrames << " frames x " << blocksPerFrame << " blocks of " << sizeof(TransMats) << " bytes\n"
+            << "\tmap/unmap per block: " << mapUnmapSeconds * 1000.0 << " ms total, " << (mapUnmapSeconds / totalBlocks) * 1.0e9 << " ns/block\n"
+            << "\tring buffer: " << ringBufferSeconds * 1000.0 << " ms total, " << (ringBufferSeconds / totalBlocks) * 1.0e9 << " ns/block" << std::endl;
+}
+
+/*
+ * Render a fixed number of frames into offscreen images without a window, then optionally write the final frame to disk
+ */
+void runHeadless(VulkanContext* vulkanContext, u32 headlessFrameCount, const char* outputImagePath) {
+  for (u32 i = 0; i < headlessFrameCount; ++i) {
+    drawHeadlessFrame(vulkanContext);
+  }
+
+  vkDeviceWaitIdle(vulkanContext->device.logical);
+
+  if (outputImagePath != nullptr && headlessFrameCount > 0) {
+    writeOffscreenImage(vulkanContext, vulkanContext->lastImageIndex, outputImagePath);
+  }
+  if(isComputeRayMarch(vulkanContext->rayMarchMode)) {
+    printRayMarchResults(&vulkanContext->rayMarch);
+  }
+  printGpuMemoryStats(&vulkanContext->memoryAllocator);
+  printUploadQueueStats(&vulkanContext->uploadQueue);
+}
+
+internal_access const char* presentModeName(VkPresentModeKHR presentMode) {
+  switch(presentMode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo relaxed";
+    default: return "other";
+  }
+}
+
+internal_access void drawNextFrame(VulkanContext* vulkanContext) {
+  if(vulkanContext->headless) {
+    drawHeadlessFrame(vulkanContext);
+  } else {
+    drawFrame(vulkanContext);
+  }
+}
+
+/*
+ * Benchmark a fixed scene, windowed or headless
+ *    - Draw warm-up frames, which are not measured, so that caches, clocks and the swap chain settle
+ *    - Draw measured frames, sampling CPU frame time and the time spent in each stage of drawing a frame
+ *    - Report min/mean/p50/p95/p99/max of each and total throughput to stdout and as JSON
+ */
+void runBenchmark(GLFWwindow* window, VulkanContext* vulkanContext, const VulkanAppSettings& settings) {
+  BenchmarkResults results{};
+  results.warmupFrames = settings.benchmarkWarmupFrames;
+  results.measuredFrames = settings.benchmarkFrames;
+  u32 cpuFrameSeries = addBenchmarkSeries(&results, "cpu frame");
+  u32 fenceWaitSeries = addBenchmarkSeries(&results, "fence wait");
+  u32 acquireSeries = addBenchmarkSeries(&results, "acquire");
+  u32 submitSeries = addBenchmarkSeries(&results, "submit");
+  u32 presentSeries = addBenchmarkSeries(&results, "present");
+
+  for (u32 i = 0; i < settings.benchmarkWarmupFrames; ++i) {
+    if(window != nullptr) { glfwPollEvents(); }
+    drawNextFrame(vulkanContext);
+  }
+
+  u64 lastGpuFrameNumber = UINT64_MAX;
+  u64 lastRayMarchFrameNumber = UINT64_MAX;
+  TimePoint benchmarkStart = now();
+  for (u32 i = 0; i < settings.benchmarkFrames; ++i) {
+    TimePoint frameStart = now();
+    if(window != nullptr) { glfwPollEvents(); }
+    drawNextFrame(vulkanContext);
+    f64 frameSeconds = secondsSince(frameStart);
+
+    addBenchmarkSample(&results, cpuFrameSeries, frameSeconds * 1000.0);
+    addBenchmarkSample(&results, fenceWaitSeries, vulkanContext->frameTimings.fenceWaitSeconds * 1000.0);
+    addBenchmarkSample(&results, acquireSeries, vulkanContext->frameTimings.acquireSeconds * 1000.0);
+    addBenchmarkSample(&results, submitSeries, vulkanContext->frameTimings.submitSeconds * 1000.0);
+    addBenchmarkSample(&results, presentSeries, vulkanContext->frameTimings.presentSeconds * 1000.0);
+
+    // GPU results lag frames in flight behind, the first few come from warm-up frames
+    const GpuFrameResults* gpuResults = getLatestGpuQueryResults(&vulkanContext->gpuQueries);
+    if(gpuResults != nullptr && gpuResults->frameNumber != lastGpuFrameNumber) {
+      lastGpuFrameNumber = gpuResults->frameNumber;
+      if(gpuResults->timestampCount > 0) {
+        addBenchmarkSample(&results, findBenchmarkSeries(&results, "gpu frame", "ms"), gpuResults->totalMilliseconds);
+      }
+      for(u32 t = 1; t < gpuResults->timestampCount; ++t) {
+        addBenchmarkSample(&results, findBenchmarkSeries(&results, std::string("gpu ") + gpuResults->timestampNames[t], "ms"), gpuResults->durationMilliseconds[t]);
+      }
+      if(gpuResults->hasPipelineStatistics) {
+        for(u32 s = 0; s < GPU_PIPELINE_STATISTICS_COUNT; ++s) {
+          addBenchmarkSample(&results, findBenchmarkSeries(&results, GPU_PIPELINE_STATISTIC_NAMES[s], "count"), (f64)gpuResults->pipelineStatistics[s]);
+        }
+      }
+    }
+    const RayMarchResults* rayMarchResults = isComputeRayMarch(vulkanContext->rayMarchMode) ? getLatestRayMarchResults(&vulkanContext->rayMarch) : nullptr;
+    if(rayMarchResults != nullptr && rayMarchResults->frameNumber != lastRayMarchFrameNumber) {
+      lastRayMarchFrameNumber = rayMarchResults->frameNumber;
+      const RayMarchStats& stats = rayMarchResults->stats;
+      addBenchmarkSample(&results, findBenchmarkSeries(&results, "ray march steps", "count"), (f64)stats.tileSteps + stats.pixelSteps);
+      addBenchmarkSample(&results, findBenchmarkSeries(&results, "ray march tile steps", "count"), (f64)stats.tileSteps);
+      addBenchmarkSample(&results, findBenchmarkSeries(&results, "ray march pixel steps", "count"), (f64)stats.pixelSteps);
+      addBenchmarkSample(&results, findBenchmarkSeries(&results, "ray march empty tiles", "count"), (f64)stats.emptyTiles);
+    }
+  }
+  results.measuredSeconds = secondsSince(benchmarkStart);
+
+  vkDeviceWaitIdle(vulkanContext->device.logical);
+
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(vulkanContext->device.physical, &deviceProperties);
+  results.deviceName = deviceProperties.deviceName;
+  results.driverVersion = deviceProperties.driverVersion;
+  results.apiVersion = deviceProperties.apiVersion;
+  results.presentMode = vulkanContext->headless ? "headless" : presentModeName(vulkanContext->swapChain.presentMode);
+  results.framesInFlight = vulkanContext->frameCount;
+  results.width = vulkanContext->swapChain.extent.width;
+  results.height = vulkanContext->swapChain.extent.height;
+
+  printBenchmarkResults(&results);
+  if(isComputeRayMarch(vulkanContext->rayMarchMode)) {
+    printRayMarchResults(&vulkanContext->rayMarch);
+  }
+  printShaderModuleCacheStats(&vulkanContext->shaderModuleCache);
+  printGpuMemoryStats(&vulkanContext->memoryAllocator);
+  printUploadQueueStats(&vulkanContext->uploadQueue);
+  writeBenchmarkResultsJson(&results, settings.benchmarkOutputPath);
+}
+
+/*
+ * Benchmark comparing quad pipeline creation with an empty pipeline cache (cold) against the application's pipeline
+ * cache, which was loaded from disk and/or populated by initGraphicsPipeline (warm)
+ * NOTE: Some drivers keep their own shader caches on disk, which can make cold builds look warmer than they are
+ */
+void runPipelineCacheBenchmark(VulkanContext* vulkanContext, u32 iterations) {
+  VkDevice device = vulkanContext->device.logical;
+  f64 coldTotalSeconds = 0.0, coldMaxSeconds = 0.0;
+  f64 warmTotalSeconds = 0.0, warmMaxSeconds = 0.0;
+
+  for (u32 i = 0; i < iterations; ++i) {
+    VkPipeline pipeline;
+    VkPipelineLayout pipelineLayout;
+
+    VkPipelineCacheCreateInfo emptyPipelineCacheCI{};
+    emptyPipelineCacheCI.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    VkPipelineCache emptyPipelineCache;
+    vkCreatePipelineCache(device, &emptyPipelineCacheCI, nullAllocator, &emptyPipelineCache);
+
+    TimePoint coldStart = now();
+    buildQuadPipeline(vulkanContext, emptyPipelineCache, &pipeline, &pipelineLayout);
+    f64 coldSeconds = secondsSince(coldStart);
+    coldTotalSeconds += coldSeconds;
+    coldMaxSeconds = max(coldMaxSeconds, coldSeconds);
+    vkDestroyPipeline(device, pipeline, nullAllocator);
+    vkDestroyPipelineLayout(device, pipelineLayout, nullAllocator);
+    vkDestroyPipelineCache(device, emptyPipelineCache, nullAllocator);
+
+    TimePoint warmStart = now();
+    buildQuadPipeline(vulkanContext, vulkanContext->pipelineCache, &pipeline, &pipelineLayout);
+    f64 warmSeconds = secondsSince(warmStart);
+    warmTotalSeconds += warmSeconds;
+    warmMaxSeconds = max(warmMaxSeconds, warmSeconds);
+    vkDestroyPipeline(device, pipeline, nullAllocator);
+    vkDestroyPipelineLayout(device, pipelineLayout, nullAllocator);
+  }
+
+  std::cout << "pipeline cache: " << iterations << " iterations, startup cache "
+            << (vulkanContext->pipelineCacheStats.loadedFromDisk ? "loaded from disk" : "cold")
+            << " (initGraphicsPipeline " << vulkanContext->pipelineCacheStats.initialBuildSeconds * 1000.0 << " ms)\n"
+            << "\tcold: mean " << (coldTotalSeconds / iterations) * 1000.0 << " ms, max " << coldMaxSeconds * 1000.0 << " ms\n"
+            << "\twarm: mean " << (warmTotalSeconds / iterations) * 1000.0 << " ms, max " << warmMaxSeconds * 1000.0 << " ms" << std::endl;
+  printShaderModuleCacheStats(&vulkanContext->shaderModuleCache);
+}
+
+/*
+ * Benchmark comparing building the quad pipeline pipelineCount times serially on the main thread against building
+ * them as a single batch on the thread pool
+ * NOTE: No pipeline cache is used so that every build is a full compile, driver internal caches may still hit
+ */
+void runPipelineBatchBenchmark(VulkanContext* vulkanContext, u32 pipelineCount) {
+  VkDevice device = vulkanContext->device.logical;
+  std::vector<BuiltPipeline> pipelines(pipelineCount);
+
+  TimePoint serialStart = now();
+  for (u32 i = 0; i < pipelineCount; ++i) {
+    buildQuadPipeline(vulkanContext, VK_NULL_HANDLE, &pipelines[i].pipeline, &pipelines[i].pipelineLayout);
+  }
+  f64 serialSeconds = secondsSince(serialStart);
+  for (BuiltPipeline& builtPipeline : pipelines) {
+    vkDestroyPipeline(device, builtPipeline.pipeline, nullAllocator);
+    vkDestroyPipelineLayout(device, builtPipeline.pipelineLayout, nullAllocator);
+  }
+
+  TimePoint batchStart = now();
+  PipelineBatch batch;
+  initPipelineBatch(device, VK_NULL_HANDLE, &vulkanContext->shaderModuleCache, &vulkanContext->threadPool, &batch);
+  for (u32 i = 0; i < pipelineCount; ++i) {
+    submitPipeline(&batch, [vulkanContext](GraphicsPipelineBuilder& builder) { configureQuadPipeline(vulkanContext, builder); });
+  }
+  waitForPipelineBatch(&batch);
+  f64 batchSeconds = secondsSince(batchStart);
+  for (std::shared_future<BuiltPipeline>& builtPipeline : batch.pipelines) {
+    vkDestroyPipeline(device, builtPipeline.get().pipeline, nullAllocator);
+    vkDestroyPipelineLayout(device, builtPipeline.get().pipelineLayout, nullAllocator);
+  }
+
+  std::cout << "pipeline batch: " << pipelineCount << " pipelines, " << vulkanContext->threadPool.workers.size() << " worker threads\n"
+            << "\tserial: " << serialSeconds * 1000.0 << " ms\n"
+            << "\tbatch: " << batchSeconds * 1000.0 << " ms (" << (batchSeconds > 0.0 ? serialSeconds / batchSeconds : 0.0) << "x)" << std::endl;
+  printShaderModuleCacheStats(&vulkanContext->shaderModuleCache);
+}
+
+internal_access void beginBenchmarkRenderPass(VulkanContext* vulkanContext, VkCommandBuffer commandBuffer) {
+  VkCommandBufferBeginInfo commandBufferBeginInfo{};
+  commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  if (vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("failed to begin recording command buffer!");
+  }
+  VkClearValue clearValue;
+  clearValue.color = {0.0f, 0.0f, 0.0f, 1.0f};
+  VkRenderPassBeginInfo renderPassBeginInfo{};
+  renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  renderPassBeginInfo.renderPass = vulkanContext->renderPass;
+  renderPassBeginInfo.framebuffer = vulkanContext->swapChain.framebuffers[0];
+  renderPassBeginInfo.renderArea.extent = vulkanContext->swapChain.extent;
+  renderPassBeginInfo.clearValueCount = 1;
+  renderPassBeginInfo.pClearValues = &clearValue;
+  vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+  cmdBindQuadPipelineState(vulkanContext, commandBuffer, 0);
+}
+
+internal_access void endBenchmarkRenderPass(VkCommandBuffer commandBuffer) {
+  vkCmdEndRenderPass(commandBuffer);
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record command buffer!");
+  }
+}
+
+/*
+ * Benchmark comparing the CPU time of recording the quad pass for 1 to maxObjectCount objects (powers of ten), each
+ * object being the mesh drawn once:
+ *  - direct: one vkCmdDrawIndexed per object and submesh
+ *  - indirect: writing one VkDrawIndexedIndirectCommand per object and submesh, then recording a single cmdDrawIndirect
+ * NOTE: Command buffers are recorded but never submitted, only the CPU side is measured
+ */
+void runIndirectDrawBenchmark(VulkanContext* vulkanContext, u32 maxObjectCount) {
+  const u32 iterations = 16;
+  vkDeviceWaitIdle(vulkanContext->device.logical);
+  VkCommandBuffer commandBuffer = vulkanContext->frames[0].commandBuffer;
+  const GeometryStore& store = vulkanContext->geometryStore;
+  const GeometryStoreMesh& mesh = store.meshes[vulkanContext->vertexAtt.meshIndex];
+
+  // one command per object and submesh, computed wide since the product easily exceeds u32
+  u64 drawCount = (u64)maxObjectCount * mesh.submeshCount;
+  if (drawCount > UINT32_MAX / sizeof(VkDrawIndexedIndirectCommand)) {
+    throw std::runtime_error("indirect draw benchmark object count too large for the mesh's submeshes!");
+  }
+  IndirectDrawBuffer indirectDraws;
+  initIndirectDrawBuffer(vulkanContext->device.logical, &vulkanContext->memoryAllocator, (u32)drawCount, &indirectDraws);
+
+  const IndirectDrawSupport& support = vulkanContext->device.indirectDraw;
+  std::cout << "indirect draw: " << mesh.submeshCount << " submeshes per object, "
+            << (support.drawIndirectCount ? "draw indirect count" : support.multiDrawIndirect ? "multi draw indirect" : "single draw indirect")
+            << ", " << iterations << " iterations\n";
+  for (u32 objectCount = 1;; objectCount = min(objectCount * 10, maxObjectCount)) {
+    TimePoint directStart = now();
+    for (u32 iteration = 0; iteration < iterations; ++iteration) {
+      beginBenchmarkRenderPass(vulkanContext, commandBuffer);
+      for (u32 object = 0; object < objectCount; ++object) {
+        for (u32 i = 0; i < mesh.submeshCount; ++i) {
+          const MeshFileSubmesh& submesh = store.submeshes[mesh.firstSubmesh + i];
+          vkCmdDrawIndexed(commandBuffer, submesh.indexCount, 1, submesh.firstIndex, submesh.vertexOffset, 0);
+        }
+      }
+      endBenchmarkRenderPass(commandBuffer);
+    }
+    f64 directSeconds = secondsSince(directStart) / iterations;
+
+    TimePoint writeStart = now();
+    for (u32 iteration = 0; iteration < iterations; ++iteration) {
+      resetIndirectDraws(&indirectDraws);
+      for (u32 object = 0; object < objectCount; ++object) {
+        pushMeshDraws(&indirectDraws, store, vulkanContext->vertexAtt.meshIndex, 1, 0);
+      }
+    }
+    f64 writeSeconds = secondsSince(writeStart) / iterations;
+
+    TimePoint recordStart = now();
+    for (u32 iteration = 0; iteration < iterations; ++iteration) {
+      beginBenchmarkRenderPass(vulkanContext, commandBuffer);
+      cmdDrawIndirect(commandBuffer, indirectDraws, support);
+      endBenchmarkRenderPass(commandBuffer);
+    }
+    f64 recordSeconds = secondsSince(recordStart) / iterations;
+
+    std::cout << "\t" << objectCount << " objects\n"
+              << "\t\tdirect: " << directSeconds * 1000.0 << " ms\n"
+              << "\t\tindirect: " << recordSeconds * 1000.0 << " ms recording, " << writeSeconds * 1000.0 << " ms writing commands" << std::endl;
+    if (objectCount == maxObjectCount) {
+      break;
+    }
+  }
+  destroyIndirectDrawBuffer(vulkanContext->device.logical, &vulkanContext->memoryAllocator, &indirectDraws);
+}
+
+void processKeyboardInput(VulkanContext* vulkanContext) {
   loadInputStateForFrame();
 
   if (hotPress(KeyboardInput_Esc)) {
@@ -187,10 +827,31 @@ void processKeyboardInput() {
   if(isActive(KeyboardInput_Alt_Right) && hotPress(KeyboardInput_Enter)) {
     toggleWindowSize(INITIAL_VIEWPORT_WIDTH, INITIAL_VIEWPORT_HEIGHT);
   }
+
+  // Every quality's pipeline is built up front, switching only changes the pipeline bound by the next frames
+  if(vulkanContext->rayMarchMode == RAY_MARCH_FRAGMENT) {
+    const InputType qualityKeys[RAY_MARCH_QUALITY_COUNT] = { KeyboardInput_1, KeyboardInput_2, KeyboardInput_3 };
+    for(u32 quality = 0; quality < RAY_MARCH_QUALITY_COUNT; ++quality) {
+      if(hotPress(qualityKeys[quality]) && vulkanContext->rayMarchQuality != quality) {
+        vulkanContext->rayMarchQuality = (RayMarchQuality)quality;
+        std::cout << "ray march quality: " << RAY_MARCH_QUALITY_SETTINGS[quality].name << std::endl;
+      }
+    }
+  }
 }
 
+/*
+ * - Recreate the swap chain, passing the old one along so the presentation engine can reuse its resources
+ * - Rebuild only what depends on the swap chain's images or extent: image views, framebuffers, images in flight tracking
+ *   and the ray march target
+ * - Old swap chain resources may still be in use by frames in flight, so they are retired rather than destroyed and
+ *   released after those frames have completed (no vkDeviceWaitIdle)
+ * - Render pass, pipelines (dynamic viewport/scissor), descriptors and uniform buffers are independent of the swap
+ *   chain and are kept
+ */
 void recreateSwapChain(VulkanContext* vulkanContext)
 {
+  ProfileFunction();
   VkDevice device = vulkanContext->device.logical;
   Extent2D windowExtent = getWindowExtent();
   while (windowExtent.width == 0 || windowExtent.height == 0) {
@@ -198,114 +859,348 @@ void recreateSwapChain(VulkanContext* vulkanContext)
     windowExtent = getWindowExtent();
   }
 
-  vulkanContext->windowExtent = { windowExtent.width, windowExtent.height };
-
-  // Ensure all operations on the device have been finished before destroying resources
-  vkDeviceWaitIdle(device);
+  TimePoint recreationStart = now();
 
-  // cleanup
-  vkFreeCommandBuffers(device, vulkanContext->graphicsCommandPool, vulkanContext->commandBufferCount, vulkanContext->commandBuffers);
-  destroyFramebuffers(vulkanContext);
-  vkDestroyPipeline(device, vulkanContext->graphicsPipeline, nullAllocator);
-  vkDestroyPipelineLayout(device, vulkanContext->pipelineLayout, nullAllocator);
-  vkDestroyDescriptorPool(device, vulkanContext->uniformBuffers.descriptorPool, nullAllocator);
-  vkDestroyDescriptorSetLayout(device, vulkanContext->uniformBuffers.descriptorSetLayout, nullAllocator);
-  vkDestroyBuffer(device, vulkanContext->uniformBuffers.buffer, nullAllocator);
-  vkFreeMemory(device, vulkanContext->uniformBuffers.memory, nullAllocator);
-  destroyImageViews(vulkanContext);
-  vkDestroySwapchainKHR(device, vulkanContext->swapChain.handle, nullAllocator);
+  vulkanContext->windowExtent = { windowExtent.width, windowExtent.height };
 
-  QueueFamilyIndices queueFamilyIndices;
-  findQueueFamilies(vulkanContext->surface, vulkanContext->device.physical, &queueFamilyIndices);
+  RetiredSwapChain retiredSwapChain;
+  retiredSwapChain.swapChain = vulkanContext->swapChain;
+  retiredSwapChain.retiredFrameNumber = vulkanContext->frameNumber;
 
   // Note: Recreate swap chain with new dimensions
-  initSwapChain(vulkanContext, queueFamilyIndices);
+  initSwapChain(vulkanContext, vulkanContext->device.queueFamilyIndices, retiredSwapChain.swapChain.handle);
+  initSwapChainRayMarchTarget(vulkanContext);
   // image views are directly associated with swap chain images
   initImageViews(&device, &vulkanContext->swapChain);
-  // Uniform buffer count depends on number of images in the swap chain
-  prepareUniformBufferMemory(vulkanContext);
-  // descriptor set count depends on swap chain image count
-  initDescriptorPool(vulkanContext);
-  initDescriptorSetLayout(vulkanContext);
-  initDescriptorSets(vulkanContext);
-  // The graphics pipeline contains viewport/scissor information that most likely needs to be updated
-  initGraphicsPipeline(vulkanContext);
+  // images in flight tracking depends on swap chain image count
+  delete[] vulkanContext->imagesInFlight;
+  initImagesInFlight(vulkanContext);
   // Framebuffers references the render pass and, in our situation, are wrappers around image views of the swap chain's images
   initFramebuffers(vulkanContext);
-  // Command buffer count depends on swap chain image count
-  initSwapChainCommandBuffers(vulkanContext);
-  populateCommandBuffers(vulkanContext);
+
+  vulkanContext->retiredSwapChains.push_back(retiredSwapChain);
+
+  f64 recreationSeconds = secondsSince(recreationStart);
+  vulkanContext->swapChainRecreation.count++;
+  vulkanContext->swapChainRecreation.totalSeconds += recreationSeconds;
+  vulkanContext->swapChainRecreation.maxSeconds = max(vulkanContext->swapChainRecreation.maxSeconds, recreationSeconds);
 
   // TODO: notify shaders uniforms
 }
 
-void updateUniformBuffer(VulkanContext* vulkanContext, u32 index) {
+/*
+ * - Destroy retired swap chains once every frame that may have referenced them has completed
+ * - Frames are numbered in submission order and each frame's fence is waited on before its slot is reused, so once
+ *   frameCount frames have been submitted since retirement, all frames using the retired resources have completed.
+ *   One additional frame is waited for to give the presentation engine time to release the old images.
+ */
+void releaseRetiredSwapChains(VulkanContext* vulkanContext, bool32 releaseAll) {
+  VkDevice device = vulkanContext->device.logical;
+  std::vector<RetiredSwapChain>& retiredSwapChains = vulkanContext->retiredSwapChains;
+  u32 keptCount = 0;
+  for(u32 i = 0; i < retiredSwapChains.size(); ++i) {
+    RetiredSwapChain& retired = retiredSwapChains[i];
+    if(releaseAll || vulkanContext->frameNumber > retired.retiredFrameNumber + vulkanContext->frameCount) {
+      destroySwapChain(device, &vulkanContext->memoryAllocator, &retired.swapChain);
+    } else {
+      retiredSwapChains[keptCount++] = retired;
+    }
+  }
+  retiredSwapChains.resize(keptCount);
+}
+
+template<typename T>
+internal_access bool32 isFutureReady(const std::shared_future<T>& future) {
+  return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+internal_access bool32 usesAnyShader(const HotReloadPipeline& pipeline, const std::vector<std::string>& spirvPaths) {
+  for(const std::string& spirvPath : spirvPaths) {
+    for(const std::string& shaderPath : pipeline.shaderPaths) {
+      if(shaderPath == spirvPath) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+internal_access bool32 areRebuildsReady(const std::vector<PipelineRebuild>& rebuilds) {
+  for(const PipelineRebuild& rebuild : rebuilds) {
+    if(!isFutureReady(rebuild.rebuilt)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * - Called at the frame boundary, once the frame's fence has been waited on and before its command buffer is recorded
+ * - Swap in the rebuilt pipelines once all of them are done, so that the users of a shader (ex: every quality of
+ *   RayMarchSphere.frag) switch on the same frame. The replaced pipelines are retired rather than destroyed, frames in
+ *   flight may still be using them (no vkDeviceWaitIdle)
+ * - Queue a rebuild of every pipeline built from a shader that compiled (see initHotReloadPipelines)
+ * - Queue compilation of the sources changed since the last compile, only one compile or set of rebuilds is in
+ *   flight at a time and changes made meanwhile are picked up by the next one
+ * - A failed compile or rebuild is reported and the current pipeline is kept
+ */
+void updateShaderHotReload(VulkanContext* vulkanContext)
+{
+  ProfileFunction();
+  auto* hotReload = &vulkanContext->shaderHotReload;
+  releaseRetiredPipelines(vulkanContext, false);
+
+  if(!hotReload->rebuilds.empty() && areRebuildsReady(hotReload->rebuilds)) {
+    for(PipelineRebuild& rebuild : hotReload->rebuilds) {
+      HotReloadPipeline& pipeline = hotReload->pipelines[rebuild.pipelineIndex];
+      try {
+        BuiltPipeline rebuiltPipeline = rebuild.rebuilt.get();
+        RetiredPipeline retiredPipeline;
+        retiredPipeline.pipeline = { *pipeline.pipeline, *pipeline.pipelineLayout };
+        retiredPipeline.retiredFrameNumber = vulkanContext->frameNumber;
+        hotReload->retiredPipelines.push_back(retiredPipeline);
+        *pipeline.pipeline = rebuiltPipeline.pipeline;
+        *pipeline.pipelineLayout = rebuiltPipeline.pipelineLayout;
+        std::cout << "shader hot reload: " << pipeline.name << " pipeline rebuilt, swapped in at frame " << vulkanContext->frameNumber
+                  << " after " << secondsSince(hotReload->rebuildStart) * 1000.0 << " ms" << std::endl;
+      } catch(const std::exception& e) {
+        std::cerr << "shader hot reload: failed to rebuild " << pipeline.name << " pipeline, keeping the current one: " << e.what() << std::endl;
+      }
+    }
+    hotReload->rebuilds.clear();
+  }
+
+  if(isFutureReady(hotReload->compile)) {
+    std::vector<std::string> compiledPaths = hotReload->compile.get();
+    hotReload->compile = std::shared_future<std::vector<std::string>>();
+    for(const std::string& compiledPath : compiledPaths) {
+      invalidateShaderModule(&vulkanContext->shaderModuleCache, compiledPath.c_str());
+    }
+    PipelineBatch batch;
+    initPipelineBatch(vulkanContext->device.logical, vulkanContext->pipelineCache, &vulkanContext->shaderModuleCache, &vulkanContext->threadPool, &batch);
+    hotReload->rebuildStart = now();
+    for(u32 i = 0; i < hotReload->pipelines.size(); ++i) {
+      if(usesAnyShader(hotReload->pipelines[i], compiledPaths)) {
+        hotReload->rebuilds.push_back({ i, submitPipelineBuild(&batch, hotReload->pipelines[i].build) });
+      }
+    }
+  }
+
+  pollShaderChanges(&hotReload->watcher, &hotReload->changedSources);
+  if(hotReload->changedSources.empty() || hotReload->compile.valid() || !hotReload->rebuilds.empty()) {
+    return;
+  }
+
+  std::vector<std::string> sources;
+  sources.swap(hotReload->changedSources);
+  const ShaderWatcher* watcher = &hotReload->watcher; // compileShader only reads the watcher's directories and compiler
+  auto compileTask = std::make_shared<std::packaged_task<std::vector<std::string>()>>([watcher, sources]() {
+    ProfileScope("compile shaders");
+    std::vector<std::string> compiledPaths;
+    for(const std::string& source : sources) {
+      TimePoint compileStart = now();
+      if(!compileShader(watcher, source)) {
+        std::cerr << "shader hot reload: failed to compile " << source << ", keeping the current pipeline" << std::endl;
+        continue;
+      }
+      std::cout << "shader hot reload: compiled " << source << " in " << secondsSince(compileStart) * 1000.0 << " ms" << std::endl;
+      compiledPaths.push_back(shaderOutputPath(watcher, source));
+    }
+    return compiledPaths;
+  });
+  hotReload->compile = compileTask->get_future().share();
+  submitJob(&vulkanContext->threadPool, [compileTask]() { (*compileTask)(); });
+}
+
+// Same rule as retired swap chains, see releaseRetiredSwapChains
+void releaseRetiredPipelines(VulkanContext* vulkanContext, bool32 releaseAll)
+{
+  VkDevice device = vulkanContext->device.logical;
+  std::vector<RetiredPipeline>& retiredPipelines = vulkanContext->shaderHotReload.retiredPipelines;
+  u32 keptCount = 0;
+  for(u32 i = 0; i < retiredPipelines.size(); ++i) {
+    RetiredPipeline& retired = retiredPipelines[i];
+    if(releaseAll || vulkanContext->frameNumber > retired.retiredFrameNumber + vulkanContext->frameCount) {
+      vkDestroyPipeline(device, retired.pipeline.pipeline, nullAllocator);
+      vkDestroyPipelineLayout(device, retired.pipeline.pipelineLayout, nullAllocator);
+    } else {
+      retiredPipelines[keptCount++] = retired;
+    }
+  }
+  retiredPipelines.resize(keptCount);
+}
+
+void updateUniformBuffer(VulkanContext* vulkanContext, u32 frameIndex) {
+  ProfileFunction();
   local_access auto startTime = std::chrono::high_resolution_clock::now();
 
   auto currentTime = std::chrono::high_resolution_clock::now();
   f32 time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
 
+  // per draw data is recorded with push constants
+  vulkanContext->frames[frameIndex].quadPushConstants.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f))
+                                                               * vulkanContext->vertexAtt.modelNormalization;
+
   TransMats ubo{};
-  ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
   ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
   ubo.proj = glm::perspective(glm::radians(45.0f), (f32)vulkanContext->swapChain.extent.width / vulkanContext->swapChain.extent.height, 0.1f, 10.0f);
-  void* uniformBufferMemoryPointer;
-  vkMapMemory(vulkanContext->device.logical, vulkanContext->uniformBuffers.memory, vulkanContext->uniformBuffers.offsets[index], sizeof(ubo), 0, &uniformBufferMemoryPointer);
-    memcpy(uniformBufferMemoryPointer, &ubo, sizeof(ubo));
-  vkUnmapMemory(vulkanContext->device.logical, vulkanContext->uniformBuffers.memory);
+
+  // NOTE: build locally and copy, uniform memory may be write-combined and slow to read from
+  UniformAllocation allocation = allocateUniforms(&vulkanContext->uniformBuffers.ringBuffer, sizeof(ubo));
+  memcpy(allocation.data, &ubo, sizeof(ubo));
+  vulkanContext->frames[frameIndex].transMatsOffset = allocation.offset;
 }
 
-void drawFrame(VulkanContext* vulkanContext)
+/*
+ * - Wait for the GPU to finish with the current frame in flight's resources so that they may be reused
+ */
+FrameInFlight* beginFrame(VulkanContext* vulkanContext)
 {
-  u32 swapChainImageIndex; // index inside swapChain.images
-  VkResult acquireResult = vkAcquireNextImageKHR(vulkanContext->device.logical,
-                        vulkanContext->swapChain.handle,
-                        UINT64_MAX,
-                        vulkanContext->semaphores.present/*get informed when presentation is complete*/,
-                        VK_NULL_HANDLE /*fence signal*/,
-                        &swapChainImageIndex);
-
-  if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR) {
-    recreateSwapChain(vulkanContext);
-    acquireResult = vkAcquireNextImageKHR(
-            vulkanContext->device.logical,
-             vulkanContext->swapChain.handle,
-             UINT64_MAX,
-             vulkanContext->semaphores.present/*get informed when presentation is complete*/,
-             VK_NULL_HANDLE /*fence signal*/,
-             &swapChainImageIndex);
+  ProfileFunction();
+  FrameInFlight* frame = &vulkanContext->frames[vulkanContext->currentFrame];
+  vulkanContext->frameTimings = {};
+
+  // CPU may run at most frameCount frames ahead of the GPU
+  {
+    ProfileScope("frame fence wait");
+    TimePoint fenceWaitStart = now();
+    vkWaitForFences(vulkanContext->device.logical, 1, &frame->fence, VK_TRUE, UINT64_MAX);
+    vulkanContext->frameTimings.fenceWaitSeconds = secondsSince(fenceWaitStart);
   }
-
-  if (acquireResult != VK_SUCCESS && acquireResult != VK_SUBOPTIMAL_KHR) {
-    throw std::runtime_error("failed to acquire swap chain image!");
+  // the GPU is done with this frame's queries
+  readGpuQueryResults(vulkanContext->device.logical, &vulkanContext->gpuQueries, vulkanContext->currentFrame);
+  if(isComputeRayMarch(vulkanContext->rayMarchMode)) {
+    readRayMarchStats(&vulkanContext->rayMarch, vulkanContext->currentFrame);
   }
+  releaseRetiredSwapChains(vulkanContext, false);
+  releaseCompletedUploads(&vulkanContext->uploadQueue);
+  if(vulkanContext->shaderHotReload.enabled) {
+    updateShaderHotReload(vulkanContext);
+  }
+  // the GPU is done with this frame's uniform data
+  beginUniformRingBufferFrame(&vulkanContext->uniformBuffers.ringBuffer, vulkanContext->currentFrame);
 
-  updateUniformBuffer(vulkanContext, swapChainImageIndex);
+  return frame;
+}
 
-  vkWaitForFences(vulkanContext->device.logical, 1, &vulkanContext->commandBufferFences[swapChainImageIndex], VK_TRUE, UINT64_MAX);
-  vkResetFences(vulkanContext->device.logical, 1, &vulkanContext->commandBufferFences[swapChainImageIndex]);
+/*
+ * - Wait for any other frame in flight that is still rendering to the target image
+ * - Update the frame's uniform buffer slice and record its command buffer against the target image
+ * - Submit, optionally waiting on and signaling semaphores. Also waits on the upload timeline semaphore when the
+ *   command buffer acquires uploaded buffers
+ */
+void recordAndSubmitFrame(VulkanContext* vulkanContext, u32 swapChainImageIndex, VkSemaphore waitSemaphore, VkSemaphore signalSemaphore)
+{
+  ProfileFunction();
+  FrameInFlight* frame = &vulkanContext->frames[vulkanContext->currentFrame];
+  TimePoint submitStart = now();
+
+  // Swap chain images may be acquired out of order, or there may be fewer images than frames in flight
+  VkFence* imageInFlight = &vulkanContext->imagesInFlight[swapChainImageIndex];
+  if (*imageInFlight != VK_NULL_HANDLE && *imageInFlight != frame->fence) {
+    ProfileScope("image in flight wait");
+    vkWaitForFences(vulkanContext->device.logical, 1, imageInFlight, VK_TRUE, UINT64_MAX);
+  }
+  *imageInFlight = frame->fence;
+
+  updateUniformBuffer(vulkanContext, vulkanContext->currentFrame);
+  populateCommandBuffer(vulkanContext, vulkanContext->currentFrame, swapChainImageIndex);
+
+  vkResetFences(vulkanContext->device.logical, 1, &frame->fence);
+
+  VkSemaphore waitSemaphores[2];
+  VkPipelineStageFlags waitStages[2]; // what stage of the wait semaphore to wait for
+  u64 waitValues[2]; // ignored for binary semaphores
+  u32 waitCount = 0;
+  if (waitSemaphore != VK_NULL_HANDLE) {
+    // Ensure that the image has been presented before we modify it
+    waitSemaphores[waitCount] = waitSemaphore;
+    waitStages[waitCount] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    waitValues[waitCount++] = 0;
+  }
+  if (frame->uploadWait.semaphore != VK_NULL_HANDLE) {
+    // Ensure the uploads acquired by the command buffer have completed on the transfer queue
+    waitSemaphores[waitCount] = frame->uploadWait.semaphore;
+    waitStages[waitCount] = frame->uploadWait.stageMask;
+    waitValues[waitCount++] = frame->uploadWait.value;
+  }
 
-  VkSemaphore drawWaitSemaphores[] = { vulkanContext->semaphores.present }; // which semaphores to wait for
-  VkPipelineStageFlags drawWaitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT }; // what stages of the corresponding semaphores to wait for
-  VkSemaphore drawSignalSemaphores[] = { vulkanContext->semaphores.render }; // which semaphores to signal when completed
+  VkTimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+  timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timelineSubmitInfo.waitSemaphoreValueCount = waitCount;
+  timelineSubmitInfo.pWaitSemaphoreValues = waitValues;
 
   VkSubmitInfo submitInfo{};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.pNext = &timelineSubmitInfo;
   submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &vulkanContext->commandBuffers[swapChainImageIndex];
-  submitInfo.pWaitDstStageMask = drawWaitStages;
-  submitInfo.waitSemaphoreCount = ArrayCount(drawWaitSemaphores);
-  submitInfo.pWaitSemaphores = drawWaitSemaphores; // Ensure that the image has been presented before we modify it
-  submitInfo.signalSemaphoreCount = ArrayCount(drawSignalSemaphores);
-  submitInfo.pSignalSemaphores = drawSignalSemaphores; // signal when the queues work has been completed
+  submitInfo.pCommandBuffers = &frame->commandBuffer;
+  submitInfo.pWaitDstStageMask = waitStages;
+  submitInfo.waitSemaphoreCount = waitCount;
+  submitInfo.pWaitSemaphores = waitSemaphores;
+  submitInfo.signalSemaphoreCount = signalSemaphore != VK_NULL_HANDLE ? 1 : 0;
+  submitInfo.pSignalSemaphores = &signalSemaphore; // signal when the queues work has been completed
+
+  {
+    ProfileScope("vkQueueSubmit");
+    if (vkQueueSubmit(vulkanContext->device.queues.graphics, 1, &submitInfo,
+                      frame->fence /* signaled on completion of all submitted command buffers */
+                      ) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit draw command buffer!");
+    }
+  }
+
+  vulkanContext->frameTimings.submitSeconds = secondsSince(submitStart);
+  vulkanContext->lastImageIndex = swapChainImageIndex;
+}
+
+void endFrame(VulkanContext* vulkanContext)
+{
+  vulkanContext->currentFrame = (vulkanContext->currentFrame + 1) % vulkanContext->frameCount;
+  vulkanContext->frameNumber++;
+}
+
+/*
+ * - Begin the next frame in flight
+ * - Acquire a swap chain image, record and submit the frame against it
+ * - Present, then advance to the next frame in flight
+ */
+void drawFrame(VulkanContext* vulkanContext)
+{
+  ProfileFunction();
+  FrameInFlight* frame = beginFrame(vulkanContext);
+
+  u32 swapChainImageIndex; // index inside swapChain.images
+  {
+    ProfileScope("acquire");
+    TimePoint acquireStart = now();
+    VkResult acquireResult = vkAcquireNextImageKHR(vulkanContext->device.logical,
+                          vulkanContext->swapChain.handle,
+                          UINT64_MAX,
+                          frame->imageAcquiredSemaphore/*get informed when presentation is complete*/,
+                          VK_NULL_HANDLE /*fence signal*/,
+                          &swapChainImageIndex);
+
+    if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR) {
+      recreateSwapChain(vulkanContext);
+      acquireResult = vkAcquireNextImageKHR(
+              vulkanContext->device.logical,
+               vulkanContext->swapChain.handle,
+               UINT64_MAX,
+               frame->imageAcquiredSemaphore/*get informed when presentation is complete*/,
+               VK_NULL_HANDLE /*fence signal*/,
+               &swapChainImageIndex);
+    }
 
-  if (vkQueueSubmit(vulkanContext->device.queues.graphics, 1, &submitInfo,
-                    vulkanContext->commandBufferFences[swapChainImageIndex] /* signaled on completion of all submitted command buffers */
-                    ) != VK_SUCCESS) {
-      throw std::runtime_error("failed to submit draw command buffer!");
+    if (acquireResult != VK_SUCCESS && acquireResult != VK_SUBOPTIMAL_KHR) {
+      throw std::runtime_error("failed to acquire swap chain image!");
+    }
+    vulkanContext->frameTimings.acquireSeconds = secondsSince(acquireStart);
   }
 
-  VkSemaphore presentWaitSemaphores[] = { vulkanContext->semaphores.render };
+  recordAndSubmitFrame(vulkanContext, swapChainImageIndex, frame->imageAcquiredSemaphore, frame->renderFinishedSemaphore);
+
+  VkSemaphore presentWaitSemaphores[] = { frame->renderFinishedSemaphore };
   VkPresentInfoKHR presentInfo{};
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
   presentInfo.waitSemaphoreCount = ArrayCount(presentWaitSemaphores);
@@ -315,7 +1210,15 @@ void drawFrame(VulkanContext* vulkanContext)
   presentInfo.pImageIndices = &swapChainImageIndex;
   presentInfo.pResults = nullptr; // returns a list of results to determine which swap chain may have failed
 
-  VkResult queueResult = vkQueuePresentKHR(vulkanContext->device.queues.present, &presentInfo);
+  VkResult queueResult;
+  {
+    ProfileScope("present");
+    TimePoint presentStart = now();
+    queueResult = vkQueuePresentKHR(vulkanContext->device.queues.present, &presentInfo);
+    vulkanContext->frameTimings.presentSeconds = secondsSince(presentStart);
+  }
+
+  endFrame(vulkanContext);
 
   if (queueResult == VK_ERROR_OUT_OF_DATE_KHR || queueResult == VK_SUBOPTIMAL_KHR) {
     recreateSwapChain(vulkanContext);
@@ -325,80 +1228,225 @@ void drawFrame(VulkanContext* vulkanContext)
 }
 
 /*
- * - Populate a command buffer associated with each of the swap chain framebuffers with the following commands
+ * - Headless equivalent of drawFrame, there is no acquire or present
+ * - Each frame in flight renders into its own offscreen image
+ */
+void drawHeadlessFrame(VulkanContext* vulkanContext)
+{
+  ProfileFunction();
+  beginFrame(vulkanContext);
+  u32 offscreenImageIndex = vulkanContext->currentFrame % vulkanContext->swapChain.imageCount;
+  recordAndSubmitFrame(vulkanContext, offscreenImageIndex, VK_NULL_HANDLE, VK_NULL_HANDLE);
+  endFrame(vulkanContext);
+}
+
+/*
+ * - Bind the quad pipeline with its dynamic state, the geometry store, descriptor sets, push constants and instances
+ * - Must be recorded inside the render pass, draws follow
+ */
+void cmdBindQuadPipelineState(VulkanContext* vulkanContext, VkCommandBuffer commandBuffer, u32 frameIndex) {
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkanContext->graphicsPipeline);
+
+  VkViewport viewport{};
+  viewport.x = 0.0f;
+  viewport.y = 0.0f;
+  viewport.width = (f32)vulkanContext->swapChain.extent.width;
+  viewport.height = (f32)vulkanContext->swapChain.extent.height;
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+  VkRect2D scissor{};
+  scissor.offset = {0, 0};
+  scissor.extent = vulkanContext->swapChain.extent;
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+  if(vulkanContext->device.extendedDynamicState.supported) {
+    vulkanContext->device.extendedDynamicState.vkCmdSetCullMode(commandBuffer, QUAD_CULL_MODE);
+    vulkanContext->device.extendedDynamicState.vkCmdSetFrontFace(commandBuffer, QUAD_FRONT_FACE);
+  }
+
+  // Bind the shared vertex (position and colors) and index buffers, every mesh is drawn from them
+  cmdBindGeometryStore(commandBuffer, vulkanContext->geometryStore, QUAD_VERTEX_INPUT_BINDING_INDEX);
+
+  vkCmdBindDescriptorSets(commandBuffer,
+          VK_PIPELINE_BIND_POINT_GRAPHICS,
+          vulkanContext->pipelineLayout,
+          0,
+          1,
+          &vulkanContext->uniformBuffers.descriptorSet,
+          1,
+          &vulkanContext->frames[frameIndex].transMatsOffset);
+
+  cmdPushConstants(commandBuffer, vulkanContext->pipelineLayout, QUAD_PUSH_CONSTANT_RANGE, vulkanContext->frames[frameIndex].quadPushConstants);
+
+  cmdBindInstanceBuffer(commandBuffer, vulkanContext->instances, INSTANCE_VERTEX_INPUT_BINDING_INDEX);
+}
+
+/*
+ * - Draw the ray marched scene as a full screen triangle, recorded inside the render pass before the quads
+ * - Compute modes composite the frame's ray march target, fragment mode draws RayMarchSphere.frag with the current
+ *   quality's pipeline and the scene pushed as constants
+ */
+void cmdDrawRayMarchScene(VulkanContext* vulkanContext, VkCommandBuffer commandBuffer, u32 frameIndex) {
+  VkExtent2D extent = vulkanContext->swapChain.extent;
+  if(vulkanContext->rayMarchMode != RAY_MARCH_FRAGMENT) {
+    cmdDrawRayMarchComposite(commandBuffer, &vulkanContext->rayMarch, frameIndex, extent);
+    return;
+  }
+
+  RayMarchQuality quality = vulkanContext->rayMarchQuality;
+  VkPipelineLayout pipelineLayout = vulkanContext->rayMarchFragment.pipelineLayouts[quality];
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkanContext->rayMarchFragment.pipelines[quality]);
+
+  VkViewport viewport{};
+  viewport.width = (f32)extent.width;
+  viewport.height = (f32)extent.height;
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  VkRect2D scissor{};
+  scissor.extent = extent;
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+  RayMarchScene scene = vulkanContext->rayMarchScene;
+  scene.resolution = glm::vec2((f32)extent.width, (f32)extent.height);
+  cmdPushConstants(commandBuffer, pipelineLayout, RAY_MARCH_SCENE_PUSH_CONSTANT_RANGE, scene);
+  vkCmdDraw(commandBuffer, 3, 1, 0, 0); // FullScreenTriangle.vert
+}
+
+/*
+ * - Record the quad pass's draw list in slices, one secondary command buffer per recording thread, on the thread pool
+ * - Every instance is drawn as its own object (firstInstance selects its instance data) so that the draw list, and
+ *   the recording cost, grows with the scene
+ * - The first slice draws the ray marched scene first, secondary command buffers execute in slice order
+ * - Each slice binds the quad pipeline state, writes the indirect commands of its objects to its own range of the
+ *   frame's indirect draw buffer and draws that range. Direct draws are recorded instead without drawIndirectFirstInstance.
+ */
+void recordQuadDrawSlices(VulkanContext* vulkanContext, u32 frameIndex, VkFramebuffer framebuffer) {
+  ProfileFunction();
+  VkCommandBufferInheritanceInfo inheritanceInfo{};
+  inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritanceInfo.renderPass = vulkanContext->renderPass;
+  inheritanceInfo.subpass = 0;
+  inheritanceInfo.framebuffer = framebuffer; // optional, may let the driver optimize for the attachments
+  inheritanceInfo.pipelineStatistics = vulkanContext->enablePipelineStatistics ? GPU_PIPELINE_STATISTICS : 0;
+
+  IndirectDrawBuffer* indirectDraws = &vulkanContext->frames[frameIndex].indirectDraws;
+  const GeometryStore& store = vulkanContext->geometryStore;
+  u32 meshIndex = vulkanContext->vertexAtt.meshIndex;
+  const GeometryStoreMesh& mesh = store.meshes[meshIndex];
+  const IndirectDrawSupport& support = vulkanContext->device.indirectDraw;
+  recordSecondaryCommandBuffers(&vulkanContext->parallelRecorder, frameIndex, inheritanceInfo, vulkanContext->instances.count,
+      [&](VkCommandBuffer commandBuffer, u32 slice, u32 firstObject, u32 objectCount) {
+        if (slice == 0 && vulkanContext->rayMarchMode != RAY_MARCH_OFF) {
+          cmdDrawRayMarchScene(vulkanContext, commandBuffer, frameIndex);
+        }
+        cmdBindQuadPipelineState(vulkanContext, commandBuffer, frameIndex);
+        if (support.drawIndirectFirstInstance) {
+          for (u32 object = firstObject; object < firstObject + objectCount; ++object) {
+            writeMeshDraws(indirectDraws, object * mesh.submeshCount, store, meshIndex, 1, object);
+          }
+          cmdDrawIndirectRange(commandBuffer, *indirectDraws, firstObject * mesh.submeshCount, objectCount * mesh.submeshCount, support);
+        } else {
+          for (u32 object = firstObject; object < firstObject + objectCount; ++object) {
+            for (u32 i = 0; i < mesh.submeshCount; ++i) {
+              const MeshFileSubmesh& submesh = store.submeshes[mesh.firstSubmesh + i];
+              vkCmdDrawIndexed(commandBuffer, submesh.indexCount, 1, submesh.firstIndex, submesh.vertexOffset, object);
+            }
+          }
+        }
+      });
+}
+
+/*
+ * - Populate the frame in flight's command buffer with the following commands, targeting the acquired swap chain framebuffer
  *    - Begin command buffer
+ *      - Acquire buffers uploaded since the previous frame
+ *      - Reset the frame's GPU queries, write the starting timestamp and begin pipeline statistics
+ *      - When ray marching in compute, dispatch the ray march passes into the ray march target (see RayMarchPass.h)
  *      - Begin render pass
+ *        - when ray marching, draw the scene underneath the quads (see cmdDrawRayMarchScene)
  *        - bind pipeline
- *        - bind vertex attribute buffer
- *        - bind index buffer
- *        - draw
+ *        - set dynamic state (viewport, scissor and, if supported, cull mode & front face)
+ *        - bind the geometry store's vertex and index buffers
+ *        - bind the uniform buffer descriptor set at the frame's dynamic offset
+ *        - push per draw constants
+ *        - write the frame's indirect commands, one per submesh, and draw them all with one indirect draw, followed by a timestamp
  *      - End render pass
+ *      - Or, when recording in parallel, execute the secondary command buffers recorded by recordQuadDrawSlices within the render pass
+ *      - End pipeline statistics and write the final timestamp
  *    - End command buffer
+ * NOTE: The graphics command pool is created with VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, so beginning
+ *  the command buffer implicitly resets it
  */
-void populateCommandBuffers(VulkanContext* vulkanContext) {
-  // command buffer recording
-  for (u32 i = 0; i < vulkanContext->commandBufferCount; ++i) {
-    VkCommandBufferBeginInfo commandBufferBeginInfo{};
-    commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    commandBufferBeginInfo.flags = 0;
-    commandBufferBeginInfo.pInheritanceInfo = nullptr;
-
-    if (vkBeginCommandBuffer(vulkanContext->commandBuffers[i], &commandBufferBeginInfo) != VK_SUCCESS) {
-      throw std::runtime_error("failed to begin recording command buffer!");
-    }
-
-    VkRenderPassBeginInfo renderPassBeginInfo{};
-    renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassBeginInfo.renderPass = vulkanContext->renderPass;
-    renderPassBeginInfo.framebuffer = vulkanContext->swapChain.framebuffers[i];
-    renderPassBeginInfo.renderArea.offset = {0, 0};
-    renderPassBeginInfo.renderArea.extent = vulkanContext->swapChain.extent;
-
-    VkClearValue clearValue;
-    clearValue.color = {0.0f, 0.0f, 0.0f, 1.0f};
-    // NOTE: clear value is a union that may also be used as... clearValue.depthStencil = {1.0f, 0.0f}
-    renderPassBeginInfo.clearValueCount = 1; // we can have a clear value for each attachment
-    renderPassBeginInfo.pClearValues = &clearValue;
-
-    vkCmdBeginRenderPass(vulkanContext->commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-    {
-      vkCmdBindPipeline(vulkanContext->commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, vulkanContext->graphicsPipeline);
-
-      // Bind triangle vertex buffer (contains position and colors)
-      vkCmdBindVertexBuffers(vulkanContext->commandBuffers[i],
-                             QUAD_VERTEX_INPUT_BINDING_INDEX/*First binding index as described by VkVertexInputBindingDescription.binding*/,
-                             1 /*Vertex buffer count*/,
-                             &vulkanContext->vertexAtt.buffer /*Vertex buffer array*/,
-                             &vulkanContext->vertexAtt.bufferOffset /*offset of vertex attributes in the associated buffers*/);
-
-      // Bind triangle index buffer
-      vkCmdBindIndexBuffer(vulkanContext->commandBuffers[i],
-                           vulkanContext->vertexAtt.buffer,
-                           quadPosColVertexAtt.sizeInBytes, // offset in buffer
-                           VK_INDEX_TYPE_UINT32);
-
-      vkCmdBindDescriptorSets(vulkanContext->commandBuffers[i],
-              VK_PIPELINE_BIND_POINT_GRAPHICS,
-              vulkanContext->pipelineLayout,
-              0,
-              1,
-              &vulkanContext->uniformBuffers.descriptorSets[i],
-              0,
-              nullptr);
-
-      // Draw indexed triangle
-      vkCmdDrawIndexed(vulkanContext->commandBuffers[i],
-              quadPosColVertexAtt.indices.count,
-              1,
-              0,
-              0,
-              1);
-    }
-    vkCmdEndRenderPass(vulkanContext->commandBuffers[i]);
-
-    if (vkEndCommandBuffer(vulkanContext->commandBuffers[i]) != VK_SUCCESS) {
-      throw std::runtime_error("failed to record command buffer!");
+void populateCommandBuffer(VulkanContext* vulkanContext, u32 frameIndex, u32 swapChainImageIndex) {
+  ProfileFunction();
+  VkCommandBuffer commandBuffer = vulkanContext->frames[frameIndex].commandBuffer;
+
+  VkCommandBufferBeginInfo commandBufferBeginInfo{};
+  commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  commandBufferBeginInfo.pInheritanceInfo = nullptr;
+
+  if (vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("failed to begin recording command buffer!");
+  }
+
+  vulkanContext->frames[frameIndex].uploadWait = cmdAcquireUploads(&vulkanContext->uploadQueue, commandBuffer);
+
+  GpuQueries* gpuQueries = &vulkanContext->gpuQueries;
+  cmdResetGpuQueries(commandBuffer, gpuQueries, frameIndex, vulkanContext->frameNumber);
+  cmdWriteGpuTimestamp(commandBuffer, gpuQueries, frameIndex, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, "frame start");
+  cmdBeginGpuPipelineStatistics(commandBuffer, gpuQueries, frameIndex);
+  bool32 rayMarching = vulkanContext->rayMarchMode != RAY_MARCH_OFF;
+  if(isComputeRayMarch(vulkanContext->rayMarchMode)) {
+    // NOTE: Before recording any slices, the frame's descriptor set may be updated
+    cmdRayMarch(commandBuffer, vulkanContext->device.logical, &vulkanContext->rayMarch, frameIndex, vulkanContext->frameNumber,
+                vulkanContext->swapChain.rayMarchTarget, vulkanContext->rayMarchScene, gpuQueries);
+  }
+
+  VkRenderPassBeginInfo renderPassBeginInfo{};
+  renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  renderPassBeginInfo.renderPass = vulkanContext->renderPass;
+  renderPassBeginInfo.framebuffer = vulkanContext->swapChain.framebuffers[swapChainImageIndex];
+  renderPassBeginInfo.renderArea.offset = {0, 0};
+  renderPassBeginInfo.renderArea.extent = vulkanContext->swapChain.extent;
+
+  VkClearValue clearValue;
+  clearValue.color = {0.0f, 0.0f, 0.0f, 1.0f};
+  // NOTE: clear value is a union that may also be used as... clearValue.depthStencil = {1.0f, 0.0f}
+  renderPassBeginInfo.clearValueCount = 1; // we can have a clear value for each attachment
+  renderPassBeginInfo.pClearValues = &clearValue;
+
+  if(vulkanContext->recordingThreadCount > 0) {
+    recordQuadDrawSlices(vulkanContext, frameIndex, renderPassBeginInfo.framebuffer);
+    // NOTE: Nothing but vkCmdExecuteCommands may be recorded in a subpass with secondary command buffer contents,
+    //  so there is no "quad pipeline" timestamp
+    vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    cmdExecuteSecondaryCommandBuffers(commandBuffer, &vulkanContext->parallelRecorder, frameIndex);
+    vkCmdEndRenderPass(commandBuffer);
+  } else {
+    vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    if(rayMarching) {
+      cmdDrawRayMarchScene(vulkanContext, commandBuffer, frameIndex);
     }
+    cmdBindQuadPipelineState(vulkanContext, commandBuffer, frameIndex);
+
+    // Draw indexed triangles, one indirect command per submesh covering every instance
+    IndirectDrawBuffer* indirectDraws = &vulkanContext->frames[frameIndex].indirectDraws;
+    resetIndirectDraws(indirectDraws);
+    pushMeshDraws(indirectDraws, vulkanContext->geometryStore, vulkanContext->vertexAtt.meshIndex, vulkanContext->instances.count, 0);
+    cmdDrawIndirect(commandBuffer, *indirectDraws, vulkanContext->device.indirectDraw);
+    cmdWriteGpuTimestamp(commandBuffer, gpuQueries, frameIndex, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, "quad pipeline");
+    vkCmdEndRenderPass(commandBuffer);
+  }
+
+  cmdEndGpuPipelineStatistics(commandBuffer, gpuQueries, frameIndex);
+  cmdWriteGpuTimestamp(commandBuffer, gpuQueries, frameIndex, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, "render pass end");
+
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record command buffer!");
   }
 }
 
@@ -408,10 +1456,16 @@ void populateCommandBuffers(VulkanContext* vulkanContext) {
  *    - Specify extensions (swap chain extension, in our case)
  *    - Specify layers (debug validation layer, in our case)
  *    - Create and specify queues that will be needed using the queue family indices stored when picking the physical device
+ *    - Optionally enable the extended dynamic state extension & feature
+ *    - Headless devices don't enable the swap chain extension
+ *    - Optionally enable the pipeline statistics query feature, and inherited queries for secondary command buffers
+ *    - Enable timeline semaphores (Vulkan 1.2 core), used to signal upload completion to the graphics queue
+ *    - Enable the supported indirect draw features: multi draw indirect, non zero first instance and the draw indirect count extension
  */
-void initLogicalDeviceAndQueues(VkDevice* logicalDevice, VkPhysicalDevice* physicalDevice, QueueFamilyIndices* queueFamilyIndices) {
+void initLogicalDeviceAndQueues(VkDevice* logicalDevice, VkPhysicalDevice* physicalDevice, QueueFamilyIndices* queueFamilyIndices, bool32 enableExtendedDynamicState, bool32 enablePipelineStatistics, bool32 enableInheritedQueries, const IndirectDrawSupport& indirectDraw, bool32 headless) {
+    ProfileFunction();
     const f32 queuePriority = 1.0f;
-    VkDeviceQueueCreateInfo queueCIs[2];
+    VkDeviceQueueCreateInfo queueCIs[4];
 
     u32 uniqueQueuesCount = 1;
     VkDeviceQueueCreateInfo graphicsQueueCI{};
@@ -434,14 +1488,45 @@ void initLogicalDeviceAndQueues(VkDevice* logicalDevice, VkPhysicalDevice* physi
       queueCIs[uniqueQueuesCount++] = transferQueueCI;
     }
 
+    if(queueFamilyIndices->compute != queueFamilyIndices->graphics &&
+       queueFamilyIndices->compute != queueFamilyIndices->present &&
+       queueFamilyIndices->compute != queueFamilyIndices->transfer) {
+      VkDeviceQueueCreateInfo computeQueueCI = graphicsQueueCI;
+      computeQueueCI.queueFamilyIndex = queueFamilyIndices->compute;
+      queueCIs[uniqueQueuesCount++] = computeQueueCI;
+    }
+
     VkDeviceCreateInfo deviceCI{};
     deviceCI.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     deviceCI.pQueueCreateInfos = queueCIs;
     deviceCI.queueCreateInfoCount = uniqueQueuesCount;
     VkPhysicalDeviceFeatures deviceFeatures{};
+    deviceFeatures.pipelineStatisticsQuery = enablePipelineStatistics ? VK_TRUE : VK_FALSE;
+    deviceFeatures.inheritedQueries = enableInheritedQueries ? VK_TRUE : VK_FALSE;
+    deviceFeatures.multiDrawIndirect = indirectDraw.multiDrawIndirect ? VK_TRUE : VK_FALSE;
+    deviceFeatures.drawIndirectFirstInstance = indirectDraw.drawIndirectFirstInstance ? VK_TRUE : VK_FALSE;
     deviceCI.pEnabledFeatures = &deviceFeatures;
-    deviceCI.enabledExtensionCount = ArrayCount(DEVICE_EXTENSIONS);
-    deviceCI.ppEnabledExtensionNames = DEVICE_EXTENSIONS;
+
+    std::vector<const char*> extensions;
+    if(!headless) {
+      extensions.insert(extensions.end(), DEVICE_EXTENSIONS, DEVICE_EXTENSIONS + ArrayCount(DEVICE_EXTENSIONS));
+    }
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures{};
+    timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+    deviceCI.pNext = &timelineSemaphoreFeatures;
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{};
+    extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    if(enableExtendedDynamicState) {
+      extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+      extendedDynamicStateFeatures.extendedDynamicState = VK_TRUE;
+      timelineSemaphoreFeatures.pNext = &extendedDynamicStateFeatures;
+    }
+    if(indirectDraw.drawIndirectCount) {
+      extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
+    deviceCI.enabledExtensionCount = (u32)extensions.size();
+    deviceCI.ppEnabledExtensionNames = extensions.empty() ? nullptr : extensions.data();
     deviceCI.enabledLayerCount = enableValidationLayers ? ArrayCount(VALIDATION_LAYERS) : 0;
     deviceCI.ppEnabledLayerNames = VALIDATION_LAYERS;
 
@@ -454,6 +1539,7 @@ void initLogicalDeviceAndQueues(VkDevice* logicalDevice, VkPhysicalDevice* physi
  * Get surface using GLFW and instance
  */
 void initSurface(GLFWwindow* window, VkInstance* instance, VkSurfaceKHR* surface) {
+    ProfileFunction();
     if (glfwCreateWindowSurface(*instance, window, nullptr, surface) != VK_SUCCESS) {
         throw std::runtime_error("failed to create window surface!");
     }
@@ -467,6 +1553,7 @@ void framebuffer_size_callback(GLFWwindow* window, s32 width, s32 height)
 }
 
 void initGLFW(GLFWwindow** window, VulkanContext* vulkanContext) {
+  ProfileFunction();
   glfwInit();
   glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API); // We don't want an OpenGL context on creation
   glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
@@ -521,9 +1608,12 @@ bool32 checkPhysicalDeviceSwapChainSupport(VkPhysicalDevice* physicalDevice, VkS
  *    - specify that we want single images and not array images
  *    - specify that we are going to only use the images as color attachments
  *    - specify if our images will be used by multiple queues (depends if our graphics queue is the same as our present queue)
+ *    - specify the swap chain being replaced, if any, so its resources may be reused by the presentation engine
  *  - Swap chain images are created alongside the swap chain
+ *  - See initOffscreenImages for the headless equivalent
  */
-void initSwapChain(VulkanContext* vulkanContext, QueueFamilyIndices queueFamilyIndices) {
+void initSwapChain(VulkanContext* vulkanContext, QueueFamilyIndices queueFamilyIndices, VkSwapchainKHR oldSwapChain) {
+    ProfileFunction();
     VkSurfaceCapabilitiesKHR surfaceCapabilities;
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vulkanContext->device.physical, vulkanContext->surface, &surfaceCapabilities);
 
@@ -597,8 +1687,9 @@ void initSwapChain(VulkanContext* vulkanContext, QueueFamilyIndices queueFamilyI
     swapChainCI.preTransform = surfaceCapabilities.currentTransform;
     swapChainCI.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR; // ignore blending with other windows on the system
     swapChainCI.presentMode = selectedPresentMode;
+    vulkanContext->swapChain.presentMode = selectedPresentMode;
     swapChainCI.clipped = VK_TRUE; // ignore pixels obscured by other windows
-    swapChainCI.oldSwapchain = VK_NULL_HANDLE; // used in the event that our swap chain needs to be recreated at runtime
+    swapChainCI.oldSwapchain = oldSwapChain; // used in the event that our swap chain needs to be recreated at runtime
 
     if (vkCreateSwapchainKHR(vulkanContext->device.logical, &swapChainCI, nullAllocator, &vulkanContext->swapChain.handle) != VK_SUCCESS) {
         throw std::runtime_error("failed to create swap chain!");
@@ -607,21 +1698,184 @@ void initSwapChain(VulkanContext* vulkanContext, QueueFamilyIndices queueFamilyI
     vkGetSwapchainImagesKHR(vulkanContext->device.logical, vulkanContext->swapChain.handle, &vulkanContext->swapChain.imageCount, nullptr);
     vulkanContext->swapChain.images = new VkImage[vulkanContext->swapChain.imageCount];
     vkGetSwapchainImagesKHR(vulkanContext->device.logical, vulkanContext->swapChain.handle, &vulkanContext->swapChain.imageCount, vulkanContext->swapChain.images);
+    vulkanContext->swapChain.imageMemory = nullptr;
 
     delete[] surfaceFormats;
     delete[] presentModes;
 }
 
+// Sized to the swap chain's extent, left null unless ray marching in compute
+void initSwapChainRayMarchTarget(VulkanContext* vulkanContext) {
+  vulkanContext->swapChain.rayMarchTarget = {};
+  if(isComputeRayMarch(vulkanContext->rayMarchMode)) {
+    initRayMarchTarget(vulkanContext->device.logical, &vulkanContext->memoryAllocator, vulkanContext->swapChain.extent,
+                       &vulkanContext->swapChain.rayMarchTarget);
+  }
+}
+
+/*
+ * - Headless alternative to initSwapChain, fills VulkanContext.swapChain with offscreen images
+ * - Create a device local image per frame in flight with the window extent and swap chain format
+ * - Images are used as color attachments and transfer sources, so that the final frame may be read back
+ */
+void initOffscreenImages(VulkanContext* vulkanContext) {
+  ProfileFunction();
+  VkDevice device = vulkanContext->device.logical;
+  SwapChain* swapChain = &vulkanContext->swapChain;
+  swapChain->handle = VK_NULL_HANDLE;
+  swapChain->format = SWAP_CHAIN_IMAGE_FORMAT;
+  swapChain->extent = vulkanContext->windowExtent;
+  swapChain->presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR; // unused, nothing is presented
+  swapChain->imageCount = vulkanContext->frameCount;
+  swapChain->images = new VkImage[swapChain->imageCount];
+  swapChain->imageMemory = new GpuAllocation[swapChain->imageCount];
+
+  VkImageCreateInfo imageCI{};
+  imageCI.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageCI.imageType = VK_IMAGE_TYPE_2D;
+  imageCI.format = swapChain->format;
+  imageCI.extent = { swapChain->extent.width, swapChain->extent.height, 1 };
+  imageCI.mipLevels = 1;
+  imageCI.arrayLayers = 1;
+  imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageCI.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  for(u32 i = 0; i < swapChain->imageCount; ++i) {
+    if (vkCreateImage(device, &imageCI, nullAllocator, &swapChain->images[i]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create offscreen image!");
+    }
+    swapChain->imageMemory[i] = allocateImageMemory(&vulkanContext->memoryAllocator, swapChain->images[i], imageCI.tiling, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  }
+}
+
+/*
+ * - Copy a headless offscreen image into a host visible buffer
+ *    - The render pass has already transitioned the image to VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+ * - Write it to disk as a binary PPM, swizzling the swap chain's BGRA format to RGB
+ * NOTE: Expects the device to be idle
+ */
+void writeOffscreenImage(VulkanContext* vulkanContext, u32 imageIndex, const char* filePath) {
+  ProfileFunction();
+  VkDevice device = vulkanContext->device.logical;
+  VkExtent2D extent = vulkanContext->swapChain.extent;
+  const u32 bytesPerPixel = 4;
+  VkDeviceSize readbackSize = (VkDeviceSize)extent.width * extent.height * bytesPerPixel;
+
+  VkBuffer readbackBuffer = createBuffer(device, readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+  GpuAllocation readbackMemory = allocateBufferMemory(&vulkanContext->memoryAllocator, readbackBuffer,
+                                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
+  commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = vulkanContext->graphicsCommandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+
+  VkCommandBuffer readbackCommandBuffer;
+  vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &readbackCommandBuffer);
+
+  VkCommandBufferBeginInfo commandBufferBeginInfo{};
+  commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+  if (vkBeginCommandBuffer(readbackCommandBuffer, &commandBufferBeginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("failed to begin recording command buffer for offscreen image readback!");
+  }
+    // Make the render pass' color attachment writes visible to the transfer
+    VkImageMemoryBarrier imageBarrier{};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = vulkanContext->swapChain.images[imageIndex];
+    imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    vkCmdPipelineBarrier(readbackCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+    VkBufferImageCopy copyRegion{};
+    copyRegion.bufferOffset = 0;
+    copyRegion.bufferRowLength = 0; // tightly packed
+    copyRegion.bufferImageHeight = 0;
+    copyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    copyRegion.imageOffset = { 0, 0, 0 };
+    copyRegion.imageExtent = { extent.width, extent.height, 1 };
+    vkCmdCopyImageToBuffer(readbackCommandBuffer, vulkanContext->swapChain.images[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &copyRegion);
+
+    // Make the transfer writes visible to the host
+    VkBufferMemoryBarrier bufferBarrier{};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = readbackBuffer;
+    bufferBarrier.offset = 0;
+    bufferBarrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(readbackCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         0, nullptr, 1, &bufferBarrier, 0, nullptr);
+  vkEndCommandBuffer(readbackCommandBuffer);
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &readbackCommandBuffer;
+
+  VkFenceCreateInfo readbackFenceCI{};
+  readbackFenceCI.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  VkFence readbackFence;
+  vkCreateFence(device, &readbackFenceCI, nullAllocator, &readbackFence);
+
+  vkQueueSubmit(vulkanContext->device.queues.graphics, 1, &submitInfo, readbackFence);
+  vkWaitForFences(device, 1, &readbackFence, VK_TRUE, DEFAULT_FENCE_TIMEOUT);
+
+  vkDestroyFence(device, readbackFence, nullAllocator);
+  vkFreeCommandBuffers(device, vulkanContext->graphicsCommandPool, 1, &readbackCommandBuffer);
+
+  std::ofstream file(filePath, std::ios::binary);
+  if (!file.is_open()) {
+    vkDestroyBuffer(device, readbackBuffer, nullAllocator);
+    freeGpuMemory(&vulkanContext->memoryAllocator, &readbackMemory);
+    throw std::runtime_error(std::string("failed to open file for writing:") + filePath);
+  }
+
+  // readback memory is persistently mapped by the allocator
+  u8* pixels = readbackMemory.mapped;
+  file << "P6\n" << extent.width << " " << extent.height << "\n255\n";
+  u8* row = new u8[extent.width * 3];
+  for (u32 y = 0; y < extent.height; ++y) {
+    u8* srcPixel = pixels + ((VkDeviceSize)y * extent.width * bytesPerPixel);
+    for (u32 x = 0; x < extent.width; ++x, srcPixel += bytesPerPixel) {
+      row[x * 3 + 0] = srcPixel[2]; // R
+      row[x * 3 + 1] = srcPixel[1]; // G
+      row[x * 3 + 2] = srcPixel[0]; // B
+    }
+    file.write((const char*)row, extent.width * 3);
+  }
+  delete[] row;
+  file.close();
+
+  vkDestroyBuffer(device, readbackBuffer, nullAllocator);
+  freeGpuMemory(&vulkanContext->memoryAllocator, &readbackMemory);
+}
+
 /*
  * Use vulkan instance to find a pick a physical device (actual components in computer that can run Vulkan API)
  *    - Devices are picked on qualities such as:
- *      - Being a discrete GPU
+ *      - Being a discrete GPU (preferred, but integrated GPUs and software implementations such as lavapipe are accepted)
  *      - Containing graphics, present, and transfer queues
- *      - Supports our desired extensions
- *      - Swap chain supports some color format can can present to our surface
+ *      - Supports our desired extensions (not required when headless)
+ *      - Swap chain supports some color format can can present to our surface (not required when headless)
+ *      - Supports timeline semaphores
  * Also sets the queue family indices associated with the physical device
  */
 void pickPhysicalDevice(VulkanContext* vulkanContext) {
+    ProfileFunction();
     VkInstance vulkanInstance = vulkanContext->instance;
     VkSurfaceKHR surface = vulkanContext->surface;
 
@@ -647,14 +1901,15 @@ void pickPhysicalDevice(VulkanContext* vulkanContext) {
 
 
         // NOTE: Can use a more complex device selection if needed
-        bool32 isDeviceSuitable = deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU
-            && findQueueFamilies(surface, physicalDevices[i], &queueFamilyIndices)
-            && checkPhysicalDeviceExtensionSupport(&potentialDevice)
-            && checkPhysicalDeviceSwapChainSupport(&potentialDevice, &surface);
+        bool32 isDeviceSuitable = findQueueFamilies(surface, physicalDevices[i], &queueFamilyIndices)
+            && isTimelineSemaphoreSupported(potentialDevice)
+            && (vulkanContext->headless || (checkPhysicalDeviceExtensionSupport(&potentialDevice)
+                                            && checkPhysicalDeviceSwapChainSupport(&potentialDevice, &surface)));
+        bool32 isDiscrete = deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU;
 
-        if(isDeviceSuitable){
+        if(isDeviceSuitable && (isDiscrete || vulkanContext->device.physical == VK_NULL_HANDLE)) {
             vulkanContext->device.physical = physicalDevices[i];
-            break;
+            if(isDiscrete) { break; }
         }
     }
 
@@ -662,176 +1917,164 @@ void pickPhysicalDevice(VulkanContext* vulkanContext) {
         throw std::runtime_error("failed to find a suitable GPU!");
     }
 
+    vkGetPhysicalDeviceProperties(vulkanContext->device.physical, &deviceProperties);
+
     vkGetPhysicalDeviceMemoryProperties(vulkanContext->device.physical, &vulkanContext->device.memoryProperties);
     vulkanContext->device.minUniformBufferOffsetAlignment = deviceProperties.limits.minUniformBufferOffsetAlignment;
 
-    delete[] physicalDevices;
-}
-
-// This function is used to request a device memory type that supports all the property flags we request (e.g. device local, host visible)
-// Upon success it will return the index of the memory type that fits our requested memory properties
-// This is necessary as implementations can offer an arbitrary number of memory types with different
-// memory properties.
-// You can check http://vulkan.gpuinfo.org/ for details on different memory configurations
-u32 getMemoryTypeIndex(VkPhysicalDeviceMemoryProperties const* deviceMemoryProperties, u32 memoryTypeBits, VkMemoryPropertyFlags properties)
-{
-    // Iterate over all memory types available for the device used in this example
-    for (u32 i = 0; i < deviceMemoryProperties->memoryTypeCount; i++)
-    {
-        // memoryTypeBits is a bitmask and contains one bit set for every supported memory type for the resource.
-        // Bit i is set if and only if the memory type i in the VkPhysicalDeviceMemoryProperties structure for
-        // the physical device is supported for the resource.
-        if ((memoryTypeBits & (1 << i)) != 0)
-        {
-            if ((deviceMemoryProperties->memoryTypes[i].propertyFlags & properties) == properties)
-            {
-                return i;
-            }
-        }
+    vkGetPhysicalDeviceFeatures(vulkanContext->device.physical, &deviceFeatures);
+    vulkanContext->device.pipelineStatisticsQuerySupported = deviceFeatures.pipelineStatisticsQuery;
+    vulkanContext->device.inheritedQueriesSupported = deviceFeatures.inheritedQueries;
+
+    IndirectDrawSupport* indirectDraw = &vulkanContext->device.indirectDraw;
+    *indirectDraw = {};
+    indirectDraw->multiDrawIndirect = deviceFeatures.multiDrawIndirect;
+    indirectDraw->drawIndirectFirstInstance = deviceFeatures.drawIndirectFirstInstance;
+    indirectDraw->maxDrawIndirectCount = deviceFeatures.multiDrawIndirect ? deviceProperties.limits.maxDrawIndirectCount : 1;
+    indirectDraw->drawIndirectCount = isDeviceExtensionSupported(vulkanContext->device.physical, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+    vulkanContext->device.extendedDynamicState = {};
+    if(isDeviceExtensionSupported(vulkanContext->device.physical, VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME)) {
+      VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{};
+      extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+      VkPhysicalDeviceFeatures2 deviceFeatures2{};
+      deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+      deviceFeatures2.pNext = &extendedDynamicStateFeatures;
+      vkGetPhysicalDeviceFeatures2(vulkanContext->device.physical, &deviceFeatures2);
+      vulkanContext->device.extendedDynamicState.supported = extendedDynamicStateFeatures.extendedDynamicState;
     }
 
-    throw "Could not find a suitable memory type!";
+    delete[] physicalDevices;
 }
 
 /*
- * - Prepare vertex and index buffers for an indexed triangle list
- * - Transfer vertex and index buffers from host visible memory to device local memory
+ * - Add an indexed triangle list, drawn as one or more submeshes, to the geometry store shared by every mesh
+ * - The store is created by the first mesh with its vertex layout and index type, sized for the meshes loaded at startup
+ *   (only the one drawn for now) rather than a fixed headroom, the quad alone would otherwise reserve tens of MB
+ * - Upload vertex and index data to device local memory on the transfer queue, the first frame waits for completion
  * - Initialize vertex input and attribute binding to match the vertex shader
- * - TODO: pass in index data as well
  */
-void prepareVertexAttributeMemory(VulkanContext* vulkanContext, VertexAtt vertexAtt)
+void prepareVertexAttributeMemory(VulkanContext* vulkanContext, VertexAtt vertexAtt, const MeshFileSubmesh* submeshes, u32 submeshCount)
 {
+    ProfileFunction();
     vulkanContext->vertexAtt.info = vertexAtt;
-    vulkanContext->vertexAtt.verticesOffset = 0;
-    vulkanContext->vertexAtt.indicesOffset = vertexAtt.sizeInBytes;
-
-    VkDevice device = vulkanContext->device.logical;
 
     // Note: On memory management in Vulkan in general:
-    //  This is a very complex topic and while it's fine for an example application to use small individual memory allocations, that is not
-    //  what should be done in a real-world application, where you should allocate large chunks of memory at once instead. From that point
-    //  we should ideally create one large buffer and offsets within that buffer pointing to our data. Although additional buffers
-    //  may be used as needed.
+    //  Individual vkAllocateMemory calls per resource are slow and bounded by maxMemoryAllocationCount, so memory is
+    //  sub-allocated from large blocks by the GpuMemoryAllocator. The geometry store goes one step further and packs
+    //  every mesh in one vertex and one index buffer, so a pass binds them once and draws every mesh indirectly.
 
     // Note: Static data like vertex and index buffer should be stored on the device memory
     //  for optimal (and fastest) access by the GPU
 
-    // To achieve the transfer onto device memory we use "staging buffers":
-    // - Create a buffer that's visible to the host (and can be mapped)
-    // - Copy the data to this buffer
-    // - Create another buffer that's local on the device (VRAM) with the same size
-    // - Copy the data from the host to the device using a command buffer
-    // - Delete the host visible (staging) buffer
-    // - Use the device local buffers for rendering
-
-    u32 totalBufferSize = vertexAtt.sizeInBytes + vertexAtt.indices.sizeInBytes;
-
-    // Create a host-visible buffer to copy the vertex data to (staging buffer)
-    VkBufferCreateInfo hostVisibleVertexBufferInfo = {};
-    hostVisibleVertexBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    hostVisibleVertexBufferInfo.size = totalBufferSize;
-    hostVisibleVertexBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT; // Buffer is used as the copy source
-
-    VkBuffer hostVisibleVertexBuffer;
-    vkCreateBuffer(device, &hostVisibleVertexBufferInfo, nullAllocator, &hostVisibleVertexBuffer);
-
-    VkMemoryRequirements hostVisisbleVertexAttBufferMemReqs;
-    vkGetBufferMemoryRequirements(device, hostVisibleVertexBuffer, &hostVisisbleVertexAttBufferMemReqs);
-
-    VkMemoryAllocateInfo vertexAttBufferMemAllocInfo = {};
-    vertexAttBufferMemAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    vertexAttBufferMemAllocInfo.allocationSize = hostVisisbleVertexAttBufferMemReqs.size;
-    vertexAttBufferMemAllocInfo.memoryTypeIndex = getMemoryTypeIndex(&vulkanContext->device.memoryProperties, hostVisisbleVertexAttBufferMemReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    VkDeviceMemory hostVisibleVertexMemory;
-    vkAllocateMemory(device, &vertexAttBufferMemAllocInfo, nullAllocator, &hostVisibleVertexMemory);
-    vkBindBufferMemory(device, hostVisibleVertexBuffer, hostVisibleVertexMemory, 0/*memory offset*/);
-
-    // Map staging memory and copy to staging buffer
-    char* hostVisibleMemoryCopyPtr;
-    vkMapMemory(device, hostVisibleVertexMemory, vulkanContext->vertexAtt.verticesOffset, vertexAttBufferMemAllocInfo.allocationSize, 0/*flags*/, (void**)&hostVisibleMemoryCopyPtr);
-      memcpy(hostVisibleMemoryCopyPtr, vertexAtt.data, vertexAtt.sizeInBytes); // copy over vertex attribute data
-      memcpy(hostVisibleMemoryCopyPtr + vulkanContext->vertexAtt.indicesOffset, vertexAtt.indices.data, vertexAtt.indices.sizeInBytes); // copy over index data
-      hostVisibleMemoryCopyPtr = nullptr;
-    vkUnmapMemory(device, hostVisibleVertexMemory);
-
-    // Create destination buffer with device only visibility
-    VkBufferCreateInfo deviceLocalVertexBufferInfo = {};
-    deviceLocalVertexBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    deviceLocalVertexBufferInfo.size = totalBufferSize;
-    deviceLocalVertexBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT; // device local buffer to be used for rendering
-
-    vkCreateBuffer(device, &deviceLocalVertexBufferInfo, nullAllocator, &vulkanContext->vertexAtt.buffer);
-    vulkanContext->vertexAtt.bufferOffset = 0;
-    VkMemoryRequirements deviceLocalVertexAttBufferMemReqs;
-    vkGetBufferMemoryRequirements(device, vulkanContext->vertexAtt.buffer, &deviceLocalVertexAttBufferMemReqs);
-    vertexAttBufferMemAllocInfo.allocationSize = deviceLocalVertexAttBufferMemReqs.size;
-    vertexAttBufferMemAllocInfo.memoryTypeIndex = getMemoryTypeIndex(&vulkanContext->device.memoryProperties, deviceLocalVertexAttBufferMemReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    vkAllocateMemory(device, &vertexAttBufferMemAllocInfo, nullAllocator, &vulkanContext->vertexAtt.memory);
-    vkBindBufferMemory(device, vulkanContext->vertexAtt.buffer, vulkanContext->vertexAtt.memory, 0);
-
-    // Buffer copies have to be submitted to a queue, so we need a command buffer
-    VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
-    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    commandBufferAllocateInfo.commandPool = vulkanContext->transferCommandPool;
-    commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    commandBufferAllocateInfo.commandBufferCount = 1;
-
-    VkCommandBuffer copyCommandBuffer;
-    vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &copyCommandBuffer);
-
-    VkCommandBufferBeginInfo commandBufferBeginInfo{};
-    commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    commandBufferBeginInfo.flags = 0;
-    commandBufferBeginInfo.pInheritanceInfo = nullptr;
-
-    if (vkBeginCommandBuffer(copyCommandBuffer, &commandBufferBeginInfo) != VK_SUCCESS) {
-        throw std::runtime_error("failed to begin recording command buffer for staging vertex/index buffers !");
-    }
-      // Put buffer region copies into command buffer
-      VkBufferCopy copyRegion;
-      copyRegion.srcOffset = 0;
-      copyRegion.dstOffset = 0;
-      // Vertex buffer
-      copyRegion.size = totalBufferSize;
-      vkCmdCopyBuffer(copyCommandBuffer, hostVisibleVertexBuffer, vulkanContext->vertexAtt.buffer, 1/* region count */, &copyRegion);
-    vkEndCommandBuffer(copyCommandBuffer);
-
-    VkSubmitInfo copyCommandSubmitInfo = {};
-    copyCommandSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    copyCommandSubmitInfo.commandBufferCount = 1;
-    copyCommandSubmitInfo.pCommandBuffers = &copyCommandBuffer;
-
-    // Create fence to wait for transfer to complete
-    VkFenceCreateInfo copyFenceCreateInfo = {};
-    copyFenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    copyFenceCreateInfo.flags = 0;
-
-    VkFence copyFence;
-    vkCreateFence(device, &copyFenceCreateInfo, nullAllocator, &copyFence);
-
-    // Submit to the queue
-    vkQueueSubmit(vulkanContext->device.queues.present, 1, &copyCommandSubmitInfo, copyFence);
-    // Wait for the fence to signal that command buffer has finished executing
-    vkWaitForFences(device, 1, &copyFence, VK_TRUE, DEFAULT_FENCE_TIMEOUT);
-
-    vkDestroyFence(device, copyFence, nullAllocator);
-    vkFreeCommandBuffers(device, vulkanContext->transferCommandPool, 1, &copyCommandBuffer);
-
-    // Destroy staging buffers
-    // Note: Staging buffer must not be deleted before the copies have been submitted and executed
-    vkDestroyBuffer(device, hostVisibleVertexBuffer, nullAllocator);
-    vkFreeMemory(device, hostVisibleVertexMemory, nullAllocator);
+    // The UploadQueue copies the data through its persistently mapped staging ring on the transfer queue. Nothing waits on
+    //  the copies here, the first frame's submit waits on the upload's timeline semaphore value instead.
+
+    GeometryStore* store = &vulkanContext->geometryStore;
+    if(store->vertexBuffer == VK_NULL_HANDLE) {
+      u32 vertexCount = vertexAtt.sizeInBytes / vertexAtt.strideInBytes;
+      initGeometryStore(vulkanContext->device.logical, &vulkanContext->memoryAllocator, vertexAtt.strideInBytes, vertexAtt.indices.type,
+                        vertexCount, vertexAtt.indices.count, store);
+    }
+    vulkanContext->vertexAtt.meshIndex = addMesh(&vulkanContext->uploadQueue, store, vertexAtt, submeshes, submeshCount);
+    submitUploads(&vulkanContext->uploadQueue);
 }
 
 /*
- * - Create semaphores to wait between queue commands & command buffers
- * - Create fences that will be used to wait for completion of submitted command buffers
+ * - Draw the mesh file when one was given, otherwise the quad
+ * - Mesh data is copied straight from the file mapping into staging memory, the mapping is released right after
+ * - Scale and center the mesh so that it fits in the unit cube the camera looks at
  */
-void initSyncObjects(VulkanContext* vulkanContext) {
-    vulkanContext->commandBufferFences = new VkFence[vulkanContext->commandBufferCount];
+void initVertexAttributes(VulkanContext* vulkanContext)
+{
+    ProfileFunction();
+    vulkanContext->vertexAtt.modelNormalization = glm::mat4(1.0f);
+    if(vulkanContext->meshPath == nullptr) {
+      MeshFileSubmesh quadSubmesh = {0, quadPosColVertexAtt.indices.count, 0, 0};
+      prepareVertexAttributeMemory(vulkanContext, quadPosColVertexAtt, &quadSubmesh, 1);
+      return;
+    }
+
+    MeshFile* mesh = &vulkanContext->mesh;
+    loadMeshFile(vulkanContext->meshPath, mesh);
+    prepareVertexAttributeMemory(vulkanContext, mesh->vertexAtt, mesh->submeshes, mesh->submeshCount);
+
+    glm::vec3 boundsMin(mesh->header->boundsMin[0], mesh->header->boundsMin[1], mesh->header->boundsMin[2]);
+    glm::vec3 boundsMax(mesh->header->boundsMax[0], mesh->header->boundsMax[1], mesh->header->boundsMax[2]);
+    glm::vec3 extent = boundsMax - boundsMin;
+    f32 largestExtent = glm::max(extent.x, glm::max(extent.y, extent.z));
+    if(largestExtent > 0.0f) {
+      vulkanContext->vertexAtt.modelNormalization = glm::scale(glm::mat4(1.0f), glm::vec3(2.0f / largestExtent))
+                                                    * glm::translate(glm::mat4(1.0f), -(boundsMin + boundsMax) * 0.5f);
+    }
+    // Quantized positions are relative to the bounds, dequantizing is one more affine transform before normalization
+    const PositionDequantization& dequantization = mesh->header->positionDequantization;
+    vulkanContext->vertexAtt.modelNormalization = vulkanContext->vertexAtt.modelNormalization
+        * glm::translate(glm::mat4(1.0f), glm::vec3(dequantization.offset[0], dequantization.offset[1], dequantization.offset[2]))
+        * glm::scale(glm::mat4(1.0f), glm::vec3(dequantization.scale[0], dequantization.scale[1], dequantization.scale[2]));
+    unloadMeshFile(mesh);
+    vulkanContext->vertexAtt.info.data = nullptr;
+    vulkanContext->vertexAtt.info.indices.data = nullptr;
+}
+
+/*
+ * - Lay the instances out on a square grid filling the unit square the camera looks at, each scaled down to its cell
+ * - Tint the instances by their grid position, a single instance keeps the vertex colors as they are
+ * - Upload on the transfer queue along with the vertex data
+ */
+void initInstances(VulkanContext* vulkanContext)
+{
+    ProfileFunction();
+    u32 instanceCount = vulkanContext->instanceCount;
+    if(instanceCount == 0) {
+      throw std::runtime_error("at least one instance is required!");
+    }
+    initInstanceBuffer(vulkanContext->device.logical, &vulkanContext->memoryAllocator, instanceCount, &vulkanContext->instances);
+
+    u32 gridSize = (u32)glm::ceil(glm::sqrt((f64)instanceCount));
+    f32 cellSize = 2.0f / gridSize;
+    f32 tint = instanceCount > 1 ? 0.5f : 0.0f;
+    std::vector<InstanceAttDatum> instances(instanceCount);
+    for(u32 i = 0; i < instanceCount; ++i) {
+      f32 u = ((i % gridSize) + 0.5f) / gridSize;
+      f32 v = ((i / gridSize) + 0.5f) / gridSize;
+      glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(u * 2.0f - 1.0f, v * 2.0f - 1.0f, 0.0f))
+                        * glm::scale(glm::mat4(1.0f), glm::vec3(cellSize * 0.5f));
+      glm::vec3 color = glm::mix(glm::vec3(1.0f), glm::vec3(u, v, 1.0f - u), tint);
+      memcpy(instances[i].model, &model[0][0], sizeof(instances[i].model));
+      instances[i].color[0] = color.r; instances[i].color[1] = color.g; instances[i].color[2] = color.b; instances[i].color[3] = 1.0f;
+    }
+    uploadInstances(&vulkanContext->uploadQueue, &vulkanContext->instances, instances.data(), instanceCount);
+    submitUploads(&vulkanContext->uploadQueue);
+}
 
+/*
+ * - Create an indirect draw buffer per frame in flight, with room for every submesh in the geometry store
+ * - When recording in parallel every instance is drawn as its own object, with commands of its own
+ * - Commands are rewritten while recording each frame, after the frame's fence was waited on
+ */
+void initIndirectDraws(VulkanContext* vulkanContext)
+{
+    ProfileFunction();
+    u64 capacity = vulkanContext->geometryStore.submeshes.size();
+    if(vulkanContext->recordingThreadCount > 0) {
+      capacity *= vulkanContext->instances.count;
+    }
+    if(capacity > UINT32_MAX / sizeof(VkDrawIndexedIndirectCommand)) {
+      throw std::runtime_error("too many instances to draw each submesh indirectly!");
+    }
+    for(u32 i = 0; i < vulkanContext->frameCount; ++i) {
+      initIndirectDrawBuffer(vulkanContext->device.logical, &vulkanContext->memoryAllocator, (u32)capacity, &vulkanContext->frames[i].indirectDraws);
+    }
+}
+
+/*
+ * - Create semaphores per frame in flight to wait between swap chain image acquisition, rendering and presentation
+ * - Create fences per frame in flight that will be used to wait for completion of submitted command buffers
+ * - Create images in flight tracking for the swap chain images
+ */
+void initSyncObjects(VulkanContext* vulkanContext) {
+    ProfileFunction();
     VkSemaphoreCreateInfo semaphoreCI{};
     semaphoreCI.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
@@ -839,21 +2082,33 @@ void initSyncObjects(VulkanContext* vulkanContext) {
     fenceCI.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceCI.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    if(vkCreateSemaphore(vulkanContext->device.logical, &semaphoreCI, nullAllocator, &vulkanContext->semaphores.present) != VK_SUCCESS ||
-       vkCreateSemaphore(vulkanContext->device.logical, &semaphoreCI, nullAllocator, &vulkanContext->semaphores.render) != VK_SUCCESS) {
+    for(u32 i = 0; i < vulkanContext->frameCount; ++i) {
+        FrameInFlight* frame = &vulkanContext->frames[i];
+        if(vkCreateSemaphore(vulkanContext->device.logical, &semaphoreCI, nullAllocator, &frame->imageAcquiredSemaphore) != VK_SUCCESS ||
+           vkCreateSemaphore(vulkanContext->device.logical, &semaphoreCI, nullAllocator, &frame->renderFinishedSemaphore) != VK_SUCCESS) {
             throw std::runtime_error("failed to create semaphores!");
-    }
-    for(u32 i = 0; i < vulkanContext->commandBufferCount; ++i) {
-        if (vkCreateFence(vulkanContext->device.logical, &fenceCI, nullAllocator, vulkanContext->commandBufferFences + i) != VK_SUCCESS) {
+        }
+        if (vkCreateFence(vulkanContext->device.logical, &fenceCI, nullAllocator, &frame->fence) != VK_SUCCESS) {
             throw std::runtime_error("failed to create fences!");
         }
     }
+
+    initImagesInFlight(vulkanContext);
+}
+
+// No frame is rendering to any swap chain image until it has been acquired
+void initImagesInFlight(VulkanContext* vulkanContext) {
+  vulkanContext->imagesInFlight = new VkFence[vulkanContext->swapChain.imageCount];
+  for(u32 i = 0; i < vulkanContext->swapChain.imageCount; ++i) {
+    vulkanContext->imagesInFlight[i] = VK_NULL_HANDLE;
+  }
 }
 
 void initDescriptorSetLayout(VulkanContext* vulkanContext) {
+  ProfileFunction();
   VkDescriptorSetLayoutBinding transMatsDescriptorSetLayoutBinding{};
   transMatsDescriptorSetLayoutBinding.binding = TRANS_MATS_UNIFORM_BUFFER_BINDING_INDEX;
-  transMatsDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  transMatsDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
   transMatsDescriptorSetLayoutBinding.descriptorCount = 1;
   transMatsDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
   transMatsDescriptorSetLayoutBinding.pImmutableSamplers = nullptr;
@@ -868,134 +2123,163 @@ void initDescriptorSetLayout(VulkanContext* vulkanContext) {
   }
 }
 
+/*
+ * - Create a persistently mapped uniform ring buffer with a partition for each frame in flight
+ */
 void prepareUniformBufferMemory(VulkanContext* vulkanContext) {
-  vulkanContext->uniformBuffers.count = vulkanContext->swapChain.imageCount;
-  u32 uniformBufferDataSize = sizeof(TransMats);
-  u32 totalBufferSize = uniformBufferDataSize * vulkanContext->uniformBuffers.count;
-
-  vulkanContext->uniformBuffers.offsets = new u32[vulkanContext->uniformBuffers.count];
-
-  // Create a host-visible buffer to copy the vertex data to (staging buffer)
-  VkBufferCreateInfo uniformBufferBufferInfo = {};
-  uniformBufferBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-  uniformBufferBufferInfo.size = totalBufferSize;
-  uniformBufferBufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT; // Buffer is used as the copy source
-
-  vkCreateBuffer(vulkanContext->device.logical, &uniformBufferBufferInfo, nullAllocator, &vulkanContext->uniformBuffers.buffer);
-
-  VkMemoryRequirements uniformBufferMemReqs;
-  vkGetBufferMemoryRequirements(vulkanContext->device.logical, vulkanContext->uniformBuffers.buffer, &uniformBufferMemReqs);
-
-  vulkanContext->uniformBuffers.alignment = (u32)max(uniformBufferMemReqs.alignment, vulkanContext->device.minUniformBufferOffsetAlignment);
-  u32 alignmentsPerData = (uniformBufferDataSize + vulkanContext->uniformBuffers.alignment - 1) / vulkanContext->uniformBuffers.alignment;
-  u32 offsetInterval = alignmentsPerData * vulkanContext->uniformBuffers.alignment;
-  uniformBufferBufferInfo.size = offsetInterval * vulkanContext->uniformBuffers.count;
-  vkDestroyBuffer(vulkanContext->device.logical, vulkanContext->uniformBuffers.buffer, nullAllocator);
-  vkCreateBuffer(vulkanContext->device.logical, &uniformBufferBufferInfo, nullAllocator, &vulkanContext->uniformBuffers.buffer);
-  vkGetBufferMemoryRequirements(vulkanContext->device.logical, vulkanContext->uniformBuffers.buffer, &uniformBufferMemReqs);
-
-  VkMemoryAllocateInfo uniformBufferMemAllocInfo = {};
-  uniformBufferMemAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  uniformBufferMemAllocInfo.allocationSize = uniformBufferMemReqs.size;
-  uniformBufferMemAllocInfo.memoryTypeIndex = getMemoryTypeIndex(&vulkanContext->device.memoryProperties, uniformBufferMemReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-  vkAllocateMemory(vulkanContext->device.logical, &uniformBufferMemAllocInfo, nullAllocator, &vulkanContext->uniformBuffers.memory);
-  vkBindBufferMemory(vulkanContext->device.logical, vulkanContext->uniformBuffers.buffer, vulkanContext->uniformBuffers.memory, 0/*memory offset*/);
-
-  for(u32 i = 0; i < vulkanContext->uniformBuffers.count; ++i) {
-    vulkanContext->uniformBuffers.offsets[i] = i * offsetInterval;
-  }
+  ProfileFunction();
+  initUniformRingBuffer(vulkanContext->device.logical,
+                        &vulkanContext->memoryAllocator,
+                        vulkanContext->device.minUniformBufferOffsetAlignment,
+                        UNIFORM_RING_BUFFER_FRAME_CAPACITY,
+                        vulkanContext->frameCount,
+                        &vulkanContext->uniformBuffers.ringBuffer);
 }
 
 void initVulkan(GLFWwindow* window, VulkanContext* vulkanContext) {
+    ProfileFunction();
     vulkanContext->windowExtent = { INITIAL_VIEWPORT_WIDTH, INITIAL_VIEWPORT_HEIGHT };
 
-    initVulkanInstance(&vulkanContext->instance, &vulkanContext->debugMessenger);
-    initSurface(window, &vulkanContext->instance, &vulkanContext->surface);
+    initVulkanInstance(&vulkanContext->instance, &vulkanContext->debugMessenger, vulkanContext->headless);
+    if(vulkanContext->headless) {
+      vulkanContext->surface = VK_NULL_HANDLE;
+    } else {
+      initSurface(window, &vulkanContext->instance, &vulkanContext->surface);
+    }
     pickPhysicalDevice(vulkanContext);
+    vulkanContext->enablePipelineStatistics = vulkanContext->enablePipelineStatistics && vulkanContext->device.pipelineStatisticsQuerySupported;
+    // the pipeline statistics query is active while the secondary command buffers execute
+    bool32 enableInheritedQueries = vulkanContext->enablePipelineStatistics && vulkanContext->recordingThreadCount > 0;
+    vulkanContext->enablePipelineStatistics = vulkanContext->enablePipelineStatistics && (!enableInheritedQueries || vulkanContext->device.inheritedQueriesSupported);
+    enableInheritedQueries = enableInheritedQueries && vulkanContext->enablePipelineStatistics;
 
     QueueFamilyIndices queueFamilyIndices;
     findQueueFamilies(vulkanContext->surface, vulkanContext->device.physical, &queueFamilyIndices);
+    vulkanContext->device.queueFamilyIndices = queueFamilyIndices;
 
-    initLogicalDeviceAndQueues(&vulkanContext->device.logical, &vulkanContext->device.physical, &queueFamilyIndices);
+    initLogicalDeviceAndQueues(&vulkanContext->device.logical, &vulkanContext->device.physical, &queueFamilyIndices, vulkanContext->device.extendedDynamicState.supported,
+                               vulkanContext->enablePipelineStatistics, enableInheritedQueries, vulkanContext->device.indirectDraw, vulkanContext->headless);
+    if(vulkanContext->device.extendedDynamicState.supported) {
+      vulkanContext->device.extendedDynamicState.vkCmdSetCullMode = (PFN_vkCmdSetCullModeEXT) vkGetDeviceProcAddr(vulkanContext->device.logical, "vkCmdSetCullModeEXT");
+      vulkanContext->device.extendedDynamicState.vkCmdSetFrontFace = (PFN_vkCmdSetFrontFaceEXT) vkGetDeviceProcAddr(vulkanContext->device.logical, "vkCmdSetFrontFaceEXT");
+    }
+    if(vulkanContext->device.indirectDraw.drawIndirectCount) {
+      vulkanContext->device.indirectDraw.vkCmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR) vkGetDeviceProcAddr(vulkanContext->device.logical, "vkCmdDrawIndexedIndirectCountKHR");
+    }
     vkGetDeviceQueue(vulkanContext->device.logical, queueFamilyIndices.graphics, 0, &vulkanContext->device.queues.graphics);
     vkGetDeviceQueue(vulkanContext->device.logical, queueFamilyIndices.present, 0, &vulkanContext->device.queues.present);
     vkGetDeviceQueue(vulkanContext->device.logical, queueFamilyIndices.transfer, 0, &vulkanContext->device.queues.transfer);
-
-    initRenderPass(&vulkanContext->device.logical, SWAP_CHAIN_IMAGE_FORMAT, &vulkanContext->renderPass);
-    initSwapChain(vulkanContext, queueFamilyIndices);
+    vkGetDeviceQueue(vulkanContext->device.logical, queueFamilyIndices.compute, 0, &vulkanContext->device.queues.compute);
+    initGpuMemoryAllocator(vulkanContext->device.logical, vulkanContext->device.physical, DEFAULT_GPU_MEMORY_BLOCK_SIZE, &vulkanContext->memoryAllocator);
+    initUploadQueue(vulkanContext->device.logical, &vulkanContext->memoryAllocator, vulkanContext->device.queues.transfer,
+                    queueFamilyIndices.transfer, queueFamilyIndices.graphics, &vulkanContext->uploadQueue);
+
+    // NOTE: Render passes differing only in attachment layouts are compatible, so pipelines are shared by both modes
+    if(vulkanContext->headless) {
+      initRenderPass(&vulkanContext->device.logical, SWAP_CHAIN_IMAGE_FORMAT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, &vulkanContext->renderPass);
+      initOffscreenImages(vulkanContext);
+    } else {
+      initRenderPass(&vulkanContext->device.logical, SWAP_CHAIN_IMAGE_FORMAT, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, &vulkanContext->renderPass);
+      initSwapChain(vulkanContext, queueFamilyIndices, VK_NULL_HANDLE);
+    }
+    initSwapChainRayMarchTarget(vulkanContext);
     initCommandPools(vulkanContext, queueFamilyIndices);
-    initSwapChainCommandBuffers(vulkanContext);
-    prepareVertexAttributeMemory(vulkanContext, quadPosColVertexAtt);
+    initFrameCommandBuffers(vulkanContext);
+    initGpuQueries(vulkanContext->device.logical, vulkanContext->device.physical, queueFamilyIndices.graphics,
+                   vulkanContext->frameCount, vulkanContext->enablePipelineStatistics, &vulkanContext->gpuQueries);
+    initVertexAttributes(vulkanContext);
+    initInstances(vulkanContext);
+    initIndirectDraws(vulkanContext);
     prepareUniformBufferMemory(vulkanContext);
     initDescriptorSetLayout(vulkanContext);
     initDescriptorPool(vulkanContext);
     initDescriptorSets(vulkanContext);
     initImageViews(&vulkanContext->device.logical, &vulkanContext->swapChain);
+    initPipelineCache(vulkanContext);
+    initThreadPool(defaultWorkerCount(), &vulkanContext->threadPool);
+    if(vulkanContext->recordingThreadCount > 0) {
+      // the main thread records the last slice
+      initThreadPool(vulkanContext->recordingThreadCount - 1, &vulkanContext->recordingThreadPool);
+      initParallelCommandRecorder(vulkanContext->device.logical, queueFamilyIndices.graphics, &vulkanContext->recordingThreadPool,
+                                  vulkanContext->frameCount, vulkanContext->recordingThreadCount, &vulkanContext->parallelRecorder);
+    }
+    initShaderModuleCache(vulkanContext->device.logical, &vulkanContext->shaderModuleCache);
+    if(vulkanContext->shaderHotReload.enabled) {
+      initShaderWatcher(vulkanContext->shaderHotReload.sourceDirectory, SHADER_LOC_BASE, &vulkanContext->shaderHotReload.watcher);
+    }
     initGraphicsPipeline(vulkanContext);
+    if(vulkanContext->rayMarchMode != RAY_MARCH_OFF) {
+      initRayMarch(vulkanContext);
+    }
+    if(vulkanContext->shaderHotReload.enabled) {
+      initHotReloadPipelines(vulkanContext);
+    }
     initFramebuffers(vulkanContext);
     initSyncObjects(vulkanContext);
 }
 
 void initDescriptorPool(VulkanContext* vulkanContext)
 {
+  ProfileFunction();
   VkDescriptorPoolSize poolSize{};
-  poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  poolSize.descriptorCount = vulkanContext->uniformBuffers.count;
+  poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+  poolSize.descriptorCount = 1;
 
   VkDescriptorPoolCreateInfo poolInfo{};
   poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
   poolInfo.poolSizeCount = 1;
   poolInfo.pPoolSizes = &poolSize;
-  poolInfo.maxSets = vulkanContext->uniformBuffers.count;
+  poolInfo.maxSets = 1;
 
   if (vkCreateDescriptorPool(vulkanContext->device.logical, &poolInfo, nullptr, &vulkanContext->uniformBuffers.descriptorPool) != VK_SUCCESS) {
     throw std::runtime_error("failed to create descriptor pool!");
   }
 }
 
+/*
+ * - A single dynamic uniform buffer descriptor covers the whole uniform ring buffer, the frame's TransMats are
+ *   selected with a dynamic offset when binding
+ */
 void initDescriptorSets(VulkanContext* vulkanContext) {
-  std::vector<VkDescriptorSetLayout> layouts(vulkanContext->uniformBuffers.count, vulkanContext->uniformBuffers.descriptorSetLayout);
+  ProfileFunction();
   VkDescriptorSetAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
   allocInfo.descriptorPool = vulkanContext->uniformBuffers.descriptorPool;
-  allocInfo.descriptorSetCount = vulkanContext->uniformBuffers.count;
-  allocInfo.pSetLayouts = layouts.data();
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &vulkanContext->uniformBuffers.descriptorSetLayout;
 
-  vulkanContext->uniformBuffers.descriptorSets = new VkDescriptorSet[vulkanContext->uniformBuffers.count];
-  if (vkAllocateDescriptorSets(vulkanContext->device.logical, &allocInfo, vulkanContext->uniformBuffers.descriptorSets) != VK_SUCCESS) {
+  if (vkAllocateDescriptorSets(vulkanContext->device.logical, &allocInfo, &vulkanContext->uniformBuffers.descriptorSet) != VK_SUCCESS) {
     throw std::runtime_error("failed to allocate descriptor sets!");
   }
 
   VkDescriptorBufferInfo bufferInfo{};
-  bufferInfo.buffer = vulkanContext->uniformBuffers.buffer;
-  for (size_t i = 0; i < vulkanContext->uniformBuffers.count; ++i) {
-    bufferInfo.offset = vulkanContext->uniformBuffers.offsets[i];
-    bufferInfo.range = vulkanContext->uniformBuffers.alignment;
-
-    VkWriteDescriptorSet descriptorWrite{};
-    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet = vulkanContext->uniformBuffers.descriptorSets[i];
-    descriptorWrite.dstBinding = TRANS_MATS_UNIFORM_BUFFER_BINDING_INDEX;
-    descriptorWrite.dstArrayElement = 0;
-    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    descriptorWrite.descriptorCount = 1;
-    descriptorWrite.pBufferInfo = &bufferInfo; // used for descriptors that refer to buffer data
-    descriptorWrite.pImageInfo = nullptr; // used for descriptors that refer to image data
-    descriptorWrite.pTexelBufferView = nullptr; // used for descriptors that refer to buffer views
-
-    vkUpdateDescriptorSets(vulkanContext->device.logical, 1, &descriptorWrite, 0, nullptr);
-  }
+  bufferInfo.buffer = vulkanContext->uniformBuffers.ringBuffer.buffer;
+  bufferInfo.offset = 0;
+  bufferInfo.range = sizeof(TransMats);
+
+  VkWriteDescriptorSet descriptorWrite{};
+  descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  descriptorWrite.dstSet = vulkanContext->uniformBuffers.descriptorSet;
+  descriptorWrite.dstBinding = TRANS_MATS_UNIFORM_BUFFER_BINDING_INDEX;
+  descriptorWrite.dstArrayElement = 0;
+  descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+  descriptorWrite.descriptorCount = 1;
+  descriptorWrite.pBufferInfo = &bufferInfo; // used for descriptors that refer to buffer data
+  descriptorWrite.pImageInfo = nullptr; // used for descriptors that refer to image data
+  descriptorWrite.pTexelBufferView = nullptr; // used for descriptors that refer to buffer views
+
+  vkUpdateDescriptorSets(vulkanContext->device.logical, 1, &descriptorWrite, 0, nullptr);
 }
 
 /*
  * TLDR:
  * - Sets app name/version, engine name/version
  * - Specify vulkan API version
- * - Specify extensions: GLFW extension, debug utils extension
+ * - Specify extensions: GLFW extension (unless headless), debug utils extension
  * - Specify layers: Debug validation layer
  */
-void initVulkanInstance(VkInstance* vulkanInstance, VkDebugUtilsMessengerEXT* debugMessenger) {
+void initVulkanInstance(VkInstance* vulkanInstance, VkDebugUtilsMessengerEXT* debugMessenger, bool32 headless) {
+    ProfileFunction();
     if(enableValidationLayers && !checkValidationLayerSupport()) {
         throw std::runtime_error("validation layers requested but not found");
     }
@@ -1013,9 +2297,9 @@ void initVulkanInstance(VkInstance* vulkanInstance, VkDebugUtilsMessengerEXT* de
     instanceCI.pApplicationInfo = &appInfo;
 
     u32 extensionsCount;
-    getRequiredExtensions(nullptr, &extensionsCount);
+    getRequiredExtensions(nullptr, &extensionsCount, headless);
     const char** extensions = new const char*[extensionsCount];
-    getRequiredExtensions(extensions, &extensionsCount);
+    getRequiredExtensions(extensions, &extensionsCount, headless);
     instanceCI.enabledExtensionCount = extensionsCount;
     instanceCI.ppEnabledExtensionNames = extensions;
 
@@ -1079,9 +2363,9 @@ bool32 checkValidationLayerSupport() {
     return layersFound;
 }
 
-void getRequiredExtensions(const char ** extensions, u32 *extensionCount) {
-    u32 glfwExtensionCount;
-    const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+void getRequiredExtensions(const char ** extensions, u32 *extensionCount, bool32 headless) {
+    u32 glfwExtensionCount = 0;
+    const char** glfwExtensions = headless ? nullptr : glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
     *extensionCount = enableValidationLayers ? glfwExtensionCount + 1 : glfwExtensionCount;
 
@@ -1144,16 +2428,63 @@ void printAvailableExtensions() {
     delete[] extensions;
 }
 
-void destroyImageViews(VulkanContext* vulkanContext) {
-  for(u32 i = 0; i < vulkanContext->swapChain.imageCount; ++i) {
-    vkDestroyImageView(vulkanContext->device.logical, vulkanContext->swapChain.imageViews[i], nullAllocator);
+void destroyImageViews(VkDevice device, SwapChain* swapChain) {
+  for(u32 i = 0; i < swapChain->imageCount; ++i) {
+    vkDestroyImageView(device, swapChain->imageViews[i], nullAllocator);
   }
 }
 
+// NOTE: swap chain images are owned by the swap chain and destroyed alongside it, headless offscreen images are not
+void destroySwapChain(VkDevice device, GpuMemoryAllocator* memoryAllocator, SwapChain* swapChain) {
+  destroyFramebuffers(device, swapChain);
+  destroyImageViews(device, swapChain);
+  if(swapChain->handle != VK_NULL_HANDLE) {
+    vkDestroySwapchainKHR(device, swapChain->handle, nullAllocator);
+  } else {
+    for(u32 i = 0; i < swapChain->imageCount; ++i) {
+      vkDestroyImage(device, swapChain->images[i], nullAllocator);
+      freeGpuMemory(memoryAllocator, &swapChain->imageMemory[i]);
+    }
+  }
+
+  if(swapChain->rayMarchTarget.image != VK_NULL_HANDLE) {
+    destroyRayMarchTarget(device, memoryAllocator, &swapChain->rayMarchTarget);
+  }
+
+  delete[] swapChain->images;
+  delete[] swapChain->imageMemory;
+  delete[] swapChain->framebuffers;
+  delete[] swapChain->imageViews;
+}
+
+// NOTE: window is null when headless
 void cleanup(GLFWwindow* window, VulkanContext* vulkanContext) {
-  deinitializeInput();
+  ProfileFunction();
+  if(window != nullptr) {
+    deinitializeInput();
+  }
 
   VkDevice device = vulkanContext->device.logical;
+  // queued pipeline builds reference the render pass and descriptor set layout, and the pipeline cache may only be
+  // saved once no pipelines are building
+  destroyThreadPool(&vulkanContext->threadPool);
+  if(vulkanContext->recordingThreadCount > 0) {
+    destroyThreadPool(&vulkanContext->recordingThreadPool);
+  }
+  if(vulkanContext->shaderHotReload.enabled) {
+    destroyShaderWatcher(&vulkanContext->shaderHotReload.watcher);
+    // the thread pool has drained, every rebuild has finished
+    for(PipelineRebuild& rebuild : vulkanContext->shaderHotReload.rebuilds) {
+      try {
+        BuiltPipeline unusedPipeline = rebuild.rebuilt.get();
+        vkDestroyPipeline(device, unusedPipeline.pipeline, nullAllocator);
+        vkDestroyPipelineLayout(device, unusedPipeline.pipelineLayout, nullAllocator);
+      } catch(const std::exception&) {
+        // failed rebuilds have nothing to destroy
+      }
+    }
+    releaseRetiredPipelines(vulkanContext, true);
+  }
 
     if(enableValidationLayers) {
         DestroyDebugUtilsMessengerEXT(&vulkanContext->instance, &vulkanContext->debugMessenger, nullAllocator);
@@ -1161,49 +2492,68 @@ void cleanup(GLFWwindow* window, VulkanContext* vulkanContext) {
 
     // NOTE: No need to call vkFreeCommandBuffers as they get freed when the command pool is destroyed
     vkDestroyCommandPool(device, vulkanContext->graphicsCommandPool, nullAllocator);
-    if(vulkanContext->graphicsCommandPool != vulkanContext->transferCommandPool) {
-      vkDestroyCommandPool(device, vulkanContext->transferCommandPool, nullAllocator);
+    if(vulkanContext->recordingThreadCount > 0) {
+      destroyParallelCommandRecorder(&vulkanContext->parallelRecorder);
     }
+    destroyUploadQueue(&vulkanContext->uploadQueue);
 
-    destroyFramebuffers(vulkanContext);
-    destroyImageViews(vulkanContext);
+    releaseRetiredSwapChains(vulkanContext, true);
+    destroySwapChain(device, &vulkanContext->memoryAllocator, &vulkanContext->swapChain);
 
-    for(u32 i = 0; i < vulkanContext->commandBufferCount; ++i) {
-        vkDestroyFence(device, vulkanContext->commandBufferFences[i], nullAllocator);
+    for(u32 i = 0; i < vulkanContext->frameCount; ++i) {
+        vkDestroyFence(device, vulkanContext->frames[i].fence, nullAllocator);
+        vkDestroySemaphore(device, vulkanContext->frames[i].renderFinishedSemaphore, nullAllocator);
+        vkDestroySemaphore(device, vulkanContext->frames[i].imageAcquiredSemaphore, nullAllocator);
+        destroyIndirectDrawBuffer(device, &vulkanContext->memoryAllocator, &vulkanContext->frames[i].indirectDraws);
     }
-    vkDestroySemaphore(device, vulkanContext->semaphores.render, nullAllocator);
-    vkDestroySemaphore(device, vulkanContext->semaphores.present, nullAllocator);
 
-    vkDestroyBuffer(device, vulkanContext->uniformBuffers.buffer, nullAllocator);
-    vkFreeMemory(device, vulkanContext->uniformBuffers.memory, nullAllocator);
+    destroyUniformRingBuffer(device, &vulkanContext->memoryAllocator, &vulkanContext->uniformBuffers.ringBuffer);
+    destroyGpuQueries(device, &vulkanContext->gpuQueries);
     vkDestroyDescriptorPool(device, vulkanContext->uniformBuffers.descriptorPool, nullAllocator);
     vkDestroyDescriptorSetLayout(device, vulkanContext->uniformBuffers.descriptorSetLayout, nullAllocator);
-    vkDestroyBuffer(device, vulkanContext->vertexAtt.buffer, nullAllocator);
-    vkFreeMemory(device, vulkanContext->vertexAtt.memory, nullAllocator);
+    destroyGeometryStore(device, &vulkanContext->memoryAllocator, &vulkanContext->geometryStore);
+    destroyInstanceBuffer(device, &vulkanContext->memoryAllocator, &vulkanContext->instances);
+    if(isComputeRayMarch(vulkanContext->rayMarchMode)) {
+      destroyRayMarchPass(device, &vulkanContext->memoryAllocator, &vulkanContext->rayMarch);
+    } else if(vulkanContext->rayMarchMode == RAY_MARCH_FRAGMENT) {
+      for(u32 i = 0; i < RAY_MARCH_QUALITY_COUNT; ++i) {
+        vkDestroyPipeline(device, vulkanContext->rayMarchFragment.pipelines[i], nullAllocator);
+        vkDestroyPipelineLayout(device, vulkanContext->rayMarchFragment.pipelineLayouts[i], nullAllocator);
+      }
+    }
     vkDestroyRenderPass(device, vulkanContext->renderPass, nullAllocator);
     vkDestroyPipeline(device, vulkanContext->graphicsPipeline, nullAllocator);
+    destroyShaderModuleCache(&vulkanContext->shaderModuleCache);
+    if(vulkanContext->pipelineCachePath != nullptr) {
+      // Failing to save only costs the next run's warm start, teardown must still complete
+      try {
+        savePipelineCache(device, vulkanContext->device.physical, vulkanContext->pipelineCache, vulkanContext->pipelineCachePath);
+      } catch(const std::exception& e) {
+        std::cerr << "pipeline cache not saved: " << e.what() << std::endl;
+      }
+    }
+    vkDestroyPipelineCache(device, vulkanContext->pipelineCache, nullAllocator);
     vkDestroyPipelineLayout(device, vulkanContext->pipelineLayout, nullAllocator);
-    vkDestroySwapchainKHR(device, vulkanContext->swapChain.handle, nullAllocator);
-    vkDestroySurfaceKHR(vulkanContext->instance, vulkanContext->surface, nullAllocator);
+    if(vulkanContext->surface != VK_NULL_HANDLE) {
+      vkDestroySurfaceKHR(vulkanContext->instance, vulkanContext->surface, nullAllocator);
+    }
+    destroyGpuMemoryAllocator(&vulkanContext->memoryAllocator);
     vkDestroyDevice(device, nullAllocator);
     vkDestroyInstance(vulkanContext->instance, nullAllocator);
     
-    delete[] vulkanContext->swapChain.images;
-    delete[] vulkanContext->swapChain.framebuffers;
-    delete[] vulkanContext->swapChain.imageViews;
-    delete[] vulkanContext->commandBuffers;
-    delete[] vulkanContext->commandBufferFences;
-    delete[] vulkanContext->uniformBuffers.offsets;
-    delete[] vulkanContext->uniformBuffers.descriptorSets;
+    delete[] vulkanContext->frames;
+    delete[] vulkanContext->imagesInFlight;
     
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    if(window != nullptr) {
+      glfwDestroyWindow(window);
+      glfwTerminate();
+    }
 }
 
-void destroyFramebuffers(VulkanContext* vulkanContext)
+void destroyFramebuffers(VkDevice device, SwapChain* swapChain)
 {
-  for(u32 i = 0; i < vulkanContext->swapChain.framebufferCount; ++i) {
-    vkDestroyFramebuffer(vulkanContext->device.logical, vulkanContext->swapChain.framebuffers[i], nullAllocator);
+  for(u32 i = 0; i < swapChain->framebufferCount; ++i) {
+    vkDestroyFramebuffer(device, swapChain->framebuffers[i], nullAllocator);
   }
 }
 
@@ -1212,6 +2562,7 @@ void destroyFramebuffers(VulkanContext* vulkanContext)
  */
 void initFramebuffers(VulkanContext* vulkanContext)
 {
+  ProfileFunction();
   SwapChain* swapChain = &vulkanContext->swapChain;
   swapChain->framebufferCount = swapChain->imageCount;
   swapChain->framebuffers = new VkFramebuffer[swapChain->framebufferCount];
@@ -1233,23 +2584,30 @@ void initFramebuffers(VulkanContext* vulkanContext)
 }
 
 /*
- * - Allocate primary command buffers from the VulkanContext.graphicsCommandPool to be used along size the swap chain's framebuffers
+ * - Allocate a primary command buffer from the VulkanContext.graphicsCommandPool for each frame in flight
  */
-void initSwapChainCommandBuffers(VulkanContext* vulkanContext)
+void initFrameCommandBuffers(VulkanContext* vulkanContext)
 {
-  vulkanContext->commandBufferCount = vulkanContext->swapChain.imageCount;
-  vulkanContext->commandBuffers = new VkCommandBuffer[vulkanContext->commandBufferCount];
+  ProfileFunction();
+  vulkanContext->frames = new FrameInFlight[vulkanContext->frameCount];
+  VkCommandBuffer* commandBuffers = new VkCommandBuffer[vulkanContext->frameCount];
 
   VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
   commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   commandBufferAllocateInfo.commandPool = vulkanContext->graphicsCommandPool;
   // Primary level allows us to submit directly to a queue for execution, secondary level allows us to reference from another command buffer
   commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  commandBufferAllocateInfo.commandBufferCount = vulkanContext->commandBufferCount;
+  commandBufferAllocateInfo.commandBufferCount = vulkanContext->frameCount;
 
-  if (vkAllocateCommandBuffers(vulkanContext->device.logical, &commandBufferAllocateInfo, vulkanContext->commandBuffers) != VK_SUCCESS) {
+  if (vkAllocateCommandBuffers(vulkanContext->device.logical, &commandBufferAllocateInfo, commandBuffers) != VK_SUCCESS) {
     throw std::runtime_error("failed to allocate command buffers!");
   }
+
+  for(u32 i = 0; i < vulkanContext->frameCount; ++i) {
+    vulkanContext->frames[i].commandBuffer = commandBuffers[i];
+  }
+
+  delete[] commandBuffers;
 }
 
 /*
@@ -1259,6 +2617,7 @@ void initSwapChainCommandBuffers(VulkanContext* vulkanContext)
  */
 void initImageViews(VkDevice* logicalDevice, SwapChain* swapChain)
 {
+  ProfileFunction();
   swapChain->imageViews = new VkImageView[swapChain->imageCount];
   for(u32 i = 0; i < swapChain->imageCount; ++i) {
     VkImageViewCreateInfo imageViewCI{};
@@ -1288,8 +2647,9 @@ void initImageViews(VkDevice* logicalDevice, SwapChain* swapChain)
  *    - specifying what we expect to happen before we access the attachments and how we should wait for them
  *    - specifying what we expect to happen after we finish accessing the attachments and how others should wait for our renderpass
  */
-void initRenderPass(VkDevice* logicalDevice, VkFormat colorAttachmentFormat, VkRenderPass* renderPass)
+void initRenderPass(VkDevice* logicalDevice, VkFormat colorAttachmentFormat, VkImageLayout finalLayout, VkRenderPass* renderPass)
 {
+  ProfileFunction();
   const u32 colorAttachmentIndex = 0;
   VkAttachmentDescription attachmentDescs[1];
 
@@ -1300,7 +2660,7 @@ void initRenderPass(VkDevice* logicalDevice, VkFormat colorAttachmentFormat, VkR
   attachmentDescs[colorAttachmentIndex].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   attachmentDescs[colorAttachmentIndex].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   attachmentDescs[colorAttachmentIndex].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; // layout assumed before render pass
-  attachmentDescs[colorAttachmentIndex].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // layout to automatically transition to after render pass
+  attachmentDescs[colorAttachmentIndex].finalLayout = finalLayout; // layout to automatically transition to after render pass (present or, when headless, transfer src)
   attachmentDescs[colorAttachmentIndex].flags = 0;
 
   VkAttachmentReference colorAttachmentRefs[1];
@@ -1351,52 +2711,256 @@ void initRenderPass(VkDevice* logicalDevice, VkFormat colorAttachmentFormat, VkR
  * - Specify vertex attributes to be used as the pipeline's vertex input
  *    - input rate, stride, binding point(used in vkCmdBindVertexBuffers), location, format, offset
  * - Specify topology of vertex data [ex: triangle list, triangle strip, points, lines]
- * - Specify the viewport extent w/ offset (which defines NDCs) and scissor extent w/ offset (which defines the portion
- *                                                                           of the viewport that is actually drawn to)
+ * - Specify the viewport and scissor as dynamic state so that the pipeline survives swap chain recreation
+ * - Specify cull mode and winding order as dynamic state if VK_EXT_extended_dynamic_state is supported
  * - Specify various state like line width, fill mode, cull mode, winding order
  * - Specify multi-sampling (only 1 sample in our case)
  * - Specify color & alpha blending between draw calls
- * - Create a pipeline with all of the above + render pass(es)
- * - TODO: Specify descriptor set layouts and push constants
+ * - Specify descriptor set layouts and push constant ranges
+ * - Create a pipeline with all of the above + render pass(es), through the persistent pipeline cache
+ * - Pipelines are compiled as a batch on the thread pool (see configureQuadPipeline for the quad pipeline's description)
  */
 void initGraphicsPipeline(VulkanContext* vulkanContext)
 {
-  GraphicsPipelineBuilder(vulkanContext->device.logical)
-          .setVertexShader(POS_COLOR_TRANS_MATS_VERT_SHADER_FILE_LOC)
+  ProfileFunction();
+  TimePoint buildStart = now();
+
+  // NOTE: Pipelines that aren't needed for the first frame may be left building in the background, the future
+  // only needs to be waited on before the pipeline is first bound
+  PipelineBatch batch;
+  initPipelineBatch(vulkanContext->device.logical, vulkanContext->pipelineCache, &vulkanContext->shaderModuleCache, &vulkanContext->threadPool, &batch);
+  std::shared_future<BuiltPipeline> quadPipeline = submitPipeline(&batch, [vulkanContext](GraphicsPipelineBuilder& builder) {
+    configureQuadPipeline(vulkanContext, builder);
+  });
+  waitForPipelineBatch(&batch);
+
+  vulkanContext->graphicsPipeline = quadPipeline.get().pipeline;
+  vulkanContext->pipelineLayout = quadPipeline.get().pipelineLayout;
+  vulkanContext->pipelineCacheStats.initialBuildSeconds = secondsSince(buildStart);
+}
+
+// Serial, on the calling thread
+void buildQuadPipeline(VulkanContext* vulkanContext, VkPipelineCache pipelineCache, VkPipeline* pipeline, VkPipelineLayout* pipelineLayout)
+{
+  GraphicsPipelineBuilder builder(vulkanContext->device.logical, &vulkanContext->shaderModuleCache);
+  configureQuadPipeline(vulkanContext, builder);
+  builder.setPipelineCache(pipelineCache)
+         .build(pipeline, pipelineLayout);
+}
+
+void configureQuadPipeline(VulkanContext* vulkanContext, GraphicsPipelineBuilder& builder)
+{
+  VkDynamicState dynamicStates[] = {
+          VK_DYNAMIC_STATE_VIEWPORT,
+          VK_DYNAMIC_STATE_SCISSOR,
+          VK_DYNAMIC_STATE_CULL_MODE_EXT,
+          VK_DYNAMIC_STATE_FRONT_FACE_EXT
+  };
+  u32 dynamicStateCount = vulkanContext->device.extendedDynamicState.supported ? ArrayCount(dynamicStates) : 2;
+
+  builder.setVertexShader(POS_COLOR_TRANS_MATS_INSTANCED_VERT_SHADER_FILE_LOC)
           .setFragmentShader(VERTEX_COLOR_FRAG_SHADER_FILE_LOC)
-          .setVertexAttributes(quadPosColVertexAtt, QUAD_VERTEX_INPUT_BINDING_INDEX)
+          .setVertexAttributes(vulkanContext->vertexAtt.info, QUAD_VERTEX_INPUT_BINDING_INDEX)
+          .addVertexBinding(instanceAttDatumFormat, INSTANCE_ATT_FORMAT_COUNT, sizeof(InstanceAttDatum),
+                            INSTANCE_VERTEX_INPUT_BINDING_INDEX, VK_VERTEX_INPUT_RATE_INSTANCE, INSTANCE_ATTRIBUTE_FIRST_LOCATION)
           .setDescriptorSetLayouts(&vulkanContext->uniformBuffers.descriptorSetLayout, 1)
-          .setViewport(0.0, 0.0, 0.0, vulkanContext->windowExtent.width, vulkanContext->windowExtent.height, 1.0)
-          .setScissor(0, 0, vulkanContext->windowExtent.width, vulkanContext->windowExtent.height)
+          .setPushConstantRanges(&QUAD_PUSH_CONSTANT_RANGE, 1)
+          .setCullMode(QUAD_CULL_MODE)
+          .setFrontFace(QUAD_FRONT_FACE)
+          .setDynamicStates(dynamicStates, dynamicStateCount)
+          .setRenderPass(vulkanContext->renderPass);
+}
+
+/*
+ * - Set the scene, pushed to the fragment and compute shaders alike
+ * - Fragment mode: build RayMarchSphere.frag's pipeline once per quality, all in one batch, so that quality can be
+ *   switched without compiling anything
+ * - Compute modes: create the ray march pass's per frame resources and build its pipelines from RayMarchSphere.comp,
+ *   specialized into the tile and pixel passes at the initial quality, and the composite pipeline drawing the result
+ *   as a full screen triangle. The tile pipeline is only built with tile skipping.
+ */
+void initRayMarch(VulkanContext* vulkanContext)
+{
+  ProfileFunction();
+  VkDevice device = vulkanContext->device.logical;
+  RayMarchScene* scene = &vulkanContext->rayMarchScene;
+  scene->rayOrigin = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+  scene->sphere = glm::vec4(0.0f, 0.0f, -10.0f, 3.0f);
+  scene->planeHeight = -3.0f;
+
+  if(vulkanContext->rayMarchMode == RAY_MARCH_FRAGMENT) {
+    PipelineBatch batch;
+    initPipelineBatch(device, vulkanContext->pipelineCache, &vulkanContext->shaderModuleCache, &vulkanContext->threadPool, &batch);
+    std::shared_future<BuiltPipeline> pipelines[RAY_MARCH_QUALITY_COUNT];
+    for(u32 quality = 0; quality < RAY_MARCH_QUALITY_COUNT; ++quality) {
+      pipelines[quality] = submitPipeline(&batch, [vulkanContext, quality](GraphicsPipelineBuilder& builder) {
+        configureRayMarchFragmentPipeline(vulkanContext, (RayMarchQuality)quality, builder);
+      });
+    }
+    waitForPipelineBatch(&batch);
+    for(u32 quality = 0; quality < RAY_MARCH_QUALITY_COUNT; ++quality) {
+      vulkanContext->rayMarchFragment.pipelines[quality] = pipelines[quality].get().pipeline;
+      vulkanContext->rayMarchFragment.pipelineLayouts[quality] = pipelines[quality].get().pipelineLayout;
+    }
+    return;
+  }
+
+  RayMarchPass* rayMarch = &vulkanContext->rayMarch;
+  bool32 tileSkipping = vulkanContext->rayMarchMode == RAY_MARCH_TILED;
+  initRayMarchPass(device, &vulkanContext->memoryAllocator, vulkanContext->frameCount, tileSkipping, rayMarch);
+  if(tileSkipping) {
+    buildRayMarchTilePipeline(vulkanContext, &rayMarch->tilePipeline, &rayMarch->tilePipelineLayout);
+  }
+  buildRayMarchPixelPipeline(vulkanContext, &rayMarch->pixelPipeline, &rayMarch->pixelPipelineLayout);
+  buildRayMarchCompositePipeline(vulkanContext, &rayMarch->compositePipeline, &rayMarch->compositePipelineLayout);
+}
+
+// RayMarchSphere.comp at the current quality, the pass's descriptor set layout must exist
+void buildRayMarchTilePipeline(VulkanContext* vulkanContext, VkPipeline* pipeline, VkPipelineLayout* pipelineLayout)
+{
+  const RayMarchQualitySettings& quality = RAY_MARCH_QUALITY_SETTINGS[vulkanContext->rayMarchQuality];
+  ComputePipelineBuilder(vulkanContext->device.logical, &vulkanContext->shaderModuleCache)
+          .setComputeShader(RAY_MARCH_SPHERE_COMP_SHADER_FILE_LOC)
+          .setDescriptorSetLayouts(&vulkanContext->rayMarch.descriptorSetLayout, 1)
+          .setPushConstantRanges(&RAY_MARCH_PUSH_CONSTANT_RANGE, 1)
+          .setSpecializationConstant(RAY_MARCH_HIT_DIST_CONSTANT_ID, quality.hitDist)
+          .setSpecializationConstant(RAY_MARCH_PASS_CONSTANT_ID, RAY_MARCH_TILE_PASS)
+          .setSpecializationConstant(RAY_MARCH_TILE_SKIPPING_CONSTANT_ID, (bool32)true)
+          .setPipelineCache(vulkanContext->pipelineCache)
+          .build(pipeline, pipelineLayout);
+}
+
+void buildRayMarchPixelPipeline(VulkanContext* vulkanContext, VkPipeline* pipeline, VkPipelineLayout* pipelineLayout)
+{
+  const RayMarchQualitySettings& quality = RAY_MARCH_QUALITY_SETTINGS[vulkanContext->rayMarchQuality];
+  ComputePipelineBuilder(vulkanContext->device.logical, &vulkanContext->shaderModuleCache)
+          .setComputeShader(RAY_MARCH_SPHERE_COMP_SHADER_FILE_LOC)
+          .setDescriptorSetLayouts(&vulkanContext->rayMarch.descriptorSetLayout, 1)
+          .setPushConstantRanges(&RAY_MARCH_PUSH_CONSTANT_RANGE, 1)
+          .setSpecializationConstant(RAY_MARCH_MAX_STEPS_CONSTANT_ID, quality.maxSteps)
+          .setSpecializationConstant(RAY_MARCH_HIT_DIST_CONSTANT_ID, quality.hitDist)
+          .setSpecializationConstant(RAY_MARCH_PASS_CONSTANT_ID, RAY_MARCH_PIXEL_PASS)
+          .setSpecializationConstant(RAY_MARCH_TILE_SKIPPING_CONSTANT_ID, vulkanContext->rayMarch.tileSkipping)
+          .setPipelineCache(vulkanContext->pipelineCache)
+          .build(pipeline, pipelineLayout);
+}
+
+void buildRayMarchCompositePipeline(VulkanContext* vulkanContext, VkPipeline* pipeline, VkPipelineLayout* pipelineLayout)
+{
+  VkDynamicState dynamicStates[] = {
+          VK_DYNAMIC_STATE_VIEWPORT,
+          VK_DYNAMIC_STATE_SCISSOR
+  };
+  GraphicsPipelineBuilder(vulkanContext->device.logical, &vulkanContext->shaderModuleCache)
+          .setVertexShader(FULL_SCREEN_TRIANGLE_VERT_SHADER_FILE_LOC)
+          .setFragmentShader(RAY_MARCH_COMPOSITE_FRAG_SHADER_FILE_LOC)
+          .setPrimitiveTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+          .setDescriptorSetLayouts(&vulkanContext->rayMarch.descriptorSetLayout, 1)
+          .setCullMode(VK_CULL_MODE_NONE)
+          .setDynamicStates(dynamicStates, ArrayCount(dynamicStates))
           .setRenderPass(vulkanContext->renderPass)
-          .build(&vulkanContext->graphicsPipeline, &vulkanContext->pipelineLayout);
+          .setPipelineCache(vulkanContext->pipelineCache)
+          .build(pipeline, pipelineLayout);
+}
+
+/*
+ * - Register every pipeline built at startup with the SPIR-V files its builder is given, so that recompiling a shader
+ *   rebuilds all of the pipelines using it. Keep in sync with the configure and build functions above.
+ * - Pipelines of the ray march mode that isn't active are not built, and not registered
+ */
+void initHotReloadPipelines(VulkanContext* vulkanContext)
+{
+  std::vector<HotReloadPipeline>& pipelines = vulkanContext->shaderHotReload.pipelines;
+  pipelines.push_back({ "quad", { POS_COLOR_TRANS_MATS_INSTANCED_VERT_SHADER_FILE_LOC, VERTEX_COLOR_FRAG_SHADER_FILE_LOC },
+                        &vulkanContext->graphicsPipeline, &vulkanContext->pipelineLayout,
+                        [vulkanContext](VkPipeline* pipeline, VkPipelineLayout* pipelineLayout) {
+                          buildQuadPipeline(vulkanContext, vulkanContext->pipelineCache, pipeline, pipelineLayout);
+                        } });
+
+  if(vulkanContext->rayMarchMode == RAY_MARCH_FRAGMENT) {
+    for(u32 quality = 0; quality < RAY_MARCH_QUALITY_COUNT; ++quality) {
+      pipelines.push_back({ std::string("ray march fragment ") + RAY_MARCH_QUALITY_SETTINGS[quality].name,
+                            { FULL_SCREEN_TRIANGLE_VERT_SHADER_FILE_LOC, RAY_MARCH_SPHERE_FRAG_SHADER_FILE_LOC },
+                            &vulkanContext->rayMarchFragment.pipelines[quality], &vulkanContext->rayMarchFragment.pipelineLayouts[quality],
+                            [vulkanContext, quality](VkPipeline* pipeline, VkPipelineLayout* pipelineLayout) {
+                              GraphicsPipelineBuilder builder(vulkanContext->device.logical, &vulkanContext->shaderModuleCache);
+                              configureRayMarchFragmentPipeline(vulkanContext, (RayMarchQuality)quality, builder);
+                              builder.setPipelineCache(vulkanContext->pipelineCache)
+                                     .build(pipeline, pipelineLayout);
+                            } });
+    }
+  } else if(isComputeRayMarch(vulkanContext->rayMarchMode)) {
+    RayMarchPass* rayMarch = &vulkanContext->rayMarch;
+    if(rayMarch->tileSkipping) {
+      pipelines.push_back({ "ray march tile", { RAY_MARCH_SPHERE_COMP_SHADER_FILE_LOC },
+                            &rayMarch->tilePipeline, &rayMarch->tilePipelineLayout,
+                            [vulkanContext](VkPipeline* pipeline, VkPipelineLayout* pipelineLayout) {
+                              buildRayMarchTilePipeline(vulkanContext, pipeline, pipelineLayout);
+                            } });
+    }
+    pipelines.push_back({ "ray march pixel", { RAY_MARCH_SPHERE_COMP_SHADER_FILE_LOC },
+                          &rayMarch->pixelPipeline, &rayMarch->pixelPipelineLayout,
+                          [vulkanContext](VkPipeline* pipeline, VkPipelineLayout* pipelineLayout) {
+                            buildRayMarchPixelPipeline(vulkanContext, pipeline, pipelineLayout);
+                          } });
+    pipelines.push_back({ "ray march composite", { FULL_SCREEN_TRIANGLE_VERT_SHADER_FILE_LOC, RAY_MARCH_COMPOSITE_FRAG_SHADER_FILE_LOC },
+                          &rayMarch->compositePipeline, &rayMarch->compositePipelineLayout,
+                          [vulkanContext](VkPipeline* pipeline, VkPipelineLayout* pipelineLayout) {
+                            buildRayMarchCompositePipeline(vulkanContext, pipeline, pipelineLayout);
+                          } });
+  }
+}
+
+void configureRayMarchFragmentPipeline(VulkanContext* vulkanContext, RayMarchQuality quality, GraphicsPipelineBuilder& builder)
+{
+  VkDynamicState dynamicStates[] = {
+          VK_DYNAMIC_STATE_VIEWPORT,
+          VK_DYNAMIC_STATE_SCISSOR
+  };
+  const RayMarchQualitySettings& settings = RAY_MARCH_QUALITY_SETTINGS[quality];
+  builder.setVertexShader(FULL_SCREEN_TRIANGLE_VERT_SHADER_FILE_LOC)
+          .setFragmentShader(RAY_MARCH_SPHERE_FRAG_SHADER_FILE_LOC)
+          .setSpecializationConstant(VK_SHADER_STAGE_FRAGMENT_BIT, RAY_MARCH_MAX_STEPS_CONSTANT_ID, settings.maxSteps)
+          .setSpecializationConstant(VK_SHADER_STAGE_FRAGMENT_BIT, RAY_MARCH_HIT_DIST_CONSTANT_ID, settings.hitDist)
+          .setPrimitiveTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+          .setPushConstantRanges(&RAY_MARCH_SCENE_PUSH_CONSTANT_RANGE, 1)
+          .setCullMode(VK_CULL_MODE_NONE)
+          .setDynamicStates(dynamicStates, ArrayCount(dynamicStates))
+          .setRenderPass(vulkanContext->renderPass);
+}
+
+/*
+ * - Load the pipeline cache saved by a previous run, validated against the current device and driver
+ * - Falls back to an empty cache, which is still shared by every pipeline built this run
+ */
+void initPipelineCache(VulkanContext* vulkanContext)
+{
+  ProfileFunction();
+  if(vulkanContext->pipelineCachePath != nullptr) {
+    vulkanContext->pipelineCache = loadPipelineCache(vulkanContext->device.logical, vulkanContext->device.physical,
+                                                     vulkanContext->pipelineCachePath, &vulkanContext->pipelineCacheStats.loadedFromDisk);
+  } else {
+    VkPipelineCacheCreateInfo pipelineCacheCI{};
+    pipelineCacheCI.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    if (vkCreatePipelineCache(vulkanContext->device.logical, &pipelineCacheCI, nullAllocator, &vulkanContext->pipelineCache) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create pipeline cache!");
+    }
+  }
 }
 
 /*
  * Create a command pool that specifically utilizes our discovered specified graphics queue
- * NOTE: This command pool may not have present or transfer capabilities
+ * NOTE: Uploads record their own command buffers on the transfer queue family, see UploadQueue
  */
 void initCommandPools(VulkanContext* vulkanContext, QueueFamilyIndices queueFamilyIndices)
 {
+  ProfileFunction();
   VkCommandPoolCreateInfo commandPoolCI{};
   commandPoolCI.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
   commandPoolCI.queueFamilyIndex = queueFamilyIndices.graphics;
-  commandPoolCI.flags = 0;
+  commandPoolCI.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; // frame command buffers are re-recorded every frame
 
   if (vkCreateCommandPool(vulkanContext->device.logical, &commandPoolCI, nullAllocator, &vulkanContext->graphicsCommandPool) != VK_SUCCESS) {
     throw std::runtime_error("failed to create graphics command pool!");
   }
-
-  // TODO: transfer command pool is atually unnecessary as any queue family with VK_QUEUE_GRAPHICS_BIT or VK_QUEUE_COMPUTE_BIT
-  //  implicitly support VK_QUEUE_TRANSFER_BIT operations. Remove transferCommandPool.
-  if(queueFamilyIndices.present == queueFamilyIndices.graphics) {
-    vulkanContext->transferCommandPool = vulkanContext->graphicsCommandPool;
-    return;
-  }
-
-  commandPoolCI.queueFamilyIndex = queueFamilyIndices.present;
-  commandPoolCI.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // transfer commands are expected to be short lived
-  if (vkCreateCommandPool(vulkanContext->device.logical, &commandPoolCI, nullAllocator, &vulkanContext->transferCommandPool) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create command pool!");
-  }
 }
@@ -7,4 +7,50 @@
 
 #pragma once
 
-void runVulkanApp();
\ No newline at end of file
+#include "KuringTypes.h"
+
+// More frames in flight allows the CPU to run further ahead of the GPU (throughput) at the cost of input latency
+const u32 DEFAULT_FRAMES_IN_FLIGHT = 2;
+const u32 DEFAULT_BENCHMARK_WARMUP_FRAMES = 120;
+
+// Ray march of RayMarchSphere.frag's scene, in compute (see RayMarchPass.h) or by the fragment shader itself
+enum RayMarchMode {
+  RAY_MARCH_OFF,
+  RAY_MARCH_PER_PIXEL, // every ray marched from the camera, as RayMarchSphere.frag
+  RAY_MARCH_TILED, // coarse tile pass first, rays start at their tile's distance and empty tiles are skipped
+  RAY_MARCH_FRAGMENT // RayMarchSphere.frag drawn as a full screen triangle
+};
+
+// Step count and hit distance the ray march shaders are specialized with
+enum RayMarchQuality {
+  RAY_MARCH_QUALITY_LOW,
+  RAY_MARCH_QUALITY_MEDIUM,
+  RAY_MARCH_QUALITY_HIGH,
+  RAY_MARCH_QUALITY_COUNT
+};
+
+struct VulkanAppSettings {
+  u32 framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+  u32 resizeStormToggles = 0; // when non-zero, run the resize storm benchmark instead of the main loop
+  u32 uniformBenchmarkBlocks = 0; // when non-zero, run the uniform upload benchmark with this many blocks per frame
+  bool32 headless = false; // render offscreen without a window, surface or swap chain
+  u32 headlessFrameCount = 0; // frames rendered before exiting when headless
+  const char* outputImagePath = nullptr; // when headless, optionally write the final frame to this file (binary PPM)
+  u32 benchmarkFrames = 0; // when non-zero, run the frame time benchmark for this many measured frames
+  u32 benchmarkWarmupFrames = DEFAULT_BENCHMARK_WARMUP_FRAMES;
+  const char* benchmarkOutputPath = "benchmark.json";
+  bool32 pipelineStatistics = false; // collect pipeline statistics (ex: fragment shader invocations) alongside GPU timestamps
+  const char* profileTracePath = nullptr; // when set, profile CPU zones and write them to this file as a Chrome trace
+  const char* pipelineCachePath = "pipeline_cache.bin"; // loaded at startup and saved at shutdown, disabled when null
+  u32 pipelineCacheBenchmarkIterations = 0; // when non-zero, run the cold vs warm pipeline cache benchmark
+  u32 pipelineBatchBenchmarkCount = 0; // when non-zero, run the serial vs batched pipeline compilation benchmark
+  const char* shaderHotReloadDirectory = nullptr; // when set, recompile shaders changed in this GLSL source directory and rebuild their pipelines
+  const char* meshPath = nullptr; // when set, draw this .kmesh file (see tools/MeshImporter) instead of the quad
+  u32 instanceCount = 1; // copies of the quad or mesh laid out on a grid, drawn with instanced draws
+  u32 recordingThreadCount = 0; // when non-zero, every instance is its own draw, recorded in parallel into this many secondary command buffers
+  u32 indirectDrawBenchmarkObjects = 0; // when non-zero, run the direct vs indirect draw recording benchmark up to this many objects
+  RayMarchMode rayMarchMode = RAY_MARCH_OFF; // when on, the ray marched scene is drawn behind the quad
+  RayMarchQuality rayMarchQuality = RAY_MARCH_QUALITY_MEDIUM; // initial quality, switched with 1, 2 and 3 in fragment mode
+};
+
+void runVulkanApp(const VulkanAppSettings& settings);
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "VulkanUtil.h"
 
+#include <string.h>
+#include <stdexcept>
+
 bool32 findQueueFamilies(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, QueueFamilyIndices* queueFamilyIndices) {
   u32 queueFamilyCount = 0;
   vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
@@ -10,8 +13,9 @@ bool32 findQueueFamilies(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice,
   bool32 present = false;
   bool32 graphics = false;
   bool32 transfer = false;
+  bool32 compute = false;
   for (u32 i = 0; i < queueFamilyCount; ++i) {
-    if(!present) {
+    if(!present && surface != VK_NULL_HANDLE) {
       VkBool32 supportsPresentation = VK_FALSE;
       vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &supportsPresentation);
       if (supportsPresentation) {
@@ -25,14 +29,171 @@ bool32 findQueueFamilies(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice,
       graphics = true;
     }
 
-    if (!transfer && (queueFamilies[i].queueFlags & VK_QUEUE_TRANSFER_BIT)) {
+    // Prefer a transfer only family (usually backed by dedicated DMA engines), so uploads run alongside rendering
+    const VkQueueFlags transferOnlyExcludedFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+    if (!transfer && (queueFamilies[i].queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamilies[i].queueFlags & transferOnlyExcludedFlags)) {
       queueFamilyIndices->transfer = i;
       transfer = true;
     }
 
-    if(present && graphics && transfer) { break; }
+    // Prefer a compute family without graphics, so that compute work may run asynchronously alongside rendering
+    if (!compute && (queueFamilies[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+      queueFamilyIndices->compute = i;
+      compute = true;
+    }
+
+    if(present && graphics && transfer && compute) { break; }
+  }
+
+  // Otherwise share the graphics family, the spec guarantees a family supporting both graphics and compute when any
+  // family supports graphics, but not that it is the first graphics family
+  if(!compute && graphics && (queueFamilies[queueFamilyIndices->graphics].queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+    queueFamilyIndices->compute = queueFamilyIndices->graphics;
+    compute = true;
+  }
+  for (u32 i = 0; !compute && i < queueFamilyCount; ++i) {
+    if (queueFamilies[i].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+      queueFamilyIndices->compute = i;
+      compute = true;
+    }
+  }
+
+  // Graphics queues implicitly support transfer operations
+  if(!transfer && graphics) {
+    queueFamilyIndices->transfer = queueFamilyIndices->graphics;
+    transfer = true;
+  }
+
+  // Without a surface (headless), nothing is presented and the graphics queue stands in for the present queue
+  if(surface == VK_NULL_HANDLE && graphics) {
+    queueFamilyIndices->present = queueFamilyIndices->graphics;
+    present = true;
   }
 
   delete[] queueFamilies;
-  return present && graphics && transfer;
-}
\ No newline at end of file
+  return present && graphics && transfer && compute;
+}
+
+bool32 isDeviceExtensionSupported(VkPhysicalDevice physicalDevice, const char* extensionName) {
+  u32 extensionCount;
+  vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+  VkExtensionProperties* availableExtensions = new VkExtensionProperties[extensionCount];
+  vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions);
+
+  bool32 supported = false;
+  for(u32 i = 0; i < extensionCount; ++i) {
+    if(strcmp(extensionName, availableExtensions[i].extensionName) == 0) {
+      supported = true;
+      break;
+    }
+  }
+
+  delete[] availableExtensions;
+  return supported;
+}
+
+bool32 isTimelineSemaphoreSupported(VkPhysicalDevice physicalDevice) {
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  if(properties.apiVersion < VK_API_VERSION_1_2) {
+    return false;
+  }
+
+  VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures{};
+  timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+  VkPhysicalDeviceFeatures2 features2{};
+  features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features2.pNext = &timelineSemaphoreFeatures;
+  vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+  return timelineSemaphoreFeatures.timelineSemaphore;
+}
+
+// This function is used to request a device memory type that supports all the property flags we request (e.g. device local, host visible)
+// Upon success it will return the index of the memory type that fits our requested memory properties
+// This is necessary as implementations can offer an arbitrary number of memory types with different
+// memory properties.
+// You can check http://vulkan.gpuinfo.org/ for details on different memory configurations
+u32 getMemoryTypeIndex(VkPhysicalDeviceMemoryProperties const* deviceMemoryProperties, u32 memoryTypeBits, VkMemoryPropertyFlags properties)
+{
+    // Iterate over all memory types available for the device used in this example
+    for (u32 i = 0; i < deviceMemoryProperties->memoryTypeCount; i++)
+    {
+        // memoryTypeBits is a bitmask and contains one bit set for every supported memory type for the resource.
+        // Bit i is set if and only if the memory type i in the VkPhysicalDeviceMemoryProperties structure for
+        // the physical device is supported for the resource.
+        if ((memoryTypeBits & (1 << i)) != 0)
+        {
+            if ((deviceMemoryProperties->memoryTypes[i].propertyFlags & properties) == properties)
+            {
+                return i;
+            }
+        }
+    }
+
+    throw "Could not find a suitable memory type!";
+}
+
+void setSpecializationConstantBits(SpecializationConstants* constants, u32 constantId, u32 bits) {
+  for(u32 i = 0; i < constants->count; ++i) {
+    if(constants->entries[i].constantID == constantId) {
+      constants->data[i] = bits;
+      return;
+    }
+  }
+  if(constants->count == MAX_SPECIALIZATION_CONSTANTS) {
+    throw std::runtime_error("too many specialization constants!");
+  }
+  u32 index = constants->count++;
+  constants->entries[index].constantID = constantId;
+  constants->entries[index].offset = index * sizeof(u32);
+  constants->entries[index].size = sizeof(u32);
+  constants->data[index] = bits;
+}
+
+VkSpecializationInfo specializationInfo(const SpecializationConstants& constants) {
+  VkSpecializationInfo info;
+  info.mapEntryCount = constants.count;
+  info.pMapEntries = constants.entries;
+  info.dataSize = constants.count * sizeof(u32);
+  info.pData = constants.data;
+  return info;
+}
+
+void cmdDispatchThreads(VkCommandBuffer commandBuffer, u32 threadCountX, u32 threadCountY, u32 threadCountZ,
+                        u32 groupSizeX, u32 groupSizeY, u32 groupSizeZ) {
+  vkCmdDispatch(commandBuffer, dispatchGroupCount(threadCountX, groupSizeX), dispatchGroupCount(threadCountY, groupSizeY),
+                dispatchGroupCount(threadCountZ, groupSizeZ));
+}
+
+void cmdBufferBarrier(VkCommandBuffer commandBuffer, VkBuffer buffer, VkPipelineStageFlags srcStageMask, VkAccessFlags srcAccessMask,
+                      VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask) {
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = srcAccessMask;
+  barrier.dstAccessMask = dstAccessMask;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = buffer;
+  barrier.offset = 0;
+  barrier.size = VK_WHOLE_SIZE;
+  vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void cmdImageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                     VkPipelineStageFlags srcStageMask, VkAccessFlags srcAccessMask, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask) {
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = srcAccessMask;
+  barrier.dstAccessMask = dstAccessMask;
+  barrier.oldLayout = oldLayout;
+  barrier.newLayout = newLayout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+  vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
@@ -1,12 +1,83 @@
 #pragma once
 
 #include <vulkan/vulkan_core.h>
+#include <string.h>
 #include "KuringTypes.h"
 
+// VkPhysicalDeviceLimits::maxPushConstantsSize is guaranteed to be at least 128 bytes on every implementation
+const u32 MIN_GUARANTEED_PUSH_CONSTANTS_SIZE = 128;
+const u32 MAX_SPECIALIZATION_CONSTANTS = 16;
+
 struct QueueFamilyIndices {
   u32 graphics;
   u32 present;
   u32 transfer;
+  u32 compute; // a compute only family when available (async compute), the graphics family otherwise
+};
+
+bool32 findQueueFamilies(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, QueueFamilyIndices* queueFamilyIndices);
+bool32 isDeviceExtensionSupported(VkPhysicalDevice physicalDevice, const char* extensionName);
+bool32 isTimelineSemaphoreSupported(VkPhysicalDevice physicalDevice);
+u32 getMemoryTypeIndex(VkPhysicalDeviceMemoryProperties const* deviceMemoryProperties, u32 memoryTypeBits, VkMemoryPropertyFlags properties);
+
+// Small per draw data (ex: model matrix) is sent with vkCmdPushConstants, avoiding uniform buffer writes and descriptor
+// set binds per draw. Types that don't fit in the guaranteed push constant size fail to compile and belong in a
+// uniform buffer instead.
+template<typename T>
+VkPushConstantRange pushConstantRange(VkShaderStageFlags stageFlags, u32 offset = 0) {
+  static_assert(sizeof(T) % 4 == 0, "push constant size must be a multiple of 4");
+  static_assert(sizeof(T) <= MIN_GUARANTEED_PUSH_CONSTANTS_SIZE, "push constants too large, use a uniform buffer");
+  VkPushConstantRange range;
+  range.stageFlags = stageFlags;
+  range.offset = offset;
+  range.size = sizeof(T);
+  return range;
+}
+
+template<typename T>
+void cmdPushConstants(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const VkPushConstantRange& range, const T& data) {
+  Assert(range.size == sizeof(T));
+  vkCmdPushConstants(commandBuffer, pipelineLayout, range.stageFlags, range.offset, range.size, &data);
+}
+
+// Specialization constants (layout(constant_id = N) const ...) fixed when a pipeline is built, so that the driver
+// compiles the shader with them as true constants (ex: fully unrolled loops). Every constant is 4 bytes: int, uint,
+// float or bool (VkBool32) in GLSL.
+struct SpecializationConstants {
+  VkSpecializationMapEntry entries[MAX_SPECIALIZATION_CONSTANTS];
+  u32 data[MAX_SPECIALIZATION_CONSTANTS];
+  u32 count;
 };
 
-bool32 findQueueFamilies(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, QueueFamilyIndices* queueFamilyIndices);
\ No newline at end of file
+// Replaces the constant's value if it was already set, throws when out of room
+void setSpecializationConstantBits(SpecializationConstants* constants, u32 constantId, u32 bits);
+// NOTE: Points into constants, which must outlive the returned info
+VkSpecializationInfo specializationInfo(const SpecializationConstants& constants);
+
+template<typename T>
+void setSpecializationConstant(SpecializationConstants* constants, u32 constantId, T value) {
+  static_assert(sizeof(T) == 4, "specialization constants must be 4 byte int, uint, float or bool32");
+  u32 bits;
+  memcpy(&bits, &value, sizeof(bits));
+  setSpecializationConstantBits(constants, constantId, bits);
+}
+
+// Workgroups needed to cover threadCount invocations with groupSize invocations per group
+inline u32 dispatchGroupCount(u32 threadCount, u32 groupSize) {
+  return (threadCount + groupSize - 1) / groupSize;
+}
+
+// Dispatches enough groups of the bound compute pipeline (local size groupSizeX * groupSizeY * groupSizeZ) to cover
+// threadCountX * threadCountY * threadCountZ invocations. Shaders must discard out of range invocations.
+void cmdDispatchThreads(VkCommandBuffer commandBuffer, u32 threadCountX, u32 threadCountY, u32 threadCountZ,
+                        u32 groupSizeX, u32 groupSizeY, u32 groupSizeZ);
+
+// Execution and memory dependency making srcAccessMask writes in srcStageMask available and visible to dstAccessMask
+// in dstStageMask (ex: COMPUTE_SHADER/SHADER_WRITE -> FRAGMENT_SHADER/SHADER_READ).
+// NOTE: Only orders work within a queue family, exclusive resources handed to another family (ex: the async compute
+// queue) also need a release/acquire ownership transfer, see UploadQueue
+void cmdBufferBarrier(VkCommandBuffer commandBuffer, VkBuffer buffer, VkPipelineStageFlags srcStageMask, VkAccessFlags srcAccessMask,
+                      VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask);
+// Same as cmdBufferBarrier for every mip level and layer of a color image, also transitioning its layout
+void cmdImageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                     VkPipelineStageFlags srcStageMask, VkAccessFlags srcAccessMask, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask);
@@ -7,12 +7,122 @@
 
 #include <stdexcept>
 #include <iostream>
+#include <string.h>
+#include <stdlib.h>
 
 #include "VulkanApp.h"
 
-int main() {
+/*
+ * Supported arguments:
+ *    --frames-in-flight <count>
+ *    --resize-storm <toggle count>
+ *    --uniform-benchmark <blocks per frame>
+ *    --headless <frame count>, not with --resize-storm or the pipeline, indirect draw and uniform benchmarks
+ *    --output <image path (.ppm)>, with --headless only
+ *    --benchmark <measured frame count>
+ *    --benchmark-warmup <warm-up frame count>
+ *    --benchmark-output <results path (.json)>
+ *    --pipeline-statistics
+ *    --profile <trace path (.json)>
+ *    --pipeline-cache <cache path>
+ *    --no-pipeline-cache
+ *    --pipeline-cache-benchmark <iterations>
+ *    --pipeline-batch-benchmark <pipeline count>
+ *    --shader-hot-reload <shader source directory>
+ *    --mesh <mesh path (.kmesh)>
+ *    --instances <instance count>
+ *    --indirect-draw-benchmark <max object count>
+ *    --recording-threads <thread count>
+ *    --ray-march <per-pixel | tiled | fragment>
+ *    --ray-march-quality <low | medium | high>
+ */
+void parseArguments(int argc, char** argv, VulkanAppSettings* settings) {
+    for(int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        bool hasValue = (i + 1) < argc;
+        if(strcmp(arg, "--frames-in-flight") == 0 && hasValue) {
+            settings->framesInFlight = (u32)strtoul(argv[++i], nullptr, 10);
+        } else if(strcmp(arg, "--resize-storm") == 0 && hasValue) {
+            settings->resizeStormToggles = (u32)strtoul(argv[++i], nullptr, 10);
+        } else if(strcmp(arg, "--uniform-benchmark") == 0 && hasValue) {
+            settings->uniformBenchmarkBlocks = (u32)strtoul(argv[++i], nullptr, 10);
+        } else if(strcmp(arg, "--headless") == 0 && hasValue) {
+            settings->headless = true;
+            settings->headlessFrameCount = (u32)strtoul(argv[++i], nullptr, 10);
+        } else if(strcmp(arg, "--output") == 0 && hasValue) {
+            settings->outputImagePath = argv[++i];
+        } else if(strcmp(arg, "--benchmark") == 0 && hasValue) {
+            settings->benchmarkFrames = (u32)strtoul(argv[++i], nullptr, 10);
+        } else if(strcmp(arg, "--benchmark-warmup") == 0 && hasValue) {
+            settings->benchmarkWarmupFrames = (u32)strtoul(argv[++i], nullptr, 10);
+        } else if(strcmp(arg, "--benchmark-output") == 0 && hasValue) {
+            settings->benchmarkOutputPath = argv[++i];
+        } else if(strcmp(arg, "--pipeline-statistics") == 0) {
+            settings->pipelineStatistics = true;
+        } else if(strcmp(arg, "--profile") == 0 && hasValue) {
+            settings->profileTracePath = argv[++i];
+        } else if(strcmp(arg, "--pipeline-cache") == 0 && hasValue) {
+            settings->pipelineCachePath = argv[++i];
+        } else if(strcmp(arg, "--no-pipeline-cache") == 0) {
+            settings->pipelineCachePath = nullptr;
+        } else if(strcmp(arg, "--pipeline-cache-benchmark") == 0 && hasValue) {
+            settings->pipelineCacheBenchmarkIterations = (u32)strtoul(argv[++i], nullptr, 10);
+        } else if(strcmp(arg, "--pipeline-batch-benchmark") == 0 && hasValue) {
+            settings->pipelineBatchBenchmarkCount = (u32)strtoul(argv[++i], nullptr, 10);
+        } else if(strcmp(arg, "--shader-hot-reload") == 0 && hasValue) {
+            settings->shaderHotReloadDirectory = argv[++i];
+        } else if(strcmp(arg, "--mesh") == 0 && hasValue) {
+            settings->meshPath = argv[++i];
+        } else if(strcmp(arg, "--instances") == 0 && hasValue) {
+            settings->instanceCount = (u32)strtoul(argv[++i], nullptr, 10);
+        } else if(strcmp(arg, "--indirect-draw-benchmark") == 0 && hasValue) {
+            settings->indirectDrawBenchmarkObjects = (u32)strtoul(argv[++i], nullptr, 10);
+        } else if(strcmp(arg, "--recording-threads") == 0 && hasValue) {
+            settings->recordingThreadCount = (u32)strtoul(argv[++i], nullptr, 10);
+        } else if(strcmp(arg, "--ray-march") == 0 && hasValue) {
+            const char* mode = argv[++i];
+            if(strcmp(mode, "per-pixel") == 0) {
+                settings->rayMarchMode = RAY_MARCH_PER_PIXEL;
+            } else if(strcmp(mode, "tiled") == 0) {
+                settings->rayMarchMode = RAY_MARCH_TILED;
+            } else if(strcmp(mode, "fragment") == 0) {
+                settings->rayMarchMode = RAY_MARCH_FRAGMENT;
+            } else {
+                throw std::runtime_error(std::string("unrecognized ray march mode: ") + mode);
+            }
+        } else if(strcmp(arg, "--ray-march-quality") == 0 && hasValue) {
+            const char* quality = argv[++i];
+            if(strcmp(quality, "low") == 0) {
+                settings->rayMarchQuality = RAY_MARCH_QUALITY_LOW;
+            } else if(strcmp(quality, "medium") == 0) {
+                settings->rayMarchQuality = RAY_MARCH_QUALITY_MEDIUM;
+            } else if(strcmp(quality, "high") == 0) {
+                settings->rayMarchQuality = RAY_MARCH_QUALITY_HIGH;
+            } else {
+                throw std::runtime_error(std::string("unrecognized ray march quality: ") + quality);
+            }
+        } else {
+            throw std::runtime_error(std::string("unrecognized argument: ") + arg);
+        }
+    }
+    if(settings->outputImagePath != nullptr && !settings->headless) {
+        throw std::runtime_error("--output requires --headless");
+    }
+    // runVulkanApp gives headless runs precedence, these would silently never run
+    bool32 skippedWhenHeadless = settings->resizeStormToggles > 0 || settings->pipelineBatchBenchmarkCount > 0 ||
+                                 settings->pipelineCacheBenchmarkIterations > 0 || settings->indirectDrawBenchmarkObjects > 0 ||
+                                 settings->uniformBenchmarkBlocks > 0;
+    if(settings->headless && skippedWhenHeadless) {
+        throw std::runtime_error("--headless can't be combined with --resize-storm, --pipeline-batch-benchmark, "
+                                 "--pipeline-cache-benchmark, --indirect-draw-benchmark or --uniform-benchmark");
+    }
+}
+
+int main(int argc, char** argv) {
     try {
-        runVulkanApp();
+        VulkanAppSettings settings;
+        parseArguments(argc, argv, &settings);
+        runVulkanApp(settings);
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
         return EXIT_FAILURE;
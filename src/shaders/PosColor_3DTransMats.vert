@@ -10,14 +10,18 @@ layout (location = 1) in vec3 inColor;
 
 // uniform buffer objects
 layout (set = 0, binding = 0) uniform TransMats {
-  mat4 model;
   mat4 view;
   mat4 proj;
 } transMats;
 
+// push constants
+layout (push_constant) uniform ModelPushConstants {
+  mat4 model;
+} modelPushConstants;
+
 void main() {
   // Note that each of the output values will be linearly
   // interpolated when they reach the fragment shader
-  gl_Position = transMats.proj * transMats.view * transMats.model * vec4(inPos, 1.0);
+  gl_Position = transMats.proj * transMats.view * modelPushConstants.model * vec4(inPos, 1.0);
   fragColor = inColor;
 }
\ No newline at end of file
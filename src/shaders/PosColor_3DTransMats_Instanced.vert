@@ -0,0 +1,32 @@
+#version 450
+
+// out variables
+// NOTE: Out variables are linearly interpolated between vertices
+layout(location = 0) out vec3 fragColor;
+
+// vertex attributes
+layout (location = 0) in vec3 inPos;
+layout (location = 1) in vec3 inColor;
+
+// instance attributes (InstanceAttDatum), first location must match INSTANCE_ATTRIBUTE_FIRST_LOCATION
+// NOTE: A mat4 input takes one location per column
+layout (location = 4) in mat4 instanceModel;
+layout (location = 8) in vec4 instanceColor;
+
+// uniform buffer objects
+layout (set = 0, binding = 0) uniform TransMats {
+  mat4 view;
+  mat4 proj;
+} transMats;
+
+// push constants
+layout (push_constant) uniform ModelPushConstants {
+  mat4 model;
+} modelPushConstants;
+
+void main() {
+  // The push constant model matrix is shared by every instance (mesh space to instance space), each instance is then
+  // placed in the world by its own matrix
+  gl_Position = transMats.proj * transMats.view * instanceModel * modelPushConstants.model * vec4(inPos, 1.0);
+  fragColor = inColor * instanceColor.rgb;
+}
@@ -0,0 +1,12 @@
+#version 450
+
+layout(location = 0) out vec4 outColor;
+
+// written by RayMarchSphere.comp, same extent as the framebuffer
+layout(set = 0, binding = 0, rgba8) uniform readonly image2D rayMarchImage;
+
+void main() {
+  vec4 color = imageLoad(rayMarchImage, ivec2(gl_FragCoord.xy));
+  if (color.a == 0.0) discard; // missed, keep the clear color
+  outColor = color;
+}
@@ -1,22 +1,24 @@
 #version 450
 
+// Sphere over a plane, sphere traced per fragment of a full screen triangle (see FullScreenTriangle.vert)
+
+// Quality, fixed per pipeline so that the driver can unroll the march for the chosen variant
+layout(constant_id = 0) const int MAX_STEPS = 30;
+layout(constant_id = 1) const float HIT_DIST = 0.01;
+
 layout(location = 0) out vec4 outColor;
 
-layout(location = 0) in vec3 fragColor;
+layout(push_constant) uniform Scene {
+  vec4 rayOrigin; // xyz, the camera looks down -z with y up
+  vec4 sphere; // xyz center, w radius
+  vec2 resolution; // of the viewport, in pixels
+  float planeHeight;
+} scene;
 
-#define MAX_STEPS 30
-#define HIT_DIST 0.01
 #define MISS_DIST 200.0
-#define MISS 120012
 
-const vec3 rayOrigin = vec3(0.0, 0.0, 0.0);
-const vec3 sphereCenter = vec3(0.0, 0.0, -10.0);
-const float sphereRadius = 3.0;
 const vec3 sphereColor = vec3(1.0, 0.15, 0.5);
-const float planeHeight = -3.0;
 const vec3 planeColor = vec3(0.3, 0.5, 1.0);
-const vec3 missColor = vec3(0.0, 0.0, 0.0);
-const vec2 viewPortResolution = vec2(1200, 1200);
 
 float sdXZPlane(vec3 rayPosition, float planeHeight) {
   return abs(rayPosition.y - planeHeight);
@@ -26,44 +28,39 @@ float sdSphere(vec3 rayPosition) {
   return length(rayPosition) - 1.0;
 }
 
-void scene(vec3 rayOrigin, vec3 rayDir, out vec3 color, out float iterations) {
-  float distanceTraveled = 0;
-  float sphereDist;
-  float planeDist;
-  color = missColor;
+// Returns false when the ray misses, otherwise the color of the surface hit and the steps taken to reach it
+bool march(vec3 rayPosition, vec3 rayDir, out vec3 color, out int steps) {
+  float distanceTraveled = 0.0;
+  color = vec3(0.0);
 
-  iterations = 0;
-  for (int; iterations < MAX_STEPS; ++iterations) {
-    sphereDist = sdSphere((rayOrigin - sphereCenter) / sphereRadius) * sphereRadius;
-    planeDist = sdXZPlane(rayOrigin, planeHeight);
+  for (steps = 0; steps < MAX_STEPS; ++steps) {
+    float sphereDist = sdSphere((rayPosition - scene.sphere.xyz) / scene.sphere.w) * scene.sphere.w;
+    float planeDist = sdXZPlane(rayPosition, scene.planeHeight);
     float distance = min(sphereDist, planeDist);
     if (distance < HIT_DIST) {
       color = sphereDist < planeDist ? sphereColor : planeColor;
-      return;
+      return true;
     }
-    rayOrigin += distance * rayDir;
+    rayPosition += distance * rayDir;
     distanceTraveled += distance;
     if (distanceTraveled > MISS_DIST) {
-      iterations = MISS;
-      return;
+      return false;
     }
   }
-  iterations = MISS;
-  return;
+  return false;
 }
 
 void main() {
   // Move (0,0) from top left to center
-  // Coordinate system goes from [-viewPortResolution / 2, viewPortResolution / 2]
-  vec2 pixelCoord = gl_FragCoord.xy-0.5*viewPortResolution.xy;
-  float pixelWidth = 1.0 / viewPortResolution.y;
+  // Coordinate system goes from [-resolution / 2, resolution / 2]
+  vec2 pixelCoord = gl_FragCoord.xy - 0.5 * scene.resolution;
+  float pixelWidth = 1.0 / scene.resolution.y;
   // Scale y value to [-0.5, 0.5], scale x by same factor, flip y to have positive values going up
   pixelCoord = vec2(pixelCoord.x, -pixelCoord.y) * pixelWidth;
   vec3 rayDir = normalize(vec3(pixelCoord, -1.0));
 
   vec3 color;
-  float iterations;
-  scene(rayOrigin, rayDir, color, iterations);
-  if (iterations == MISS) discard;
-  outColor = vec4(color * (1.0 - (iterations / MAX_STEPS)), 1.0);
-}
\ No newline at end of file
+  int steps;
+  if (!march(scene.rayOrigin.xyz, rayDir, color, steps)) discard;
+  outColor = vec4(color * (1.0 - (float(steps) / float(MAX_STEPS))), 1.0);
+}
@@ -0,0 +1,244 @@
+// Checks the encodings of VertexQuantization.h against exact expected values and their measured error against
+// quantizationErrorBounds, over synthetic vertices covering the edge cases of each encoding.
+// Returns a non-zero exit code if any check fails.
+
+#include "VertexQuantization.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+internal_access u32 failureCount = 0;
+
+#define CHECK(condition, ...) \
+  do { \
+    if (!(condition)) { \
+      ++failureCount; \
+      printf("%s:%d: check failed: %s: ", __FILE__, __LINE__, #condition); \
+      printf(__VA_ARGS__); \
+      printf("\n"); \
+    } \
+  } while (0)
+
+internal_access f32 bitsToFloat(u32 bits) {
+  f32 value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+internal_access void testHalfEncoding() {
+  struct { f32 value; u16 expected; } cases[] = {
+    { 0.0f, 0x0000 },
+    { -0.0f, 0x8000 },
+    { 1.0f, 0x3c00 },
+    { -2.0f, 0xc000 },
+    { 65504.0f, 0x7bff }, // largest half
+    { 65519.0f, 0x7bff }, // below the halfway point to 65536
+    { 65520.0f, 0x7c00 }, // halfway, rounds to even: infinity
+    { 1.0e6f, 0x7c00 }, // overflow
+    { -1.0e6f, 0xfc00 },
+    { INFINITY, 0x7c00 },
+    { -INFINITY, 0xfc00 },
+    { ldexpf(1.0f, -14), 0x0400 }, // smallest normal
+    { ldexpf(1.0f, -24), 0x0001 }, // smallest subnormal
+    { ldexpf(1.0f, -25), 0x0000 }, // halfway to the smallest subnormal, rounds to even: zero
+    { ldexpf(1.5f, -25), 0x0001 }, // above halfway
+    { ldexpf(3.0f, -25), 0x0002 }, // halfway between 1 and 2 subnormal ulps, rounds to even
+    { ldexpf(5.0f, -25), 0x0002 }, // halfway between 2 and 3 subnormal ulps, rounds to even
+    { ldexpf(1023.5f, -24), 0x0400 }, // largest subnormal rounds up into the smallest normal
+    { ldexpf(1.0f, -26), 0x0000 }, // underflow
+    { -ldexpf(1.0f, -24), 0x8001 },
+    { 1.0f + ldexpf(1.0f, -11), 0x3c00 }, // halfway between 1 and its successor, rounds to even
+    { 1.0f + ldexpf(3.0f, -11), 0x3c02 }, // halfway between odd and even mantissas, rounds to even
+    { 1.0f + ldexpf(1.0f, -11) + ldexpf(1.0f, -20), 0x3c01 }, // just above halfway
+  };
+  for (const auto& c : cases) {
+    u16 encoded = encodeHalf(c.value);
+    CHECK(encoded == c.expected, "encodeHalf(%a) = 0x%04x, expected 0x%04x", c.value, encoded, c.expected);
+  }
+
+  u16 nan = encodeHalf(bitsToFloat(0x7fc00000));
+  CHECK((nan & 0x7c00) == 0x7c00 && (nan & 0x3ff) != 0, "encodeHalf(NaN) = 0x%04x is not a NaN", nan);
+
+  // Every finite half round trips exactly
+  for (u32 half = 0; half <= 0xffff; ++half) {
+    if ((half & 0x7c00) == 0x7c00) {
+      continue;
+    }
+    f32 decoded = decodeHalf((u16)half);
+    u16 encoded = encodeHalf(decoded);
+    CHECK(encoded == half, "half 0x%04x decodes to %a, which encodes to 0x%04x", half, decoded, encoded);
+  }
+}
+
+internal_access void testSnorm16Encoding() {
+  CHECK(encodeSnorm16(1.0f) == 32767, "%d", encodeSnorm16(1.0f));
+  CHECK(encodeSnorm16(-1.0f) == -32767, "%d", encodeSnorm16(-1.0f));
+  CHECK(encodeSnorm16(2.0f) == 32767, "out of range values clamp, got %d", encodeSnorm16(2.0f));
+  CHECK(encodeSnorm16(-2.0f) == -32767, "out of range values clamp, got %d", encodeSnorm16(-2.0f));
+  CHECK(encodeSnorm16(0.0f) == 0, "%d", encodeSnorm16(0.0f));
+  CHECK(decodeSnorm16(32767) == 1.0f, "%a", decodeSnorm16(32767));
+  CHECK(decodeSnorm16(-32767) == -1.0f, "%a", decodeSnorm16(-32767));
+  CHECK(decodeSnorm16(-32768) == -1.0f, "-32768 decodes to -1, got %a", decodeSnorm16(-32768));
+
+  const u32 steps = 100000;
+  f32 maxError = 0.0f;
+  for (u32 i = 0; i <= steps; ++i) {
+    f32 value = -1.0f + 2.0f * i / steps;
+    maxError = fmaxf(maxError, fabsf(decodeSnorm16(encodeSnorm16(value)) - value));
+  }
+  CHECK(maxError <= 0.5f / 32767.0f + 1.0e-7f, "SNORM16 round trip error %g", maxError);
+}
+
+// Measured error of the vertices, quantized within their own bounds, must not exceed the bounds' error bounds
+internal_access void checkVertices(const char* name, const std::vector<PosColNormVertexAttDatum>& vertices,
+                                   PositionQuantization quantization) {
+  f32 boundsMin[3] = { INFINITY, INFINITY, INFINITY };
+  f32 boundsMax[3] = { -INFINITY, -INFINITY, -INFINITY };
+  for (const PosColNormVertexAttDatum& vertex : vertices) {
+    for (u32 axis = 0; axis < 3; ++axis) {
+      boundsMin[axis] = fminf(boundsMin[axis], vertex.position[axis]);
+      boundsMax[axis] = fmaxf(boundsMax[axis], vertex.position[axis]);
+    }
+  }
+
+  PositionDequantization dequantization = computePositionDequantization(quantization, boundsMin, boundsMax);
+  std::vector<QuantizedVertexAttDatum> quantized(vertices.size());
+  quantizeVertices(vertices.data(), (u32)vertices.size(), quantization, dequantization, quantized.data());
+  QuantizationError error = measureQuantizationError(vertices.data(), quantized.data(), (u32)vertices.size(), quantization, dequantization);
+  QuantizationError bounds = quantizationErrorBounds(quantization, boundsMin, boundsMax);
+
+  const char* quantizationName = quantization == POSITION_QUANTIZATION_SNORM16 ? "snorm16" : "float16";
+  CHECK(error.position <= bounds.position, "%s, %s: position error %g exceeds %g", name, quantizationName, error.position, bounds.position);
+  CHECK(error.color <= bounds.color, "%s, %s: color error %g exceeds %g", name, quantizationName, error.color, bounds.color);
+  CHECK(error.normal <= bounds.normal, "%s, %s: normal error %g exceeds %g", name, quantizationName, error.normal, bounds.normal);
+}
+
+internal_access PosColNormVertexAttDatum makeVertex(f32 x, f32 y, f32 z) {
+  PosColNormVertexAttDatum vertex = {};
+  vertex.position[0] = x;
+  vertex.position[1] = y;
+  vertex.position[2] = z;
+  vertex.normal[2] = 1.0f;
+  return vertex;
+}
+
+// Grid over the box, corners and faces included, plus pseudo random points inside it
+internal_access std::vector<PosColNormVertexAttDatum> boxVertices(const f32 boundsMin[3], const f32 boundsMax[3]) {
+  std::vector<PosColNormVertexAttDatum> vertices;
+  const u32 gridSteps = 16;
+  for (u32 i = 0; i <= gridSteps; ++i) {
+    for (u32 j = 0; j <= gridSteps; ++j) {
+      for (u32 k = 0; k <= gridSteps; ++k) {
+        u32 steps[3] = { i, j, k };
+        f32 position[3];
+        for (u32 axis = 0; axis < 3; ++axis) {
+          position[axis] = boundsMin[axis] + (boundsMax[axis] - boundsMin[axis]) * steps[axis] / gridSteps;
+        }
+        vertices.push_back(makeVertex(position[0], position[1], position[2]));
+      }
+    }
+  }
+  u32 state = 12345;
+  for (u32 i = 0; i < 10000; ++i) {
+    f32 position[3];
+    for (u32 axis = 0; axis < 3; ++axis) {
+      state = state * 1664525u + 1013904223u;
+      f32 t = (state >> 8) / 16777216.0f;
+      position[axis] = boundsMin[axis] + (boundsMax[axis] - boundsMin[axis]) * t;
+    }
+    vertices.push_back(makeVertex(position[0], position[1], position[2]));
+  }
+  return vertices;
+}
+
+internal_access void testPositions() {
+  struct { const char* name; f32 boundsMin[3]; f32 boundsMax[3]; } boxes[] = {
+    { "unit cube", { -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f } },
+    { "off center", { 1000.0f, -20.0f, 5.0f }, { 1010.0f, 30.0f, 5.5f } },
+    { "large", { -5000.0f, -5000.0f, -5000.0f }, { 5000.0f, 5000.0f, 5000.0f } },
+    { "tiny", { -1.0e-4f, -1.0e-4f, -1.0e-4f }, { 1.0e-4f, 1.0e-4f, 1.0e-4f } }, // float16 subnormals
+    { "flat", { -3.0f, 2.0f, -3.0f }, { 3.0f, 2.0f, 3.0f } }, // zero extent axis
+  };
+  for (const auto& box : boxes) {
+    std::vector<PosColNormVertexAttDatum> vertices = boxVertices(box.boundsMin, box.boundsMax);
+    checkVertices(box.name, vertices, POSITION_QUANTIZATION_SNORM16);
+    checkVertices(box.name, vertices, POSITION_QUANTIZATION_FLOAT16);
+  }
+}
+
+internal_access void testColors() {
+  std::vector<PosColNormVertexAttDatum> vertices;
+  f32 values[] = { 0.0f, 1.0f, -0.5f, 1.5f, 0.5f / 255.0f, 1.5f / 255.0f, 254.5f / 255.0f, 0.5f };
+  for (f32 value : values) {
+    PosColNormVertexAttDatum vertex = makeVertex(0.0f, 0.0f, 0.0f);
+    vertex.color[0] = value;
+    vertex.color[1] = 1.0f - value;
+    vertex.color[2] = value * 0.5f;
+    vertices.push_back(vertex);
+  }
+  for (u32 i = 0; i <= 1000; ++i) {
+    PosColNormVertexAttDatum vertex = makeVertex(1.0f, 1.0f, 1.0f);
+    vertex.color[0] = vertex.color[1] = vertex.color[2] = i / 1000.0f;
+    vertices.push_back(vertex);
+  }
+  checkVertices("colors", vertices, POSITION_QUANTIZATION_SNORM16);
+}
+
+internal_access void testNormals() {
+  std::vector<PosColNormVertexAttDatum> vertices;
+  f32 axes[][3] = {
+    { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }, // poles
+    { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+    { 1.0f, 1.0f, -1.0f }, { -1.0f, 1.0f, -1.0f }, { 1.0f, -1.0f, -1.0f }, { -1.0f, -1.0f, -1.0f }, // fold corners
+    { 0.0f, 1.0e-6f, -1.0f }, { -1.0e-6f, 0.0f, -1.0f }, // next to the lower pole, where the fold is discontinuous
+    { 3.0f, 0.0f, -4.0f }, // not unit length
+  };
+  for (const auto& axis : axes) {
+    PosColNormVertexAttDatum vertex = makeVertex(0.0f, 0.0f, 0.0f);
+    memcpy(vertex.normal, axis, sizeof(vertex.normal));
+    vertices.push_back(vertex);
+  }
+  // Sphere sweep, both hemispheres, pole to pole
+  const u32 latitudeSteps = 180, longitudeSteps = 360;
+  for (u32 i = 0; i <= latitudeSteps; ++i) {
+    f32 theta = 3.14159265f * i / latitudeSteps;
+    for (u32 j = 0; j < longitudeSteps; ++j) {
+      f32 phi = 2.0f * 3.14159265f * j / longitudeSteps;
+      PosColNormVertexAttDatum vertex = makeVertex(0.0f, 0.0f, 0.0f);
+      vertex.normal[0] = sinf(theta) * cosf(phi);
+      vertex.normal[1] = sinf(theta) * sinf(phi);
+      vertex.normal[2] = cosf(theta);
+      vertices.push_back(vertex);
+    }
+  }
+  checkVertices("normals", vertices, POSITION_QUANTIZATION_SNORM16);
+
+  // The lower hemisphere is folded, it must decode back below the equator
+  for (const PosColNormVertexAttDatum& vertex : vertices) {
+    s16 encoded[2];
+    f32 decoded[3];
+    encodeOctahedral(vertex.normal, encoded);
+    decodeOctahedral(encoded, decoded);
+    if (fabsf(vertex.normal[2]) > 1.0e-3f) {
+      CHECK((decoded[2] < 0.0f) == (vertex.normal[2] < 0.0f), "normal (%g, %g, %g) decodes to (%g, %g, %g)",
+            vertex.normal[0], vertex.normal[1], vertex.normal[2], decoded[0], decoded[1], decoded[2]);
+    }
+  }
+}
+
+int main() {
+  testHalfEncoding();
+  testSnorm16Encoding();
+  testPositions();
+  testColors();
+  testNormals();
+
+  if (failureCount > 0) {
+    printf("%u checks failed\n", failureCount);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
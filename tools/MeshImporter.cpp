@@ -0,0 +1,269 @@
+/* ========================================================================
+   Offline importer converting any assimp supported file (.obj, .fbx, .gltf, ...) into the .kmesh format described
+   in src/MeshFormat.h, loaded at runtime with loadMeshFile.
+
+   Triangles and vertices of each submesh are reordered for the vertex cache, overdraw and vertex fetch
+   (MeshOptimizer.h), indices are stored as 16 bit when every submesh fits.
+
+   Usage: MeshImporter [--positions float32|snorm16|float16] <input file> <output .kmesh file>
+     --positions: position encoding, snorm16 by default. Unless float32, colors are stored as UNORM8 and normals
+                  octahedral encoded (VertexQuantization.h), and the import fails if any decoded vertex exceeds the
+                  error bounds of its encoding.
+   ======================================================================== */
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+#include <vector>
+
+#include "KuringTypes.h"
+#include "Models.h"
+#include "MeshFormat.h"
+#include "VertexQuantization.h"
+#include "MeshOptimizer.h"
+#include "Util.h"
+
+internal_access void writeZeros(FILE* file, u64 count) {
+  const u8 zeros[MESH_FILE_SECTION_ALIGNMENT] = {};
+  fwrite(zeros, 1, count, file);
+}
+
+/*
+ * - Triangulate, merge identical vertices and generate missing normals
+ * - Pre-transform vertices so that the node hierarchy is flattened into mesh space, one submesh per mesh
+ * - Points and lines are split out by SortByPType and skipped
+ */
+internal_access const aiScene* importScene(Assimp::Importer* importer, const char* inputPath) {
+  importer->SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+  return importer->ReadFile(inputPath,
+                            aiProcess_Triangulate |
+                            aiProcess_JoinIdenticalVertices |
+                            aiProcess_GenSmoothNormals |
+                            aiProcess_PreTransformVertices |
+                            aiProcess_SortByPType);
+}
+
+internal_access void accumulateVertexCacheStats(VertexCacheStats* total, const VertexCacheStats& stats) {
+  total->triangleCount += stats.triangleCount;
+  total->vertexCount += stats.vertexCount;
+  total->cacheMisses += stats.cacheMisses;
+}
+
+internal_access void printVertexCacheStats(const char* label, const VertexCacheStats& stats) {
+  printf("%s: ACMR %.3f, ATVR %.3f (FIFO cache of %u vertices)\n", label,
+         stats.triangleCount ? (f32)stats.cacheMisses / stats.triangleCount : 0.0f,
+         stats.vertexCount ? (f32)stats.cacheMisses / stats.vertexCount : 0.0f, VERTEX_CACHE_SIZE);
+}
+
+/*
+ * - Reorder triangles for the vertex cache, then clusters of them for overdraw
+ * - Reorder vertices in order of first use, unreferenced vertices are dropped
+ */
+internal_access void optimizeSubmesh(std::vector<PosColNormVertexAttDatum>* vertices, std::vector<u32>* indices,
+                                     VertexCacheStats* statsBefore, VertexCacheStats* statsAfter) {
+  u32 vertexCount = (u32)vertices->size();
+  u32 indexCount = (u32)indices->size();
+  accumulateVertexCacheStats(statsBefore, analyzeVertexCache(indices->data(), indexCount, vertexCount, VERTEX_CACHE_SIZE));
+
+  std::vector<u32> cacheOptimized(indexCount);
+  optimizeVertexCache(indices->data(), indexCount, vertexCount, cacheOptimized.data());
+  optimizeOverdraw(cacheOptimized.data(), indexCount, (*vertices)[0].position, sizeof(PosColNormVertexAttDatum), vertexCount,
+                   DEFAULT_OVERDRAW_THRESHOLD, indices->data());
+
+  std::vector<u32> remap(vertexCount);
+  u32 usedVertexCount = optimizeVertexFetch(indices->data(), indexCount, vertexCount, remap.data());
+  std::vector<PosColNormVertexAttDatum> remappedVertices(usedVertexCount);
+  for (u32 i = 0; i < vertexCount; ++i) {
+    if (remap[i] != UNUSED_VERTEX) {
+      remappedVertices[remap[i]] = (*vertices)[i];
+    }
+  }
+  vertices->swap(remappedVertices);
+  accumulateVertexCacheStats(statsAfter, analyzeVertexCache(indices->data(), indexCount, usedVertexCount, VERTEX_CACHE_SIZE));
+}
+
+internal_access bool32 parsePositionQuantization(const char* name, PositionQuantization* quantization) {
+  if (strcmp(name, "float32") == 0) {
+    *quantization = POSITION_QUANTIZATION_NONE;
+  } else if (strcmp(name, "snorm16") == 0) {
+    *quantization = POSITION_QUANTIZATION_SNORM16;
+  } else if (strcmp(name, "float16") == 0) {
+    *quantization = POSITION_QUANTIZATION_FLOAT16;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  PositionQuantization quantization = POSITION_QUANTIZATION_SNORM16;
+  u32 argIndex = 1;
+  if (argc == 5 && strcmp(argv[1], "--positions") == 0 && parsePositionQuantization(argv[2], &quantization)) {
+    argIndex = 3;
+  } else if (argc != 3) {
+    fprintf(stderr, "usage: %s [--positions float32|snorm16|float16] <input file> <output .kmesh file>\n", argv[0]);
+    return 1;
+  }
+  const char* inputPath = argv[argIndex];
+  const char* outputPath = argv[argIndex + 1];
+
+  Assimp::Importer importer;
+  const aiScene* scene = importScene(&importer, inputPath);
+  if (scene == nullptr || scene->mRootNode == nullptr) {
+    fprintf(stderr, "failed to import %s: %s\n", inputPath, importer.GetErrorString());
+    return 1;
+  }
+
+  std::vector<PosColNormVertexAttDatum> vertices;
+  std::vector<u32> indices;
+  std::vector<MeshFileSubmesh> submeshes;
+  f32 boundsMin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  f32 boundsMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  VertexCacheStats statsBefore = {};
+  VertexCacheStats statsAfter = {};
+  u32 maxSubmeshVertexCount = 0;
+
+  for (u32 meshIndex = 0; meshIndex < scene->mNumMeshes; ++meshIndex) {
+    const aiMesh* mesh = scene->mMeshes[meshIndex];
+    if (!(mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE) || mesh->mNumVertices == 0) {
+      continue;
+    }
+
+    std::vector<PosColNormVertexAttDatum> meshVertices;
+    std::vector<u32> meshIndices;
+    for (u32 i = 0; i < mesh->mNumVertices; ++i) {
+      PosColNormVertexAttDatum vertex;
+      aiVector3D position = mesh->mVertices[i];
+      aiVector3D normal = mesh->HasNormals() ? mesh->mNormals[i] : aiVector3D(0.0f, 0.0f, 1.0f);
+      vertex.position[0] = position.x; vertex.position[1] = position.y; vertex.position[2] = position.z;
+      vertex.normal[0] = normal.x; vertex.normal[1] = normal.y; vertex.normal[2] = normal.z;
+      if (mesh->HasVertexColors(0)) {
+        aiColor4D color = mesh->mColors[0][i];
+        vertex.color[0] = color.r; vertex.color[1] = color.g; vertex.color[2] = color.b;
+      } else {
+        // Visualize the normal
+        vertex.color[0] = normal.x * 0.5f + 0.5f; vertex.color[1] = normal.y * 0.5f + 0.5f; vertex.color[2] = normal.z * 0.5f + 0.5f;
+      }
+      meshVertices.push_back(vertex);
+    }
+
+    for (u32 i = 0; i < mesh->mNumFaces; ++i) {
+      const aiFace& face = mesh->mFaces[i];
+      if (face.mNumIndices != 3) {
+        continue;
+      }
+      meshIndices.push_back(face.mIndices[0]);
+      meshIndices.push_back(face.mIndices[1]);
+      meshIndices.push_back(face.mIndices[2]);
+    }
+    if (meshIndices.empty()) {
+      continue;
+    }
+    optimizeSubmesh(&meshVertices, &meshIndices, &statsBefore, &statsAfter);
+
+    MeshFileSubmesh submesh;
+    submesh.firstIndex = (u32)indices.size();
+    submesh.indexCount = (u32)meshIndices.size();
+    submesh.vertexOffset = (s32)vertices.size();
+    submesh.materialIndex = mesh->mMaterialIndex;
+    submeshes.push_back(submesh);
+    for (const PosColNormVertexAttDatum& vertex : meshVertices) {
+      for (u32 axis = 0; axis < 3; ++axis) {
+        boundsMin[axis] = vertex.position[axis] < boundsMin[axis] ? vertex.position[axis] : boundsMin[axis];
+        boundsMax[axis] = vertex.position[axis] > boundsMax[axis] ? vertex.position[axis] : boundsMax[axis];
+      }
+    }
+    maxSubmeshVertexCount = (u32)meshVertices.size() > maxSubmeshVertexCount ? (u32)meshVertices.size() : maxSubmeshVertexCount;
+    vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+    indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+  }
+
+  if (submeshes.empty()) {
+    fprintf(stderr, "no triangle meshes in %s\n", inputPath);
+    return 1;
+  }
+  printVertexCacheStats("vertex cache before optimization", statsBefore);
+  printVertexCacheStats("vertex cache after optimization", statsAfter);
+
+  // Indices are relative to their submesh's vertexOffset, so only the largest submesh has to fit in 16 bits
+  std::vector<u16> narrowIndices;
+  const void* indexData = indices.data();
+  u32 indexSize = sizeof(u32);
+  if (maxSubmeshVertexCount <= 0xFFFF) {
+    narrowIndices.assign(indices.begin(), indices.end());
+    indexData = narrowIndices.data();
+    indexSize = sizeof(u16);
+  }
+
+  PositionDequantization dequantization = computePositionDequantization(quantization, boundsMin, boundsMax);
+  std::vector<QuantizedVertexAttDatum> quantizedVertices;
+  const void* vertexData = vertices.data();
+  u32 vertexStride = sizeof(PosColNormVertexAttDatum);
+  u32 attributeCount = POS_COL_NORM_VERTEX_ATT_FORMAT_COUNT;
+  if (quantization != POSITION_QUANTIZATION_NONE) {
+    quantizedVertices.resize(vertices.size());
+    quantizeVertices(vertices.data(), (u32)vertices.size(), quantization, dequantization, quantizedVertices.data());
+    QuantizationError error = measureQuantizationError(vertices.data(), quantizedVertices.data(), (u32)vertices.size(),
+                                                       quantization, dequantization);
+    QuantizationError bounds = quantizationErrorBounds(quantization, boundsMin, boundsMax);
+    printf("max quantization error: position %g (bound %g), color %g (bound %g), normal %g (bound %g)\n",
+           error.position, bounds.position, error.color, bounds.color, error.normal, bounds.normal);
+    // Negated comparisons so that NaN errors fail too
+    if (!(error.position <= bounds.position) || !(error.color <= bounds.color) || !(error.normal <= bounds.normal)) {
+      fprintf(stderr, "quantization error of %s exceeds its bounds, use a more precise --positions encoding\n", inputPath);
+      return 1;
+    }
+    vertexData = quantizedVertices.data();
+    vertexStride = sizeof(QuantizedVertexAttDatum);
+    attributeCount = QUANTIZED_VERTEX_ATT_FORMAT_COUNT;
+  }
+
+  MeshFileHeader header = {};
+  header.magic = MESH_FILE_MAGIC;
+  header.version = MESH_FILE_VERSION;
+  header.vertexStride = vertexStride;
+  header.attributeCount = attributeCount;
+  memcpy(header.attributes, quantizedVertexAttFormat(quantization), attributeCount * sizeof(VertexAttFormat));
+  header.vertexCount = (u32)vertices.size();
+  header.indexCount = (u32)indices.size();
+  header.submeshCount = (u32)submeshes.size();
+  header.positionQuantization = quantization;
+  header.positionDequantization = dequantization;
+  header.indexSize = indexSize;
+  u64 vertexDataSize = (u64)vertices.size() * vertexStride;
+  u64 indexDataSize = (u64)indices.size() * indexSize;
+  u64 submeshTableSize = submeshes.size() * sizeof(MeshFileSubmesh);
+  header.vertexDataOffset = alignUp(sizeof(MeshFileHeader), MESH_FILE_SECTION_ALIGNMENT);
+  header.indexDataOffset = alignUp(header.vertexDataOffset + vertexDataSize, MESH_FILE_SECTION_ALIGNMENT);
+  header.submeshTableOffset = alignUp(header.indexDataOffset + indexDataSize, MESH_FILE_SECTION_ALIGNMENT);
+  header.fileSize = header.submeshTableOffset + submeshTableSize;
+  memcpy(header.boundsMin, boundsMin, sizeof(boundsMin));
+  memcpy(header.boundsMax, boundsMax, sizeof(boundsMax));
+
+  FILE* outputFile = fopen(outputPath, "wb");
+  if (outputFile == nullptr) {
+    fprintf(stderr, "failed to open %s for writing\n", outputPath);
+    return 1;
+  }
+  fwrite(&header, sizeof(header), 1, outputFile);
+  writeZeros(outputFile, header.vertexDataOffset - sizeof(MeshFileHeader));
+  fwrite(vertexData, 1, vertexDataSize, outputFile);
+  writeZeros(outputFile, header.indexDataOffset - (header.vertexDataOffset + vertexDataSize));
+  fwrite(indexData, 1, indexDataSize, outputFile);
+  writeZeros(outputFile, header.submeshTableOffset - (header.indexDataOffset + indexDataSize));
+  fwrite(submeshes.data(), 1, submeshTableSize, outputFile);
+  bool32 writeFailed = ferror(outputFile);
+  fclose(outputFile);
+  if (writeFailed) {
+    fprintf(stderr, "failed to write %s\n", outputPath);
+    return 1;
+  }
+
+  printf("%s: %u submeshes, %u vertices, %u triangles, %u bit indices, %llu bytes\n", outputPath, header.submeshCount,
+         header.vertexCount, header.indexCount / 3, indexSize * 8, (unsigned long long)header.fileSize);
+  return 0;
+}